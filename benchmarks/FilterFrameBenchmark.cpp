@@ -0,0 +1,106 @@
+#include "../src/Renderer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// times whole frames of a textured, lit scene with each texture filter, relative to nearest sampling
+
+static constexpr int RESOLUTION = 1024;
+static constexpr int TEXTURE_SIZE = 1024;
+static constexpr int REPEATS = 20;
+
+// gridSize x gridSize quads facing +z filling the view, the texture spans it once at about a texel per pixel
+static Mesh makeGrid(const int gridSize, const std::shared_ptr<Material>& material)
+{
+	VertexArray vertices;
+	auto addCorner = [&](const int i, const int j)
+	{
+		const float u = static_cast<float>(i) / gridSize;
+		const float v = static_cast<float>(j) / gridSize;
+		vertices.positionsX.push_back(u * 2.0f - 1.0f);
+		vertices.positionsY.push_back(v * 2.0f - 1.0f);
+		vertices.positionsZ.push_back(0.0f);
+		vertices.uvsU.push_back(u);
+		vertices.uvsV.push_back(v);
+		vertices.normalsX.push_back(0.0f);
+		vertices.normalsY.push_back(0.0f);
+		vertices.normalsZ.push_back(1.0f);
+	};
+
+	for (int j = 0; j < gridSize; ++j)
+	{
+		for (int i = 0; i < gridSize; ++i)
+		{
+			addCorner(i, j);
+			addCorner(i + 1, j);
+			addCorner(i + 1, j + 1);
+			addCorner(i, j);
+			addCorner(i + 1, j + 1);
+			addCorner(i, j + 1);
+		}
+	}
+	return Mesh(vertices, material);
+}
+
+// best of REPEATS frames in milliseconds
+template <typename Frame>
+static double measureMilliseconds(Frame&& frame)
+{
+	frame();
+	double best = 1e30;
+	for (int repeat = 0; repeat < REPEATS; ++repeat)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		frame();
+		const auto end = std::chrono::steady_clock::now();
+		best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+	}
+	return best;
+}
+
+int main()
+{
+	std::mt19937 rng(1234);
+	std::vector<uint8_t> rgb(static_cast<size_t>(TEXTURE_SIZE) * TEXTURE_SIZE * 3);
+	for (auto& channel : rgb)
+		channel = static_cast<uint8_t>(rng());
+	auto texture = std::make_shared<Texture>("");
+	texture->create(TEXTURE_SIZE, TEXTURE_SIZE, rgb.data());
+
+	const Camera camera(glm::vec3(0.0f, 0.0f, 2.4f), glm::vec3(0.0f, 1.0f, 0.0f), -90.0f, 0.0f, 45.0f, 1.0f,
+	                    0.1f, 100.0f);
+
+	Renderer renderer;
+	Framebuffer framebuffer(RESOLUTION, RESOLUTION);
+
+	std::printf("%-10s %10s %10s %8s %10s %8s  (ms per frame at %dx%d, %dx%d texture)\n", "triangles", "nearest",
+	            "bilinear", "ratio", "trilinear", "ratio", RESOLUTION, RESOLUTION, TEXTURE_SIZE, TEXTURE_SIZE);
+	for (const int gridSize : {16, 64})
+	{
+		double milliseconds[3];
+		const TextureFilter filters[] = {TextureFilter::Nearest, TextureFilter::Bilinear, TextureFilter::Trilinear};
+		for (int i = 0; i < 3; ++i)
+		{
+			auto material = std::make_shared<Material>();
+			material->setDiffuseTexture(texture);
+			material->setTextureFilter(filters[i]);
+			material->setTextureWrap(std::pair{TextureWrap::Repeat, TextureWrap::Repeat});
+			const Model scene(std::vector<Mesh>{makeGrid(gridSize, material)});
+
+			milliseconds[i] = measureMilliseconds([&]
+			{
+				framebuffer.clear();
+				framebuffer.clearDepth();
+				renderer.renderModel(framebuffer, camera, scene);
+			});
+		}
+
+		std::printf("%-10d %10.3f %10.3f %7.2fx %10.3f %7.2fx\n", gridSize * gridSize * 2, milliseconds[0],
+		            milliseconds[1], milliseconds[1] / milliseconds[0], milliseconds[2],
+		            milliseconds[2] / milliseconds[0]);
+	}
+	return 0;
+}
@@ -0,0 +1,102 @@
+#include "../src/Renderer.h"
+#include "../src/ShadowMap.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// times the depth-only shadow pass against a full color pass of the same scene from the same camera
+
+static constexpr int RESOLUTION = 1024;
+static constexpr int REPEATS = 20;
+
+// rippled grid of gridSize x gridSize quads facing +z, filling the view
+static Mesh makeGrid(const int gridSize, const std::shared_ptr<Material>& material)
+{
+	VertexArray vertices;
+	auto addCorner = [&](const int i, const int j)
+	{
+		const float u = static_cast<float>(i) / gridSize;
+		const float v = static_cast<float>(j) / gridSize;
+		vertices.positionsX.push_back(u * 2.0f - 1.0f);
+		vertices.positionsY.push_back(v * 2.0f - 1.0f);
+		vertices.positionsZ.push_back(0.05f * std::sin(u * 40.0f) * std::cos(v * 40.0f));
+		vertices.uvsU.push_back(u * 4.0f);
+		vertices.uvsV.push_back(v * 4.0f);
+		vertices.normalsX.push_back(0.0f);
+		vertices.normalsY.push_back(0.0f);
+		vertices.normalsZ.push_back(1.0f);
+	};
+
+	for (int j = 0; j < gridSize; ++j)
+	{
+		for (int i = 0; i < gridSize; ++i)
+		{
+			addCorner(i, j);
+			addCorner(i + 1, j);
+			addCorner(i + 1, j + 1);
+			addCorner(i, j);
+			addCorner(i + 1, j + 1);
+			addCorner(i, j + 1);
+		}
+	}
+	return Mesh(vertices, material);
+}
+
+// best of REPEATS runs in milliseconds
+template <typename Pass>
+static double measureMilliseconds(Pass&& pass)
+{
+	pass();
+	double best = 1e30;
+	for (int repeat = 0; repeat < REPEATS; ++repeat)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		pass();
+		const auto end = std::chrono::steady_clock::now();
+		best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+	}
+	return best;
+}
+
+int main()
+{
+	std::mt19937 rng(1234);
+	std::vector<uint8_t> rgb(256 * 256 * 3);
+	for (auto& channel : rgb)
+		channel = static_cast<uint8_t>(rng());
+	auto texture = std::make_shared<Texture>("");
+	texture->create(256, 256, rgb.data());
+
+	// lit, textured and bilinear filtered, the usual forward material
+	auto material = std::make_shared<Material>();
+	material->setDiffuseTexture(texture);
+	material->setTextureFilter(TextureFilter::Bilinear);
+
+	const Camera camera(glm::vec3(0.0f, 0.0f, 2.4f), glm::vec3(0.0f, 1.0f, 0.0f), -90.0f, 0.0f, 45.0f, 1.0f,
+	                    0.1f, 100.0f);
+
+	Renderer renderer;
+	Framebuffer framebuffer(RESOLUTION, RESOLUTION);
+	ShadowMap shadowMap(RESOLUTION);
+
+	std::printf("%-10s %12s %12s %8s  (ms per pass at %dx%d)\n", "triangles", "color", "shadow", "ratio",
+	            RESOLUTION, RESOLUTION);
+	for (const int gridSize : {16, 64, 256})
+	{
+		const Model scene(std::vector<Mesh>{makeGrid(gridSize, material)});
+
+		const double color = measureMilliseconds([&]
+		{
+			framebuffer.clear();
+			framebuffer.clearDepth();
+			renderer.renderModel(framebuffer, camera, scene);
+		});
+		const double shadow = measureMilliseconds([&] { renderer.renderShadowMap(shadowMap, camera, scene); });
+
+		std::printf("%-10d %12.3f %12.3f %7.1fx\n", gridSize * gridSize * 2, color, shadow, color / shadow);
+	}
+	return 0;
+}
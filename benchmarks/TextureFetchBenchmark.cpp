@@ -0,0 +1,169 @@
+#include "../src/Texture.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// compares scalar, gather and permute texel fetch over texture sizes and access patterns,
+// then the cost of each filter relative to nearest sampling
+
+static constexpr int QUAD_COUNT = 1 << 16;
+static constexpr int REPEATS = 32;
+
+// lanes as plain aligned arrays, vectors of __m128i drop the type's alignment attribute
+struct CoordinateQuad
+{
+	alignas(16) int32_t x[4];
+	alignas(16) int32_t y[4];
+};
+using QuadCoordinates = std::vector<CoordinateQuad>;
+
+// neighbouring texels along a row, like a magnified surface
+static QuadCoordinates makeCoherentQuads(const int size, std::mt19937& rng)
+{
+	QuadCoordinates quads;
+	std::uniform_int_distribution<int> start(0, size - 4);
+	for (int i = 0; i < QUAD_COUNT; ++i)
+	{
+		const int x = start(rng) & ~3;
+		const int y = start(rng);
+		quads.push_back({{x, x + 1, x + 2, x + 3}, {y, y, y, y}});
+	}
+	return quads;
+}
+
+// every lane anywhere in the texture, like a heavily minified one without mipmaps
+static QuadCoordinates makeRandomQuads(const int size, std::mt19937& rng)
+{
+	QuadCoordinates quads;
+	std::uniform_int_distribution<int> coordinate(0, size - 1);
+	for (int i = 0; i < QUAD_COUNT; ++i)
+	{
+		CoordinateQuad& quad = quads.emplace_back();
+		for (int lane = 0; lane < 4; ++lane)
+		{
+			quad.x[lane] = coordinate(rng);
+			quad.y[lane] = coordinate(rng);
+		}
+	}
+	return quads;
+}
+
+static double measureNanosecondsPerQuad(const Texture& texture, const QuadCoordinates& quads, const TexelFetch method)
+{
+	__m128i checksum = _mm_setzero_si128();
+	const auto start = std::chrono::steady_clock::now();
+	for (int repeat = 0; repeat < REPEATS; ++repeat)
+	{
+		for (int i = 0; i < QUAD_COUNT; ++i)
+		{
+			const __m128i x = _mm_load_si128(reinterpret_cast<const __m128i*>(quads[i].x));
+			const __m128i y = _mm_load_si128(reinterpret_cast<const __m128i*>(quads[i].y));
+			checksum = _mm_xor_si128(checksum, texture.fetch(0, x, y, method));
+		}
+	}
+	const auto end = std::chrono::steady_clock::now();
+
+	// keeps the fetches from being optimized away
+	volatile int sink = _mm_cvtsi128_si32(checksum);
+	(void)sink;
+
+	const double nanoseconds = static_cast<double>(
+		std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+	return nanoseconds / (static_cast<double>(QUAD_COUNT) * REPEATS);
+}
+
+struct UVQuad
+{
+	alignas(16) float u[4];
+	alignas(16) float v[4];
+};
+using QuadUVs = std::vector<UVQuad>;
+
+// 2x2 pixel quads stepping about one texel per pixel, like a surface at its native resolution
+static QuadUVs makeCoherentUVs(const int size, std::mt19937& rng)
+{
+	QuadUVs quads;
+	std::uniform_real_distribution<float> start(0.0f, 1.0f);
+	const float step = 1.0f / static_cast<float>(size);
+	for (int i = 0; i < QUAD_COUNT; ++i)
+	{
+		const float u = start(rng);
+		const float v = start(rng);
+		quads.push_back({{u, u + step, u, u + step}, {v, v, v + step, v + step}});
+	}
+	return quads;
+}
+
+static double measureNanosecondsPerQuad(const Texture& texture, const QuadUVs& quads, const TextureFilter filter)
+{
+	__m128i checksum = _mm_setzero_si128();
+	const auto start = std::chrono::steady_clock::now();
+	for (int repeat = 0; repeat < REPEATS; ++repeat)
+		for (int i = 0; i < QUAD_COUNT; ++i)
+			checksum = _mm_xor_si128(checksum, texture.sample(_mm_load_ps(quads[i].u), _mm_load_ps(quads[i].v), 0.5f,
+			                                                  filter));
+	const auto end = std::chrono::steady_clock::now();
+
+	volatile int sink = _mm_cvtsi128_si32(checksum);
+	(void)sink;
+
+	const double nanoseconds = static_cast<double>(
+		std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+	return nanoseconds / (static_cast<double>(QUAD_COUNT) * REPEATS);
+}
+
+int main()
+{
+#ifdef __AVX2__
+	std::printf("AVX2 gather enabled\n");
+#else
+	std::printf("AVX2 disabled, gather falls back to scalar\n");
+#endif
+	std::printf("%-6s %-9s %10s %10s %10s  (ns per quad)\n", "size", "pattern", "scalar", "gather", "permute");
+
+	std::mt19937 rng(1234);
+	for (const int size : {64, 256, 1024, 4096})
+	{
+		std::vector<uint8_t> rgb(static_cast<size_t>(size) * size * 3);
+		for (auto& channel : rgb)
+			channel = static_cast<uint8_t>(rng());
+
+		Texture texture("");
+		texture.create(size, size, rgb.data());
+
+		const QuadCoordinates coherent = makeCoherentQuads(size, rng);
+		const QuadCoordinates random = makeRandomQuads(size, rng);
+
+		for (const auto& [name, quads] : {std::pair{"coherent", &coherent}, std::pair{"random", &random}})
+		{
+			std::printf("%-6d %-9s %10.2f %10.2f %10.2f\n", size, name,
+			            measureNanosecondsPerQuad(texture, *quads, TexelFetch::Scalar),
+			            measureNanosecondsPerQuad(texture, *quads, TexelFetch::Gather),
+			            measureNanosecondsPerQuad(texture, *quads, TexelFetch::Permute));
+		}
+	}
+
+	std::printf("\n%-6s %-9s %10s %10s %10s %10s %10s  (ns per quad, repeat wrap)\n", "size", "pattern", "nearest",
+	            "bilinear", "ratio", "trilinear", "ratio");
+	for (const int size : {64, 256, 1024, 2048})
+	{
+		std::vector<uint8_t> rgb(static_cast<size_t>(size) * size * 3);
+		for (auto& channel : rgb)
+			channel = static_cast<uint8_t>(rng());
+
+		Texture texture("");
+		texture.create(size, size, rgb.data());
+		texture.setWrap(TextureWrap::Repeat, TextureWrap::Repeat);
+
+		const QuadUVs quads = makeCoherentUVs(size, rng);
+		const double nearest = measureNanosecondsPerQuad(texture, quads, TextureFilter::Nearest);
+		const double bilinear = measureNanosecondsPerQuad(texture, quads, TextureFilter::Bilinear);
+		const double trilinear = measureNanosecondsPerQuad(texture, quads, TextureFilter::Trilinear);
+		std::printf("%-6d %-9s %10.2f %10.2f %9.2fx %10.2f %9.2fx\n", size, "coherent", nearest, bilinear,
+		            bilinear / nearest, trilinear, trilinear / nearest);
+	}
+
+	return 0;
+}
@@ -1,5 +1,10 @@
 include "dependencies/conandeps.premake5.lua"
 
+newoption {
+    trigger     = "avx2",
+    description = "Build with AVX2 for gather-based texture fetch"
+}
+
 workspace "Rasterizer"
     configurations { "Debug", "Release" }
     architecture "x64"
@@ -17,6 +22,10 @@ workspace "Rasterizer"
         
         vectorextensions "SSE4.1" 
 
+        filter "options:avx2"
+            vectorextensions "AVX2"
+        filter {}
+
         -- Debug configuration
         filter "configurations:Debug"
             defines   { "DEBUG" }
@@ -57,6 +66,139 @@ workspace "Rasterizer"
         
         vectorextensions "SSE4.1"
 
+        filter "options:avx2"
+            vectorextensions "AVX2"
+        filter {}
+
+        -- Debug configuration
+        filter "configurations:Debug"
+            defines   { "DEBUG" }
+            runtime   "Debug"      -- /MDd
+            symbols   "On"         -- /Zi + /DEBUG
+            optimize  "Off"        -- /Od
+        filter {}
+
+        -- Release configuration
+        filter "configurations:Release"
+            defines   { "NDEBUG" }
+            runtime   "Release"    -- /MD
+            optimize  "Speed"      -- /O2
+            flags     { "LinkTimeOptimization" } -- /GL + /LTCG
+        filter {}
+
+        conan_setup()
+        linkoptions { "/IGNORE:4099" }
+
+    project "RasterizerBenchmarks"
+        kind "ConsoleApp"
+        language "C++"
+        cppdialect "C++latest"
+
+        targetdir   "build/%{cfg.buildcfg}/bin"
+        objdir      "build/%{cfg.buildcfg}/obj/benchmarks"
+
+        location "./benchmarks"
+        files {
+            "%{prj.location}/TextureFetchBenchmark.cpp",
+            "src/Texture.h",
+            "src/Texture.cpp",
+            "src/BlockCompression.h",
+            "src/BlockCompression.cpp",
+            "src/AlignedAllocator.h"
+        }
+
+        vectorextensions "SSE4.1"
+
+        filter "options:avx2"
+            vectorextensions "AVX2"
+        filter {}
+
+        -- Debug configuration
+        filter "configurations:Debug"
+            defines   { "DEBUG" }
+            runtime   "Debug"      -- /MDd
+            symbols   "On"         -- /Zi + /DEBUG
+            optimize  "Off"        -- /Od
+        filter {}
+
+        -- Release configuration
+        filter "configurations:Release"
+            defines   { "NDEBUG" }
+            runtime   "Release"    -- /MD
+            optimize  "Speed"      -- /O2
+            flags     { "LinkTimeOptimization" } -- /GL + /LTCG
+        filter {}
+
+        conan_setup()
+        linkoptions { "/IGNORE:4099" }
+
+    project "ShadowPassBenchmark"
+        kind "ConsoleApp"
+        language "C++"
+        cppdialect "C++latest"
+
+        targetdir   "build/%{cfg.buildcfg}/bin"
+        objdir      "build/%{cfg.buildcfg}/obj/shadowbenchmark"
+
+        location "./benchmarks"
+        files {
+            "%{prj.location}/ShadowPassBenchmark.cpp",
+            "src/**.h",
+            "src/**.cpp"
+        }
+
+        -- the renderer without the application's entry point
+        removefiles { "src/main.cpp" }
+
+        vectorextensions "SSE4.1"
+
+        filter "options:avx2"
+            vectorextensions "AVX2"
+        filter {}
+
+        -- Debug configuration
+        filter "configurations:Debug"
+            defines   { "DEBUG" }
+            runtime   "Debug"      -- /MDd
+            symbols   "On"         -- /Zi + /DEBUG
+            optimize  "Off"        -- /Od
+        filter {}
+
+        -- Release configuration
+        filter "configurations:Release"
+            defines   { "NDEBUG" }
+            runtime   "Release"    -- /MD
+            optimize  "Speed"      -- /O2
+            flags     { "LinkTimeOptimization" } -- /GL + /LTCG
+        filter {}
+
+        conan_setup()
+        linkoptions { "/IGNORE:4099" }
+
+    project "FilterFrameBenchmark"
+        kind "ConsoleApp"
+        language "C++"
+        cppdialect "C++latest"
+
+        targetdir   "build/%{cfg.buildcfg}/bin"
+        objdir      "build/%{cfg.buildcfg}/obj/filterbenchmark"
+
+        location "./benchmarks"
+        files {
+            "%{prj.location}/FilterFrameBenchmark.cpp",
+            "src/**.h",
+            "src/**.cpp"
+        }
+
+        -- the renderer without the application's entry point
+        removefiles { "src/main.cpp" }
+
+        vectorextensions "SSE4.1"
+
+        filter "options:avx2"
+            vectorextensions "AVX2"
+        filter {}
+
         -- Debug configuration
         filter "configurations:Debug"
             defines   { "DEBUG" }
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <new>
+
+// std allocator handing out storage aligned to Alignment bytes, e.g. whole cache lines for texel blocks
+template <typename T, size_t Alignment>
+struct AlignedAllocator
+{
+	static_assert(Alignment >= alignof(T) && (Alignment & (Alignment - 1)) == 0,
+	              "Alignment must be a power of two no smaller than the type's alignment");
+
+	using value_type = T;
+
+	template <typename U>
+	struct rebind
+	{
+		using other = AlignedAllocator<U, Alignment>;
+	};
+
+	AlignedAllocator() noexcept = default;
+
+	template <typename U>
+	AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept
+	{
+	}
+
+	T* allocate(const size_t count)
+	{
+		return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t(Alignment)));
+	}
+
+	void deallocate(T* pointer, size_t) noexcept
+	{
+		::operator delete(pointer, std::align_val_t(Alignment));
+	}
+
+	template <typename U>
+	bool operator==(const AlignedAllocator<U, Alignment>&) const noexcept { return true; }
+};
@@ -0,0 +1,145 @@
+#include "AssetLoader.h"
+#include "Model.h"
+#include "TextureCache.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <stdexcept>
+
+AssetLoader::AssetLoader(unsigned threadCount)
+{
+	if (threadCount == 0)
+	{
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	mWorkers.reserve(threadCount);
+	for (unsigned i = 0; i < threadCount; ++i)
+	{
+		mWorkers.emplace_back(&AssetLoader::workerLoop, this);
+	}
+}
+
+AssetLoader::~AssetLoader()
+{
+	{
+		std::lock_guard lock(mMutex);
+		mStopping = true;
+	}
+	mCondition.notify_all();
+
+	for (std::thread& worker : mWorkers)
+	{
+		worker.join();
+	}
+}
+
+std::future<std::shared_ptr<Model>> AssetLoader::loadModel(const std::string& path)
+{
+	if (path.empty())
+	{
+		throw std::invalid_argument("Model filename cannot be empty");
+	}
+
+	return submit([this, path] { return std::make_shared<Model>(path, *this); });
+}
+
+TextureFuture AssetLoader::loadTexture(const std::string& path)
+{
+	if (path.empty())
+	{
+		throw std::invalid_argument("Texture path cannot be empty");
+	}
+
+	std::lock_guard lock(mMutex);
+	if (const auto it = mPendingTextures.find(path); it != mPendingTextures.end())
+	{
+		return it->second;
+	}
+
+	auto task = std::make_shared<std::packaged_task<std::shared_ptr<const Texture>()>>([this, path]
+	{
+		// later requests are served by the texture cache, or retry the decode if it threw
+		const auto forgetRequest = [this, &path]
+		{
+			std::lock_guard lock(mMutex);
+			mPendingTextures.erase(path);
+		};
+
+		std::shared_ptr<const Texture> texture;
+		try
+		{
+			texture = TextureCache::instance().load(path);
+		}
+		catch (...)
+		{
+			forgetRequest();
+			throw;
+		}
+		forgetRequest();
+		return texture;
+	});
+
+	TextureFuture future = task->get_future().share();
+	mPendingTextures.emplace(path, future);
+	mTasks.emplace([task] { (*task)(); });
+	mCondition.notify_one();
+	return future;
+}
+
+const std::shared_ptr<const Texture>& AssetLoader::getPlaceholderTexture()
+{
+	static const std::shared_ptr<const Texture> placeholder = []
+	{
+		// grey checkerboard
+		constexpr int SIZE = 8;
+		uint8_t pixels[SIZE * SIZE * 3];
+		for (int y = 0; y < SIZE; ++y)
+		{
+			for (int x = 0; x < SIZE; ++x)
+			{
+				const uint8_t value = ((x / 4 + y / 4) & 1) ? 0x60 : 0xA0;
+				std::fill_n(pixels + (y * SIZE + x) * 3, 3, value);
+			}
+		}
+
+		auto texture = std::make_shared<Texture>(std::string());
+		texture->create(SIZE, SIZE, pixels);
+		texture->setWrap(TextureWrap::Repeat, TextureWrap::Repeat);
+		return texture;
+	}();
+	return placeholder;
+}
+
+void AssetLoader::enqueue(std::function<void()> task)
+{
+	{
+		std::lock_guard lock(mMutex);
+		mTasks.push(std::move(task));
+	}
+	mCondition.notify_one();
+}
+
+void AssetLoader::workerLoop()
+{
+	while (true)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock lock(mMutex);
+			mCondition.wait(lock, [this] { return mStopping || !mTasks.empty(); });
+
+			// drain the queue before stopping; a running task may still queue texture loads,
+			// and the worker running it comes back here to pick them up
+			if (mTasks.empty())
+			{
+				return;
+			}
+
+			task = std::move(mTasks.front());
+			mTasks.pop();
+		}
+
+		task();
+	}
+}
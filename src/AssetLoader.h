@@ -0,0 +1,71 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "Texture.h"
+
+class Model;
+
+using TextureFuture = std::shared_future<std::shared_ptr<const Texture>>;
+
+// loads models and textures on a pool of worker threads; textures referenced by a model are
+// decoded in parallel with the rest of its geometry and show a placeholder until they finish
+class AssetLoader
+{
+public:
+	// zero uses one worker per hardware thread
+	explicit AssetLoader(unsigned threadCount = 0);
+
+	// finishes every queued load before returning
+	~AssetLoader();
+
+	AssetLoader(const AssetLoader&) = delete;
+	AssetLoader& operator=(const AssetLoader&) = delete;
+
+	// the model is ready once its geometry is built; call Model::resolvePendingTextures() to pick up textures
+	std::future<std::shared_ptr<Model>> loadModel(const std::string& path);
+
+	// goes through TextureCache, so repeated requests share one texture; null when the file cannot be decoded.
+	// Decode errors such as malformed headers are rethrown by the future, and the next request tries again
+	TextureFuture loadTexture(const std::string& path);
+
+	template <typename Function>
+	auto submit(Function&& function) -> std::future<std::invoke_result_t<Function>>;
+
+	size_t getThreadCount() const { return mWorkers.size(); }
+
+	// drawn in place of textures that are still loading
+	static const std::shared_ptr<const Texture>& getPlaceholderTexture();
+
+private:
+	void workerLoop();
+	void enqueue(std::function<void()> task);
+
+	std::vector<std::thread> mWorkers;
+	std::queue<std::function<void()>> mTasks;
+	std::mutex mMutex;
+	std::condition_variable mCondition;
+	bool mStopping = false;
+
+	// textures requested but not decoded yet, so concurrent requests decode once
+	std::unordered_map<std::string, TextureFuture> mPendingTextures;
+};
+
+template <typename Function>
+auto AssetLoader::submit(Function&& function) -> std::future<std::invoke_result_t<Function>>
+{
+	using Result = std::invoke_result_t<Function>;
+
+	// std::function needs a copyable callable
+	auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Function>(function));
+	std::future<Result> future = task->get_future();
+	enqueue([task] { (*task)(); });
+	return future;
+}
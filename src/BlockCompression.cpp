@@ -0,0 +1,274 @@
+#include "BlockCompression.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+
+// 5:6:5 to 8 bits per channel, replicating the high bits into the low ones
+static void expandColor565(const uint16_t color, uint32_t* rgb)
+{
+	const uint32_t r = (color >> 11) & 0x1F;
+	const uint32_t g = (color >> 5) & 0x3F;
+	const uint32_t b = color & 0x1F;
+	rgb[0] = (r << 3) | (r >> 2);
+	rgb[1] = (g << 2) | (g >> 4);
+	rgb[2] = (b << 3) | (b >> 2);
+}
+
+static uint32_t packTexel(const uint32_t r, const uint32_t g, const uint32_t b, const uint32_t a)
+{
+	return r | g << 8 | b << 16 | a << 24;
+}
+
+// color half of a block, BC3 always uses the four color mode
+static void decodeColorBlock(const uint8_t* block, uint32_t* texels, const bool allowPunchThrough)
+{
+	uint16_t color0, color1;
+	uint32_t indices;
+	std::memcpy(&color0, block, 2);
+	std::memcpy(&color1, block + 2, 2);
+	std::memcpy(&indices, block + 4, 4);
+
+	uint32_t c0[3], c1[3];
+	expandColor565(color0, c0);
+	expandColor565(color1, c1);
+
+	uint32_t palette[4];
+	palette[0] = packTexel(c0[0], c0[1], c0[2], 0xFF);
+	palette[1] = packTexel(c1[0], c1[1], c1[2], 0xFF);
+	if (color0 > color1 || !allowPunchThrough)
+	{
+		palette[2] = packTexel((2 * c0[0] + c1[0] + 1) / 3, (2 * c0[1] + c1[1] + 1) / 3, (2 * c0[2] + c1[2] + 1) / 3,
+		                       0xFF);
+		palette[3] = packTexel((c0[0] + 2 * c1[0] + 1) / 3, (c0[1] + 2 * c1[1] + 1) / 3, (c0[2] + 2 * c1[2] + 1) / 3,
+		                       0xFF);
+	}
+	else
+	{
+		// three colors plus transparent black
+		palette[2] = packTexel((c0[0] + c1[0] + 1) / 2, (c0[1] + c1[1] + 1) / 2, (c0[2] + c1[2] + 1) / 2, 0xFF);
+		palette[3] = 0;
+	}
+
+	for (int i = 0; i < 16; ++i)
+		texels[i] = palette[(indices >> (i * 2)) & 3];
+}
+
+void decodeBC1Block(const uint8_t* block, uint32_t* texels)
+{
+	decodeColorBlock(block, texels, true);
+}
+
+void decodeBC3Block(const uint8_t* block, uint32_t* texels)
+{
+	decodeColorBlock(block + 8, texels, false);
+
+	// two endpoints then 16 3-bit indices
+	const uint32_t alpha0 = block[0];
+	const uint32_t alpha1 = block[1];
+	uint32_t alphas[8];
+	alphas[0] = alpha0;
+	alphas[1] = alpha1;
+	if (alpha0 > alpha1)
+	{
+		for (uint32_t i = 1; i < 7; ++i)
+			alphas[i + 1] = ((7 - i) * alpha0 + i * alpha1 + 3) / 7;
+	}
+	else
+	{
+		for (uint32_t i = 1; i < 5; ++i)
+			alphas[i + 1] = ((5 - i) * alpha0 + i * alpha1 + 2) / 5;
+		alphas[6] = 0;
+		alphas[7] = 255;
+	}
+
+	uint64_t indices = 0;
+	std::memcpy(&indices, block + 2, 6);
+	for (int i = 0; i < 16; ++i)
+		texels[i] = (texels[i] & 0x00FFFFFF) | alphas[(indices >> (i * 3)) & 7] << 24;
+}
+
+static bool readFile(const std::string& path, std::vector<uint8_t>& bytes)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+	{
+		std::cerr << "Failed to open compressed texture: " << path << '\n';
+		return false;
+	}
+	bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	return true;
+}
+
+template <typename T>
+static T readValue(const std::vector<uint8_t>& bytes, const size_t offset)
+{
+	T value;
+	std::memcpy(&value, bytes.data() + offset, sizeof(T));
+	return value;
+}
+
+// 64-bit throughout, dimensions come from the file and can be close to INT_MAX
+static uint64_t getLevelBytes(const BlockFormat format, const int width, const int height)
+{
+	const uint64_t blocksWide = (static_cast<uint64_t>(width) + 3) / 4;
+	const uint64_t blocksHigh = (static_cast<uint64_t>(height) + 3) / 4;
+	return blocksWide * blocksHigh * getBlockBytes(format);
+}
+
+static void validateDimensions(const std::string& path, const int width, const int height)
+{
+	if (width <= 0 || height <= 0)
+		throw std::runtime_error(
+			"Invalid texture dimensions: " + std::to_string(width) + "x" + std::to_string(height) + " for: " + path);
+}
+
+bool loadDDS(const std::string& path, CompressedImage& image)
+{
+	std::vector<uint8_t> bytes;
+	if (!readFile(path, bytes)) return false;
+
+	constexpr size_t headerBytes = 128;
+	if (bytes.size() < headerBytes || std::memcmp(bytes.data(), "DDS ", 4) != 0)
+	{
+		std::cerr << "Not a DDS file: " << path << '\n';
+		return false;
+	}
+
+	const int height = static_cast<int>(readValue<uint32_t>(bytes, 12));
+	const int width = static_cast<int>(readValue<uint32_t>(bytes, 16));
+	const int levelCount = std::max(1, static_cast<int>(readValue<uint32_t>(bytes, 28)));
+	validateDimensions(path, width, height);
+
+	size_t dataOffset = headerBytes;
+	BlockFormat format;
+	if (std::memcmp(bytes.data() + 84, "DXT1", 4) == 0)
+	{
+		format = BlockFormat::BC1;
+	}
+	else if (std::memcmp(bytes.data() + 84, "DXT5", 4) == 0)
+	{
+		format = BlockFormat::BC3;
+	}
+	else if (std::memcmp(bytes.data() + 84, "DX10", 4) == 0 && bytes.size() >= headerBytes + 20)
+	{
+		// DXGI_FORMAT_BC1_UNORM(_SRGB) and DXGI_FORMAT_BC3_UNORM(_SRGB)
+		const uint32_t dxgiFormat = readValue<uint32_t>(bytes, headerBytes);
+		dataOffset += 20;
+		if (dxgiFormat == 71 || dxgiFormat == 72)
+			format = BlockFormat::BC1;
+		else if (dxgiFormat == 77 || dxgiFormat == 78)
+			format = BlockFormat::BC3;
+		else
+		{
+			std::cerr << "Unsupported DXGI format " << dxgiFormat << " in: " << path << '\n';
+			return false;
+		}
+	}
+	else
+	{
+		std::cerr << "Unsupported DDS pixel format in: " << path << '\n';
+		return false;
+	}
+
+	// levels are stored back to back, largest first
+	image.format = format;
+	image.width = width;
+	image.height = height;
+	image.levelOffsets.clear();
+	uint64_t totalBytes = 0;
+	for (int level = 0; level < levelCount; ++level)
+	{
+		const int levelWidth = std::max(1, width >> level);
+		const int levelHeight = std::max(1, height >> level);
+		image.levelOffsets.push_back(totalBytes);
+		totalBytes += getLevelBytes(format, levelWidth, levelHeight);
+		if (levelWidth == 1 && levelHeight == 1) break;
+	}
+
+	if (totalBytes > bytes.size() - dataOffset)
+	{
+		std::cerr << "Truncated DDS file: " << path << '\n';
+		return false;
+	}
+
+	image.data.assign(bytes.begin() + static_cast<std::ptrdiff_t>(dataOffset),
+	                  bytes.begin() + static_cast<std::ptrdiff_t>(dataOffset + totalBytes));
+	return true;
+}
+
+bool loadKTX2(const std::string& path, CompressedImage& image)
+{
+	std::vector<uint8_t> bytes;
+	if (!readFile(path, bytes)) return false;
+
+	static constexpr uint8_t identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+	constexpr size_t levelIndexOffset = 80;
+	if (bytes.size() < levelIndexOffset || std::memcmp(bytes.data(), identifier, sizeof(identifier)) != 0)
+	{
+		std::cerr << "Not a KTX2 file: " << path << '\n';
+		return false;
+	}
+
+	// VK_FORMAT_BC1_RGB(A)_UNORM/SRGB_BLOCK and VK_FORMAT_BC3_UNORM/SRGB_BLOCK
+	const uint32_t vkFormat = readValue<uint32_t>(bytes, 12);
+	BlockFormat format;
+	if (vkFormat >= 131 && vkFormat <= 134)
+		format = BlockFormat::BC1;
+	else if (vkFormat == 137 || vkFormat == 138)
+		format = BlockFormat::BC3;
+	else
+	{
+		std::cerr << "Unsupported KTX2 format " << vkFormat << " in: " << path << '\n';
+		return false;
+	}
+
+	if (readValue<uint32_t>(bytes, 44) != 0)
+	{
+		std::cerr << "Supercompressed KTX2 files are not supported: " << path << '\n';
+		return false;
+	}
+
+	const int width = static_cast<int>(readValue<uint32_t>(bytes, 20));
+	const int height = static_cast<int>(readValue<uint32_t>(bytes, 24));
+	const int levelCount = std::max(1, static_cast<int>(readValue<uint32_t>(bytes, 40)));
+	validateDimensions(path, width, height);
+
+	if (bytes.size() < levelIndexOffset + static_cast<size_t>(levelCount) * 24)
+	{
+		std::cerr << "Truncated KTX2 level index: " << path << '\n';
+		return false;
+	}
+
+	// the level index points anywhere in the file, so levels are packed largest first
+	image.format = format;
+	image.width = width;
+	image.height = height;
+	image.levelOffsets.clear();
+	image.data.clear();
+	for (int level = 0; level < levelCount; ++level)
+	{
+		const int levelWidth = std::max(1, width >> level);
+		const int levelHeight = std::max(1, height >> level);
+		const uint64_t expectedBytes = getLevelBytes(format, levelWidth, levelHeight);
+		const size_t entry = levelIndexOffset + static_cast<size_t>(level) * 24;
+		const uint64_t byteOffset = readValue<uint64_t>(bytes, entry);
+		const uint64_t byteLength = readValue<uint64_t>(bytes, entry + 8);
+
+		// compared without adding to the offset, which can wrap for a bogus index entry
+		if (byteLength < expectedBytes || byteOffset > bytes.size() || expectedBytes > bytes.size() - byteOffset)
+		{
+			std::cerr << "Truncated KTX2 mip level " << level << " in: " << path << '\n';
+			return false;
+		}
+
+		image.levelOffsets.push_back(image.data.size());
+		image.data.insert(image.data.end(), bytes.begin() + static_cast<std::ptrdiff_t>(byteOffset),
+		                  bytes.begin() + static_cast<std::ptrdiff_t>(byteOffset + expectedBytes));
+		if (levelWidth == 1 && levelHeight == 1) break;
+	}
+
+	return true;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "AlignedAllocator.h"
+
+enum class BlockFormat
+{
+	BC1, // rgb with 1-bit alpha, 8 bytes per 4x4 block
+	BC3 // rgb with interpolated alpha, 16 bytes per 4x4 block
+};
+
+constexpr size_t getBlockBytes(const BlockFormat format)
+{
+	return format == BlockFormat::BC1 ? 8 : 16;
+}
+
+// mip chain of 4x4 blocks in row-major block order, exactly as stored in DDS and KTX2 files
+struct CompressedImage
+{
+	BlockFormat format = BlockFormat::BC1;
+	int width = 0;
+	int height = 0;
+	std::vector<size_t> levelOffsets; // byte offset of each mip level into data
+	std::vector<uint8_t, AlignedAllocator<uint8_t, 64>> data;
+};
+
+// decode one block into 16 RGBA8 texels (r | g << 8 | b << 16 | a << 24), row by row
+void decodeBC1Block(const uint8_t* block, uint32_t* texels);
+void decodeBC3Block(const uint8_t* block, uint32_t* texels);
+
+// DDS with DXT1/DXT5 or a DX10 header, KTX2 with BC1/BC3 formats and no supercompression;
+// return false with a message on stderr when the file cannot be used
+bool loadDDS(const std::string& path, CompressedImage& image);
+bool loadKTX2(const std::string& path, CompressedImage& image);
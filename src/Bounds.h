@@ -0,0 +1,144 @@
+#pragma once
+#include <array>
+#include <cmath>
+#include <algorithm>
+#include <glm/glm.hpp>
+
+struct BoundingBox
+{
+	glm::vec3 min = glm::vec3(0.0f);
+	glm::vec3 max = glm::vec3(0.0f);
+
+	glm::vec3 getCenter() const { return (min + max) * 0.5f; }
+	glm::vec3 getExtents() const { return (max - min) * 0.5f; }
+
+	// axis-aligned box enclosing this box after transformation
+	BoundingBox transformed(const glm::mat4& matrix) const
+	{
+		const glm::vec3 center = getCenter();
+		const glm::vec3 extents = getExtents();
+
+		const glm::vec4 newCenter = matrix * glm::vec4(center, 1.0f);
+		glm::vec3 newExtents(0.0f);
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			newExtents[axis] = std::abs(matrix[0][axis]) * extents.x +
+				std::abs(matrix[1][axis]) * extents.y +
+				std::abs(matrix[2][axis]) * extents.z;
+		}
+
+		const glm::vec3 c(newCenter.x, newCenter.y, newCenter.z);
+		return {c - newExtents, c + newExtents};
+	}
+};
+
+struct BoundingSphere
+{
+	glm::vec3 center = glm::vec3(0.0f);
+	float radius = 0.0f;
+
+	BoundingSphere transformed(const glm::mat4& matrix) const
+	{
+		const glm::vec4 newCenter = matrix * glm::vec4(center, 1.0f);
+
+		// scale radius by the largest axis scale
+		const float scaleX = glm::length(glm::vec3(matrix[0][0], matrix[0][1], matrix[0][2]));
+		const float scaleY = glm::length(glm::vec3(matrix[1][0], matrix[1][1], matrix[1][2]));
+		const float scaleZ = glm::length(glm::vec3(matrix[2][0], matrix[2][1], matrix[2][2]));
+
+		return {glm::vec3(newCenter.x, newCenter.y, newCenter.z), radius * std::max({scaleX, scaleY, scaleZ})};
+	}
+};
+
+// six inward-facing planes (normal.xyz, distance.w): left, right, bottom, top, near, far
+struct Frustum
+{
+	std::array<glm::vec4, 6> planes;
+
+	// planes from the rows of a view-projection matrix (Gribb/Hartmann)
+	static Frustum fromMatrix(const glm::mat4& viewProjection, const bool reverseZ)
+	{
+		auto row = [&](const int i)
+		{
+			return glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+		};
+
+		const glm::vec4 x = row(0);
+		const glm::vec4 y = row(1);
+		const glm::vec4 z = row(2);
+		const glm::vec4 w = row(3);
+
+		// [-1,1] depth has near z >= -w, far z <= w; reverse-Z [0,1] has near z <= w, far z >= 0
+		Frustum frustum;
+		frustum.planes = {
+			w + x, w - x,
+			w + y, w - y,
+			reverseZ ? w - z : w + z,
+			reverseZ ? z : w - z
+		};
+
+		frustum.normalize();
+		return frustum;
+	}
+
+	// sub-frustum through an NDC rectangle, bounded by clip-space w (view depth for perspective) in [nearW, farW]
+	static Frustum fromTile(const glm::mat4& viewProjection, const glm::vec2& ndcMin, const glm::vec2& ndcMax,
+	                        const float nearW, const float farW)
+	{
+		auto row = [&](const int i)
+		{
+			return glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+		};
+
+		const glm::vec4 x = row(0);
+		const glm::vec4 y = row(1);
+		const glm::vec4 w = row(3);
+
+		Frustum frustum;
+		frustum.planes = {
+			x - w * ndcMin.x, w * ndcMax.x - x,
+			y - w * ndcMin.y, w * ndcMax.y - y,
+			w - glm::vec4(0.0f, 0.0f, 0.0f, nearW),
+			glm::vec4(0.0f, 0.0f, 0.0f, farW) - w
+		};
+
+		frustum.normalize();
+		return frustum;
+	}
+
+	void normalize()
+	{
+		for (glm::vec4& plane : planes)
+		{
+			const float length = glm::length(glm::vec3(plane.x, plane.y, plane.z));
+			if (length > 0.0f)
+				plane = plane * (1.0f / length);
+		}
+	}
+
+	bool intersects(const BoundingSphere& sphere) const
+	{
+		for (const glm::vec4& plane : planes)
+		{
+			if (glm::dot(glm::vec3(plane.x, plane.y, plane.z), sphere.center) + plane.w < -sphere.radius)
+				return false;
+		}
+		return true;
+	}
+
+	bool intersects(const BoundingBox& box) const
+	{
+		const glm::vec3 center = box.getCenter();
+		const glm::vec3 extents = box.getExtents();
+
+		for (const glm::vec4& plane : planes)
+		{
+			// projected radius of the box onto the plane normal
+			const float radius = std::abs(plane.x) * extents.x + std::abs(plane.y) * extents.y +
+				std::abs(plane.z) * extents.z;
+			if (glm::dot(glm::vec3(plane.x, plane.y, plane.z), center) + plane.w < -radius)
+				return false;
+		}
+		return true;
+	}
+};
@@ -56,12 +56,27 @@ void Camera::updateViewMatrix()
 
 	mViewMatrix = glm::lookAt(mPosition, mPosition + mFront, mUp);
 	mViewProjectionMatrix = mProjectionMatrix * mViewMatrix;
+	updateFrustum();
 }
 
 void Camera::updateProjectionMatrix()
 {
 	mProjectionMatrix = glm::perspective(glm::radians(mFov), mAspectRatio, mNearPlane, mFarPlane);
+
+	if (mReverseZ)
+	{
+		// z_clip = n*(f + z_view)/(f - n), so z/w is 1 at the near plane and 0 at the far plane
+		mProjectionMatrix[2][2] = mNearPlane / (mFarPlane - mNearPlane);
+		mProjectionMatrix[3][2] = mFarPlane * mNearPlane / (mFarPlane - mNearPlane);
+	}
+
 	mViewProjectionMatrix = mProjectionMatrix * mViewMatrix;
+	updateFrustum();
+}
+
+void Camera::updateFrustum()
+{
+	mFrustum = Frustum::fromMatrix(mViewProjectionMatrix, mReverseZ);
 }
 
 void Camera::setPosition(const glm::vec3& position)
@@ -117,3 +132,9 @@ void Camera::setProjectionParams(const float aspectRatio, const float nearPlane,
 	mFarPlane = farPlane;
 	updateProjectionMatrix();
 }
+
+void Camera::setReverseZ(const bool reverseZ)
+{
+	mReverseZ = reverseZ;
+	updateProjectionMatrix();
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include "glm/vec3.hpp"
 #include "glm/mat4x4.hpp"
+#include "Bounds.h"
 
 class Camera
 {
@@ -18,10 +19,12 @@ public:
 	void setDirection(float yaw, float pitch);
 	void setFov(float fov);
 	void setProjectionParams(float aspectRatio, float nearPlane, float farPlane);
+	void setReverseZ(bool reverseZ);
 
 	const glm::mat4& getViewMatrix() const { return mViewMatrix; }
 	const glm::mat4& getProjectionMatrix() const { return mProjectionMatrix; }
 	const glm::mat4& getViewProjectionMatrix() const { return mViewProjectionMatrix; }
+	const Frustum& getFrustum() const { return mFrustum; }
 
 	const glm::vec3& getPosition() const { return mPosition; }
 	const glm::vec3& getFront() const { return mFront; }
@@ -31,10 +34,12 @@ public:
 	float getYaw() const { return mYaw; }
 	float getPitch() const { return mPitch; }
 	float getFov() const { return mFov; }
+	bool isReverseZ() const { return mReverseZ; }
 
 private:
 	void updateViewMatrix();
 	void updateProjectionMatrix();
+	void updateFrustum();
 
 	glm::vec3 mPosition;
 	glm::vec3 mFront;
@@ -51,7 +56,11 @@ private:
 	float mNearPlane;
 	float mFarPlane;
 
+	// maps near to depth 1 and far to 0 in a [0,1] clip range
+	bool mReverseZ = false;
+
 	glm::mat4 mViewMatrix;
 	glm::mat4 mProjectionMatrix;
 	glm::mat4 mViewProjectionMatrix;
+	Frustum mFrustum;
 };
@@ -1,38 +1,311 @@
 #include "Framebuffer.h"
 #include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <cstring>
+#include <execution>
+#include <numeric>
 #include <stdexcept>
-#include <smmintrin.h>
+#include <immintrin.h>
 
 
-Framebuffer::Framebuffer(const int w, const int h)
+// window-space depth [0,1] to 16-bit unorm
+static __m128i quantizeDepth16(const __m128 depth)
+{
+	const __m128 clamped = _mm_min_ps(_mm_max_ps(depth, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+	return _mm_cvtps_epi32(_mm_mul_ps(clamped, _mm_set1_ps(65535.0f)));
+}
+
+Framebuffer::Framebuffer(const int w, const int h, const DepthFormat depthFormat, const bool hasColor)
 	: mWidth(w)
 	  , mHeight(h)
+	  , mDepthFormat(depthFormat)
 {
 	if (w <= 0 || h <= 0)
 	{
 		throw std::invalid_argument("Framebuffer dimensions must be positive");
 	}
+	resetViewport();
+
+	// allocate rgb buffer (3 bytes/pixel) and depth buffer, padded so a quad starting
+	// at the last pixel can still be loaded as a whole
+	if (hasColor)
+		mPixels.resize(static_cast<size_t>(mWidth) * mHeight * 3, 0);
+	allocateDepth();
+}
 
-	// allocate rgb buffer (3 bytes/pixel) and depth buffer
-	mPixels.resize(static_cast<size_t>(mWidth) * mHeight * 3, 0);
-	mDepthBuffer.resize(static_cast<size_t>(mWidth) * mHeight, 1.0f);
+void Framebuffer::allocateDepth()
+{
+	const size_t size = getPlaneOffset(mSampleCount) + 3;
+	if (mDepthFormat == DepthFormat::Unorm16)
+		mDepthBuffer16.assign(size, mReverseZ ? 0 : 0xFFFF);
+	else
+		mDepthBuffer.assign(size, getDepthClearValue());
+}
+
+// calls span(first, count) for the viewport's run of pixels in every row
+template <typename Span>
+static void forEachViewportRow(const Viewport& viewport, const int width, Span&& span)
+{
+	for (int y = viewport.y; y < viewport.y + viewport.height; ++y)
+		span(static_cast<size_t>(y) * width + viewport.x, static_cast<size_t>(viewport.width));
 }
 
 void Framebuffer::clear()
 {
-	std::ranges::fill(mPixels, 0);
+	if (isViewportFull())
+	{
+		std::ranges::fill(mPixels, 0);
+		std::ranges::fill(mSampleColors, 0);
+		return;
+	}
+
+	forEachViewportRow(mViewport, mWidth, [&](const size_t first, const size_t count)
+	{
+		if (hasColor())
+			std::fill_n(mPixels.begin() + first * 3, count * 3, 0);
+		if (!mSampleColors.empty())
+			for (int sample = 0; sample < mSampleCount; ++sample)
+				std::fill_n(mSampleColors.begin() + getPlaneOffset(sample) + first, count, 0);
+	});
 }
 
 void Framebuffer::clearDepth()
 {
-	std::ranges::fill(mDepthBuffer, 1.0f);
+	if (isViewportFull())
+	{
+		if (mDepthFormat == DepthFormat::Unorm16)
+			std::ranges::fill(mDepthBuffer16, mReverseZ ? 0 : 0xFFFF);
+		else
+			std::ranges::fill(mDepthBuffer, getDepthClearValue());
+		return;
+	}
+
+	forEachViewportRow(mViewport, mWidth, [&](const size_t first, const size_t count)
+	{
+		for (int sample = 0; sample < mSampleCount; ++sample)
+		{
+			if (mDepthFormat == DepthFormat::Unorm16)
+				std::fill_n(mDepthBuffer16.begin() + getPlaneOffset(sample) + first, count, mReverseZ ? 0 : 0xFFFF);
+			else
+				std::fill_n(mDepthBuffer.begin() + getPlaneOffset(sample) + first, count, getDepthClearValue());
+		}
+	});
+}
+
+void Framebuffer::setReverseZ(const bool reverseZ)
+{
+	mReverseZ = reverseZ;
+	// the whole buffer, depth outside the viewport would be stale under the other convention
+	allocateDepth();
+}
+
+void Framebuffer::setSampleCount(const int sampleCount)
+{
+	if (sampleCount != 1 && sampleCount != 4)
+	{
+		throw std::invalid_argument("Framebuffers support 1 or 4 samples per pixel");
+	}
+
+	mSampleCount = sampleCount;
+	allocateDepth();
+
+	if (sampleCount > 1 && hasColor())
+		mSampleColors.assign(getPlaneOffset(sampleCount), 0);
+	else
+		mSampleColors.clear();
+	clear();
+}
+
+void Framebuffer::resolve()
+{
+	if (mSampleCount == 1 || !hasColor()) return;
+
+	if (isViewportFull())
+		resolvePixels(0, getPlaneOffset(1));
+	else
+		forEachViewportRow(mViewport, mWidth, [&](const size_t first, const size_t count)
+		{
+			resolvePixels(first, count);
+		});
 }
 
+void Framebuffer::resolvePixels(const size_t first, const size_t count)
+{
+	const size_t end = first + count;
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i round = _mm_set1_epi16(2);
+
+	// drops the alpha byte of four packed pixels, leaving 12 RGB bytes
+	const __m128i toRGB = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+
+	size_t i = first;
+	for (; i + 4 <= end; i += 4)
+	{
+		// box filter of the four samples in 16-bit lanes
+		__m128i sumLo = zero;
+		__m128i sumHi = zero;
+		for (int sample = 0; sample < 4; ++sample)
+		{
+			const __m128i colors = _mm_loadu_si128(
+				reinterpret_cast<const __m128i*>(mSampleColors.data() + getPlaneOffset(sample) + i));
+			sumLo = _mm_add_epi16(sumLo, _mm_unpacklo_epi8(colors, zero));
+			sumHi = _mm_add_epi16(sumHi, _mm_unpackhi_epi8(colors, zero));
+		}
+		sumLo = _mm_srli_epi16(_mm_add_epi16(sumLo, round), 2);
+		sumHi = _mm_srli_epi16(_mm_add_epi16(sumHi, round), 2);
+
+		alignas(16) uint8_t rgb[16];
+		_mm_store_si128(reinterpret_cast<__m128i*>(rgb), _mm_shuffle_epi8(_mm_packus_epi16(sumLo, sumHi), toRGB));
+		std::memcpy(mPixels.data() + i * 3, rgb, 12);
+	}
+
+	for (; i < end; ++i)
+	{
+		for (int channel = 0; channel < 3; ++channel)
+		{
+			uint32_t sum = 2;
+			for (int sample = 0; sample < 4; ++sample)
+				sum += (mSampleColors[getPlaneOffset(sample) + i] >> (channel * 8)) & 0xFF;
+			mPixels[i * 3 + channel] = static_cast<uint8_t>(sum >> 2);
+		}
+	}
+}
+
+void Framebuffer::setViewport(const Viewport& viewport)
+{
+	if (viewport.width <= 0 || viewport.height <= 0 || viewport.x < 0 || viewport.y < 0 ||
+		viewport.x + viewport.width > mWidth || viewport.y + viewport.height > mHeight)
+	{
+		throw std::invalid_argument("Viewport must be a non-empty rectangle inside the framebuffer");
+	}
+	mViewport = viewport;
+}
+
+// (a * (256 - weight) + b * weight) / 256, rounded, in 16-bit lanes
+static __m128i lerp16(const __m128i a, const __m128i b, const __m128i weight)
+{
+	const __m128i sum = _mm_add_epi16(_mm_mullo_epi16(a, _mm_sub_epi16(_mm_set1_epi16(256), weight)),
+	                                  _mm_mullo_epi16(b, weight));
+	return _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(128)), 8);
+}
+
+static uint32_t loadRGB(const uint8_t* pixel)
+{
+	return pixel[0] | pixel[1] << 8 | pixel[2] << 16;
+}
+
+void Framebuffer::upscale(Framebuffer& target) const
+{
+	assert(hasColor() && target.hasColor() && "Both framebuffers need a color buffer");
+
+	// source texel and 8-bit weight of every target column, pixel centres line up;
+	// padded to whole quads by repeating the last column
+	struct Tap
+	{
+		std::vector<int> first;
+		std::vector<int> second;
+		std::vector<uint16_t> weight;
+	};
+	const auto makeTaps = [](const int sourceSize, const int targetSize, const int padded)
+	{
+		Tap taps{std::vector<int>(padded), std::vector<int>(padded), std::vector<uint16_t>(padded)};
+		const float step = static_cast<float>(sourceSize) / targetSize;
+		for (int i = 0; i < padded; ++i)
+		{
+			const float position = std::clamp((std::min(i, targetSize - 1) + 0.5f) * step - 0.5f, 0.0f,
+			                                   static_cast<float>(sourceSize - 1));
+			const int first = static_cast<int>(position);
+			taps.first[i] = first;
+			taps.second[i] = std::min(first + 1, sourceSize - 1);
+			taps.weight[i] = static_cast<uint16_t>(std::lround((position - first) * 256.0f));
+		}
+		return taps;
+	};
+
+	const int targetWidth = target.getWidth();
+	const int targetHeight = target.getHeight();
+	const Tap columns = makeTaps(mViewport.width, targetWidth, (targetWidth + 3) & ~3);
+	const Tap rows = makeTaps(mViewport.height, targetHeight, targetHeight);
+
+	// drops the unused fourth byte of four pixels, leaving 12 RGB bytes
+	const __m128i toRGB = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+	const __m128i zero = _mm_setzero_si128();
+
+	std::vector<int> rowIndices(targetHeight);
+	std::iota(rowIndices.begin(), rowIndices.end(), 0);
+
+	std::for_each(std::execution::par, rowIndices.begin(), rowIndices.end(), [&](const int y)
+	{
+		const size_t stride = static_cast<size_t>(mWidth) * 3;
+		const uint8_t* top = mPixels.data() + (mViewport.y + rows.first[y]) * stride + mViewport.x * 3;
+		const uint8_t* bottom = mPixels.data() + (mViewport.y + rows.second[y]) * stride + mViewport.x * 3;
+		const __m128i weightY = _mm_set1_epi16(static_cast<short>(rows.weight[y]));
+		uint8_t* out = target.mPixels.data() + static_cast<size_t>(y) * targetWidth * 3;
+
+		for (int x = 0; x < targetWidth; x += 4)
+		{
+			alignas(16) uint32_t texels[4][4];
+			for (int i = 0; i < 4; ++i)
+			{
+				const int first = columns.first[x + i] * 3;
+				const int second = columns.second[x + i] * 3;
+				texels[0][i] = loadRGB(top + first);
+				texels[1][i] = loadRGB(top + second);
+				texels[2][i] = loadRGB(bottom + first);
+				texels[3][i] = loadRGB(bottom + second);
+			}
 
-void Framebuffer::setPixel(const __m128i x, const __m128i y, const __m128i color, const int mask)
+			// each pixel's column weight repeated over its four channels
+			const __m128i weights = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(columns.weight.data() + x));
+			const __m128i pairs = _mm_unpacklo_epi16(weights, weights);
+			const __m128i weightLo = _mm_unpacklo_epi32(pairs, pairs);
+			const __m128i weightHi = _mm_unpackhi_epi32(pairs, pairs);
+
+			__m128i half[2];
+			for (int h = 0; h < 2; ++h)
+			{
+				const auto widen = [&](const int row)
+				{
+					const __m128i texel = _mm_load_si128(reinterpret_cast<const __m128i*>(texels[row]));
+					return h == 0 ? _mm_unpacklo_epi8(texel, zero) : _mm_unpackhi_epi8(texel, zero);
+				};
+				const __m128i weightX = h == 0 ? weightLo : weightHi;
+				const __m128i upper = lerp16(widen(0), widen(1), weightX);
+				const __m128i lower = lerp16(widen(2), widen(3), weightX);
+				half[h] = lerp16(upper, lower, weightY);
+			}
+
+			alignas(16) uint8_t rgb[16];
+			_mm_store_si128(reinterpret_cast<__m128i*>(rgb), _mm_shuffle_epi8(_mm_packus_epi16(half[0], half[1]), toRGB));
+			std::memcpy(out + static_cast<size_t>(x) * 3, rgb, static_cast<size_t>(std::min(4, targetWidth - x)) * 3);
+		}
+	});
+}
+
+void Framebuffer::setPixel(const __m128i x, const __m128i y, const __m128i color, const int mask, const int sample)
 {
 	if (mask == 0) return;
+	assert(hasColor() && "Framebuffer has no color buffer");
+	assert(sample >= 0 && sample < mSampleCount && "Invalid sample index");
+
+	if (mSampleCount > 1)
+	{
+		alignas(16) int xs[4], ys[4];
+		alignas(16) uint32_t colors[4];
+		_mm_store_si128((__m128i*)xs, x);
+		_mm_store_si128((__m128i*)ys, y);
+		_mm_store_si128((__m128i*)colors, color);
+
+		uint32_t* plane = mSampleColors.data() + getPlaneOffset(sample);
+		for (int i = 0; i < 4; ++i)
+			if (mask & (1 << i))
+			{
+				assert(isInBounds(xs[i], ys[i]) && "Pixel coordinates out of bounds");
+				plane[static_cast<size_t>(ys[i]) * mWidth + xs[i]] = colors[i];
+			}
+		return;
+	}
 
 	alignas(16) int xs[4], ys[4];
 	alignas(16) uint8_t c[16];
@@ -57,10 +330,77 @@ void Framebuffer::setPixel(const __m128i x, const __m128i y, const __m128i color
 		}
 }
 
-void Framebuffer::setDepth(const __m128i xI, const __m128i yI, const __m128 depth, const int mask)
+// src * a + dst * (255 - a), divided by 255 with rounding, for two pixels in 16-bit lanes
+static __m128i blendPair(const __m128i src, const __m128i dst)
+{
+	const __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(src, 0xFF), 0xFF);
+	const __m128i inverseAlpha = _mm_sub_epi16(_mm_set1_epi16(255), alpha);
+	const __m128i sum = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(src, alpha), _mm_mullo_epi16(dst, inverseAlpha)),
+	                                  _mm_set1_epi16(128));
+	return _mm_srli_epi16(_mm_add_epi16(sum, _mm_srli_epi16(sum, 8)), 8);
+}
+
+void Framebuffer::blendPixel(const __m128i x, const __m128i y, const __m128i color, const int mask,
+                             const int sample)
+{
+	if (mask == 0) return;
+	assert(hasColor() && "Framebuffer has no color buffer");
+	assert(sample >= 0 && sample < mSampleCount && "Invalid sample index");
+
+	alignas(16) int xs[4], ys[4];
+	alignas(16) uint8_t c[16] = {};
+	_mm_store_si128((__m128i*)xs, x);
+	_mm_store_si128((__m128i*)ys, y);
+
+	// multisampled: packed samples of one plane, otherwise RGB pixels
+	uint32_t* plane = mSampleCount > 1 ? mSampleColors.data() + getPlaneOffset(sample) : nullptr;
+
+	size_t indices[4] = {};
+	for (int i = 0; i < 4; ++i)
+		if (mask & (1 << i))
+		{
+			assert(isInBounds(xs[i], ys[i]) && "Pixel coordinates out of bounds");
+			indices[i] = static_cast<size_t>(ys[i]) * mWidth + xs[i];
+			if (plane)
+			{
+				std::memcpy(c + i * 4, plane + indices[i], 4);
+				continue;
+			}
+			indices[i] *= 3;
+			c[i * 4] = mPixels[indices[i]];
+			c[i * 4 + 1] = mPixels[indices[i] + 1];
+			c[i * 4 + 2] = mPixels[indices[i] + 2];
+		}
+
+	const __m128i dst = _mm_load_si128((const __m128i*)c);
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i lo = blendPair(_mm_unpacklo_epi8(color, zero), _mm_unpacklo_epi8(dst, zero));
+	const __m128i hi = blendPair(_mm_unpackhi_epi8(color, zero), _mm_unpackhi_epi8(dst, zero));
+	_mm_store_si128((__m128i*)c, _mm_packus_epi16(lo, hi));
+
+	if (plane)
+	{
+		for (int i = 0; i < 4; ++i)
+			if (mask & (1 << i))
+				std::memcpy(plane + indices[i], c + i * 4, 4);
+		return;
+	}
+
+	for (int i = 0; i < 4; ++i)
+		if (mask & (1 << i))
+		{
+			mPixels[indices[i]] = c[i * 4]; // r
+			mPixels[indices[i] + 1] = c[i * 4 + 1]; // g
+			mPixels[indices[i] + 2] = c[i * 4 + 2]; // b
+		}
+}
+
+void Framebuffer::setDepth(const __m128i xI, const __m128i yI, const __m128 depth, const int mask, const int sample)
 {
 	assert(mask >= 0 && mask <= 0xF && "Invalid mask value");
+	assert(sample >= 0 && sample < mSampleCount && "Invalid sample index");
 	if (mask == 0) return;
+	const size_t planeOffset = getPlaneOffset(sample);
 
 	// fast path: all 4 pixels
 	if (mask == 0xF)
@@ -69,7 +409,16 @@ void Framebuffer::setDepth(const __m128i xI, const __m128i yI, const __m128 dept
 		const int y0 = _mm_cvtsi128_si32(yI);
 		assert(isInBounds(x0, y0) && isInBounds(x0 + 3, y0) && "Pixel coordinates out of bounds");
 
-		const size_t base = static_cast<size_t>(y0) * mWidth + x0;
+		const size_t base = planeOffset + static_cast<size_t>(y0) * mWidth + x0;
+		if (mDepthFormat == DepthFormat::Unorm16)
+		{
+			assert(base + 3 < mDepthBuffer16.size() && "Depth buffer index out of bounds");
+			const __m128i quantized = quantizeDepth16(depth);
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(mDepthBuffer16.data() + base),
+			                 _mm_packus_epi32(quantized, quantized));
+			return;
+		}
+
 		assert(base + 3 < mDepthBuffer.size() && "Depth buffer index out of bounds");
 		_mm_storeu_ps(mDepthBuffer.data() + base, depth);
 		return;
@@ -78,35 +427,89 @@ void Framebuffer::setDepth(const __m128i xI, const __m128i yI, const __m128 dept
 	// slow path: individual pixels
 	alignas(16) int xs[4], ys[4];
 	alignas(16) float ds[4];
+	alignas(16) int qs[4];
 	_mm_store_si128((__m128i*)xs, xI);
 	_mm_store_si128((__m128i*)ys, yI);
 	_mm_store_ps(ds, depth);
+	_mm_store_si128((__m128i*)qs, quantizeDepth16(depth));
 
 	for (int i = 0; i < 4; ++i)
 		if (mask & (1 << i))
 		{
 			assert(isInBounds(xs[i], ys[i]) && "Pixel coordinates out of bounds");
-			const size_t index = static_cast<size_t>(ys[i]) * mWidth + xs[i];
+			const size_t index = planeOffset + static_cast<size_t>(ys[i]) * mWidth + xs[i];
+			if (mDepthFormat == DepthFormat::Unorm16)
+			{
+				assert(index < mDepthBuffer16.size() && "Depth buffer index out of bounds");
+				mDepthBuffer16[index] = static_cast<uint16_t>(qs[i]);
+				continue;
+			}
 			assert(index < mDepthBuffer.size() && "Depth buffer index out of bounds");
 			mDepthBuffer[index] = ds[i];
 		}
 }
 
-int Framebuffer::depthTest(const __m128i x, const __m128i y, const __m128 depth) const
+int Framebuffer::depthTest(const __m128i x, const __m128i y, const __m128 depth, const int sample) const
 {
+	assert(sample >= 0 && sample < mSampleCount && "Invalid sample index");
+
 	// calculate buffer indices: y * width + x
 	const __m128i idxVec = _mm_add_epi32(_mm_mullo_epi32(y, _mm_set1_epi32(mWidth)), x);
 
 	alignas(16) int idxArr[4];
 	_mm_store_si128((__m128i*)idxArr, idxVec);
-	// validate indices for internal consistency
-	for (int i = 0; i < 4; ++i)
-		assert(
-		idxArr[i] >= 0 && static_cast<size_t>(idxArr[i]) < mDepthBuffer.size() && "Depth buffer index out of bounds");
+	// lanes past the end of a row are masked off by the caller
+	assert(
+		idxArr[0] >= 0 && static_cast<size_t>(idxArr[0]) < static_cast<size_t>(mWidth) * mHeight &&
+		"Depth buffer index out of bounds");
+	const size_t base = getPlaneOffset(sample) + idxArr[0];
+
+	if (mDepthFormat == DepthFormat::Unorm16)
+	{
+		// widen 4 stored values to 32-bit lanes and compare as integers
+		const __m128i curr = _mm_cvtepu16_epi32(
+			_mm_loadl_epi64(reinterpret_cast<const __m128i*>(mDepthBuffer16.data() + base)));
+		const __m128i quantized = quantizeDepth16(depth);
+		const __m128i cmp = mReverseZ ? _mm_cmpgt_epi32(quantized, curr) : _mm_cmplt_epi32(quantized, curr);
+		return _mm_movemask_ps(_mm_castsi128_ps(cmp));
+	}
 
-	const __m128 curr = _mm_loadu_ps(mDepthBuffer.data() + idxArr[0]);
+	const __m128 curr = _mm_loadu_ps(mDepthBuffer.data() + base);
 
-	// depth test
-	const __m128 cmp = _mm_cmplt_ps(depth, curr);
+	// depth test (closer is smaller, or greater with reverse-Z)
+	const __m128 cmp = mReverseZ ? _mm_cmpgt_ps(depth, curr) : _mm_cmplt_ps(depth, curr);
 	return _mm_movemask_ps(cmp);
 }
+
+float Framebuffer::getDepth(const int x, const int y) const
+{
+	assert(isInBounds(x, y) && "Pixel coordinates out of bounds");
+
+	const size_t index = static_cast<size_t>(y) * mWidth + x;
+	if (mDepthFormat == DepthFormat::Unorm16)
+		return static_cast<float>(mDepthBuffer16[index]) * (1.0f / 65535.0f);
+	return mDepthBuffer[index];
+}
+
+__m128 Framebuffer::gatherDepth(const __m128i x, const __m128i y) const
+{
+	const __m128i index = _mm_add_epi32(_mm_mullo_epi32(y, _mm_set1_epi32(mWidth)), x);
+
+	if (mDepthFormat == DepthFormat::Float32)
+	{
+#ifdef __AVX2__
+		return _mm_i32gather_ps(mDepthBuffer.data(), index, 4);
+#else
+		alignas(16) int indices[4];
+		_mm_store_si128(reinterpret_cast<__m128i*>(indices), index);
+		return _mm_setr_ps(mDepthBuffer[indices[0]], mDepthBuffer[indices[1]],
+		                   mDepthBuffer[indices[2]], mDepthBuffer[indices[3]]);
+#endif
+	}
+
+	alignas(16) int indices[4];
+	_mm_store_si128(reinterpret_cast<__m128i*>(indices), index);
+	const __m128i stored = _mm_setr_epi32(mDepthBuffer16[indices[0]], mDepthBuffer16[indices[1]],
+	                                      mDepthBuffer16[indices[2]], mDepthBuffer16[indices[3]]);
+	return _mm_mul_ps(_mm_cvtepi32_ps(stored), _mm_set1_ps(1.0f / 65535.0f));
+}
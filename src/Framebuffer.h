@@ -3,29 +3,93 @@
 #include <vector>
 #include <cstdint>
 
+enum class DepthFormat
+{
+	Float32,
+	Unorm16
+};
+
+// pixel rectangle the renderer draws into
+struct Viewport
+{
+	int x = 0;
+	int y = 0;
+	int width = 0;
+	int height = 0;
+};
+
 class Framebuffer
 {
 public:
-	Framebuffer(int w, int h);
+	// depth-only framebuffers (hasColor false) allocate no color buffer, e.g. for shadow maps
+	Framebuffer(int w, int h, DepthFormat depthFormat = DepthFormat::Float32, bool hasColor = true);
 
+	// both clear only the viewport, in every sample plane
 	void clear();
 	void clearDepth();
 
-	void setPixel(__m128i x, __m128i y, __m128i color, int mask);
-	void setDepth(__m128i x, __m128i y, __m128 depth, int mask);
-	int depthTest(__m128i x, __m128i y, __m128 depth) const;
+	// reverse-Z clears depth to 0 and keeps fragments with greater depth
+	void setReverseZ(bool reverseZ);
+
+	// 1 or 4, also clears. Multisampled framebuffers keep color and depth per sample,
+	// the color buffer only holds the viewport's image once resolve() has averaged the samples
+	void setSampleCount(int sampleCount);
+	void resolve();
+
+	// rendering is confined to the viewport and NDC maps onto it, the whole framebuffer by default
+	void setViewport(const Viewport& viewport);
+	void resetViewport() { mViewport = {0, 0, mWidth, mHeight}; }
+	const Viewport& getViewport() const { return mViewport; }
+	bool isViewportFull() const { return mViewport.width == mWidth && mViewport.height == mHeight; }
+
+	// bilinear scale of the viewport's colors onto the whole of target's color buffer
+	void upscale(Framebuffer& target) const;
+
+	// sample selects the sample of every pixel to access in a multisampled framebuffer
+	void setPixel(__m128i x, __m128i y, __m128i color, int mask, int sample = 0);
+	// source-over blend of four RGBA colors by their alpha
+	void blendPixel(__m128i x, __m128i y, __m128i color, int mask, int sample = 0);
+	void setDepth(__m128i x, __m128i y, __m128 depth, int mask, int sample = 0);
+	int depthTest(__m128i x, __m128i y, __m128 depth, int sample = 0) const;
+
+	// first sample when multisampled
+	float getDepth(int x, int y) const;
+
+	// window-space depth at four arbitrary in-bounds pixels
+	__m128 gatherDepth(__m128i x, __m128i y) const;
 
 	int getWidth() const { return mWidth; }
 	int getHeight() const { return mHeight; }
+	DepthFormat getDepthFormat() const { return mDepthFormat; }
+	bool isReverseZ() const { return mReverseZ; }
+	int getSampleCount() const { return mSampleCount; }
+	bool hasColor() const { return !mPixels.empty(); }
 	const uint8_t* getColorBuffer() const { return mPixels.data(); }
 	const float* getDepthBuffer() const { return mDepthBuffer.data(); }
+	const uint16_t* getDepthBuffer16() const { return mDepthBuffer16.data(); }
 
 private:
 	int mWidth;
 	int mHeight;
+	DepthFormat mDepthFormat;
+	bool mReverseZ = false;
+	int mSampleCount = 1;
+	Viewport mViewport;
 
 	std::vector<uint8_t> mPixels;
-	std::vector<float> mDepthBuffer;
+	std::vector<uint32_t> mSampleColors; // packed RGBA, one plane per sample, multisampled only
+	std::vector<float> mDepthBuffer; // one plane per sample
+	std::vector<uint16_t> mDepthBuffer16;
+
+	float getDepthClearValue() const { return mReverseZ ? 0.0f : 1.0f; }
+
+	void allocateDepth();
+	void resolvePixels(size_t first, size_t count);
+
+	size_t getPlaneOffset(const int sample) const
+	{
+		return static_cast<size_t>(sample) * mWidth * mHeight;
+	}
 
 	bool isInBounds(const int x, const int y) const
 	{
@@ -0,0 +1,134 @@
+#include "GBuffer.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+GBuffer::GBuffer(const int w, const int h)
+	: mWidth(w)
+	  , mHeight(h)
+	  , mTileCountX((w + TILE_SIZE - 1) / TILE_SIZE)
+{
+	if (w <= 0 || h <= 0)
+	{
+		throw std::invalid_argument("G-buffer dimensions must be positive");
+	}
+
+	// whole tiles, so every tile row holds TILE_SIZE pixels
+	const int tileCountY = (h + TILE_SIZE - 1) / TILE_SIZE;
+	const size_t pixelCount = static_cast<size_t>(mTileCountX) * tileCountY * TILE_SIZE * TILE_SIZE;
+	mNormals.resize(pixelCount, 0);
+	mAlbedo.resize(pixelCount, 0);
+	mMaterialIds.resize(pixelCount, 0);
+}
+
+void GBuffer::clear()
+{
+	std::ranges::fill(mMaterialIds, 0);
+	mMaterials.clear();
+}
+
+uint8_t GBuffer::addMaterial(const Material* material)
+{
+	const auto found = std::ranges::find(mMaterials, material);
+	if (found != mMaterials.end())
+		return static_cast<uint8_t>(found - mMaterials.begin() + 1);
+
+	if (mMaterials.size() == UINT8_MAX)
+	{
+		throw std::length_error("G-buffer holds at most 255 materials per frame");
+	}
+
+	mMaterials.push_back(material);
+	return static_cast<uint8_t>(mMaterials.size());
+}
+
+void GBuffer::store(const __m128i x, const __m128i y, const __m128 normalX, const __m128 normalY,
+                    const __m128 normalZ, const __m128i albedo, const uint8_t materialId, const int mask)
+{
+	assert(mask >= 0 && mask <= 0xF && "Invalid mask value");
+	assert(materialId != 0 && "Material id 0 marks empty pixels");
+	if (mask == 0) return;
+
+	const __m128i normals = encodeNormal(normalX, normalY, normalZ);
+
+	// fast path: all 4 pixels, consecutive since the quad lies in one tile row
+	if (mask == 0xF)
+	{
+		const int x0 = _mm_cvtsi128_si32(x);
+		const int y0 = _mm_cvtsi128_si32(y);
+		assert(x0 % TILE_SIZE + 3 < TILE_SIZE && "Quad crosses a tile boundary");
+
+		const size_t index = getIndex(x0, y0);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(mNormals.data() + index), normals);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(mAlbedo.data() + index), albedo);
+		std::memset(mMaterialIds.data() + index, materialId, 4);
+		return;
+	}
+
+	// slow path: individual pixels
+	alignas(16) int xs[4], ys[4];
+	alignas(16) uint32_t ns[4], as[4];
+	_mm_store_si128(reinterpret_cast<__m128i*>(xs), x);
+	_mm_store_si128(reinterpret_cast<__m128i*>(ys), y);
+	_mm_store_si128(reinterpret_cast<__m128i*>(ns), normals);
+	_mm_store_si128(reinterpret_cast<__m128i*>(as), albedo);
+
+	for (int i = 0; i < 4; ++i)
+		if (mask & (1 << i))
+		{
+			assert(xs[i] >= 0 && xs[i] < mWidth && ys[i] >= 0 && ys[i] < mHeight && "Pixel coordinates out of bounds");
+			const size_t index = getIndex(xs[i], ys[i]);
+			mNormals[index] = ns[i];
+			mAlbedo[index] = as[i];
+			mMaterialIds[index] = materialId;
+		}
+}
+
+__m128i GBuffer::encodeNormal(const __m128 x, const __m128 y, const __m128 z)
+{
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+	const __m128 one = _mm_set1_ps(1.0f);
+
+	// project onto the octahedron |x| + |y| + |z| = 1
+	const __m128 absX = _mm_andnot_ps(signMask, x);
+	const __m128 absY = _mm_andnot_ps(signMask, y);
+	const __m128 absZ = _mm_andnot_ps(signMask, z);
+	const __m128 invL1 = _mm_div_ps(one, _mm_max_ps(_mm_add_ps(_mm_add_ps(absX, absY), absZ), _mm_set1_ps(1e-20f)));
+	__m128 octX = _mm_mul_ps(x, invL1);
+	__m128 octY = _mm_mul_ps(y, invL1);
+
+	// fold the lower hemisphere over the diagonals
+	const __m128 foldX = _mm_or_ps(_mm_sub_ps(one, _mm_andnot_ps(signMask, octY)), _mm_and_ps(octX, signMask));
+	const __m128 foldY = _mm_or_ps(_mm_sub_ps(one, _mm_andnot_ps(signMask, octX)), _mm_and_ps(octY, signMask));
+	const __m128 lower = _mm_cmplt_ps(z, _mm_setzero_ps());
+	octX = _mm_blendv_ps(octX, foldX, lower);
+	octY = _mm_blendv_ps(octY, foldY, lower);
+
+	const __m128 scale = _mm_set1_ps(32767.0f);
+	const __m128i snormX = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(octX, _mm_set1_ps(-1.0f)), one), scale));
+	const __m128i snormY = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(octY, _mm_set1_ps(-1.0f)), one), scale));
+	return _mm_or_si128(_mm_and_si128(snormX, _mm_set1_epi32(0xFFFF)), _mm_slli_epi32(snormY, 16));
+}
+
+void GBuffer::decodeNormal(const __m128i encoded, __m128& x, __m128& y, __m128& z)
+{
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+	const __m128 invScale = _mm_set1_ps(1.0f / 32767.0f);
+
+	// sign-extend both halves
+	x = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(encoded, 16), 16)), invScale);
+	y = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(encoded, 16)), invScale);
+	z = _mm_sub_ps(_mm_sub_ps(_mm_set1_ps(1.0f), _mm_andnot_ps(signMask, x)), _mm_andnot_ps(signMask, y));
+
+	// unfold the lower hemisphere, moving x and y towards zero by -z
+	const __m128 t = _mm_max_ps(_mm_sub_ps(_mm_setzero_ps(), z), _mm_setzero_ps());
+	x = _mm_sub_ps(x, _mm_or_ps(t, _mm_and_ps(x, signMask)));
+	y = _mm_sub_ps(y, _mm_or_ps(t, _mm_and_ps(y, signMask)));
+
+	const __m128 invLength = _mm_div_ps(_mm_set1_ps(1.0f),
+	                                    _mm_sqrt_ps(_mm_fmadd_ps(x, x, _mm_fmadd_ps(y, y, _mm_mul_ps(z, z)))));
+	x = _mm_mul_ps(x, invLength);
+	y = _mm_mul_ps(y, invLength);
+	z = _mm_mul_ps(z, invLength);
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <immintrin.h>
+#include <cstdint>
+#include <vector>
+
+class Material;
+
+// surface attributes for deferred shading, written by Renderer::renderModelDeferred and shaded
+// by Renderer::resolveDeferred. Pixels are stored tile by tile so one tile's samples stay
+// contiguous while it is shaded; depth stays in the framebuffer.
+class GBuffer
+{
+public:
+	static constexpr int TILE_SIZE = 16;
+
+	GBuffer(int w, int h);
+
+	// empties every pixel and forgets the materials of the previous frame
+	void clear();
+
+	// 1-based id of the material for this frame, 0 marks pixels nothing was drawn to
+	uint8_t addMaterial(const Material* material);
+	const Material* getMaterial(const uint8_t id) const { return mMaterials[id - 1]; }
+	size_t getMaterialCount() const { return mMaterials.size(); }
+
+	// four horizontally adjacent pixels within one tile row
+	void store(__m128i x, __m128i y, __m128 normalX, __m128 normalY, __m128 normalZ, __m128i albedo,
+	           uint8_t materialId, int mask);
+
+	// index of pixel (x, y) in the per-pixel arrays, consecutive along a tile row
+	size_t getIndex(const int x, const int y) const
+	{
+		const size_t tile = static_cast<size_t>(y / TILE_SIZE) * mTileCountX + x / TILE_SIZE;
+		return tile * (TILE_SIZE * TILE_SIZE) + (y % TILE_SIZE) * TILE_SIZE + x % TILE_SIZE;
+	}
+
+	int getWidth() const { return mWidth; }
+	int getHeight() const { return mHeight; }
+	const uint32_t* getNormals() const { return mNormals.data(); }
+	const uint32_t* getAlbedo() const { return mAlbedo.data(); }
+	const uint8_t* getMaterialIds() const { return mMaterialIds.data(); }
+
+	// octahedral normal, x and y as 16-bit snorm in the low and high half
+	static __m128i encodeNormal(__m128 x, __m128 y, __m128 z);
+	static void decodeNormal(__m128i encoded, __m128& x, __m128& y, __m128& z);
+
+private:
+	int mWidth;
+	int mHeight;
+	int mTileCountX;
+
+	std::vector<uint32_t> mNormals;
+	std::vector<uint32_t> mAlbedo; // packed RGB, before lighting
+	std::vector<uint8_t> mMaterialIds;
+
+	std::vector<const Material*> mMaterials;
+};
@@ -0,0 +1,100 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <glm/glm.hpp>
+#include "Bounds.h"
+#include "ShadowMap.h"
+
+enum class LightType
+{
+	Directional,
+	Point,
+	Spot
+};
+
+struct Light
+{
+	LightType type = LightType::Point;
+	glm::vec3 position = glm::vec3(0.0f); // point and spot
+	glm::vec3 direction = glm::vec3(0.0f, -1.0f, 0.0f); // direction the light travels, directional and spot
+	glm::vec3 color = glm::vec3(1.0f);
+	float intensity = 1.0f;
+	float range = 10.0f; // point and spot lights fall off to nothing at this distance
+
+	// spot cone half-angles in degrees, full intensity inside the inner cone
+	float innerConeAngle = 20.0f;
+	float outerConeAngle = 30.0f;
+
+	// rendered by the caller with Renderer::renderShadowMap, unshadowed when null
+	std::shared_ptr<const ShadowMap> shadowMap;
+
+	static Light directional(const glm::vec3& direction, const glm::vec3& color = glm::vec3(1.0f),
+	                         const float intensity = 1.0f)
+	{
+		Light light;
+		light.type = LightType::Directional;
+		light.direction = direction;
+		light.color = color;
+		light.intensity = intensity;
+		return light;
+	}
+
+	static Light point(const glm::vec3& position, const float range, const glm::vec3& color = glm::vec3(1.0f),
+	                   const float intensity = 1.0f)
+	{
+		Light light;
+		light.position = position;
+		light.range = range;
+		light.color = color;
+		light.intensity = intensity;
+		return light;
+	}
+
+	static Light spot(const glm::vec3& position, const glm::vec3& direction, const float range,
+	                  const float innerConeAngle, const float outerConeAngle,
+	                  const glm::vec3& color = glm::vec3(1.0f), const float intensity = 1.0f)
+	{
+		Light light = point(position, range, color, intensity);
+		light.type = LightType::Spot;
+		light.direction = direction;
+		light.innerConeAngle = innerConeAngle;
+		light.outerConeAngle = outerConeAngle;
+		return light;
+	}
+
+	// world-space volume a point or spot light can reach
+	BoundingSphere getBounds() const { return {position, range}; }
+};
+
+// light in the form the fragment stage reads, prepared once per draw
+struct ShadingLight
+{
+	LightType type;
+	glm::vec3 position;
+	glm::vec3 toLight; // normalized, opposite to the light direction
+	glm::vec3 radiance; // color * intensity
+	float invRangeSquared;
+	const ShadowMap* shadowMap;
+
+	// spot falloff = saturate(cosAngle * coneScale + coneOffset)
+	float coneScale;
+	float coneOffset;
+
+	static ShadingLight fromLight(const Light& light)
+	{
+		ShadingLight shading{};
+		shading.type = light.type;
+		shading.position = light.position;
+		shading.toLight = -glm::normalize(light.direction);
+		shading.radiance = light.color * light.intensity;
+		shading.invRangeSquared = 1.0f / std::max(light.range * light.range, 1e-6f);
+		shading.shadowMap = light.shadowMap.get();
+
+		const float cosInner = std::cos(glm::radians(light.innerConeAngle));
+		const float cosOuter = std::cos(glm::radians(light.outerConeAngle));
+		shading.coneScale = 1.0f / std::max(cosInner - cosOuter, 1e-4f);
+		shading.coneOffset = -cosOuter * shading.coneScale;
+		return shading;
+	}
+};
@@ -1,6 +1,7 @@
 #include "Material.h"
 #include <stdexcept>
 #include <iostream>
+#include <chrono>
 #include <utility>
 #include <cassert>
 
@@ -9,7 +10,7 @@ Material::Material() :
 {
 }
 
-void Material::setDiffuseTexture(std::shared_ptr<Texture> texture)
+void Material::setDiffuseTexture(std::shared_ptr<const Texture> texture)
 {
 	if (!texture)
 	{
@@ -22,4 +23,51 @@ void Material::setDiffuseTexture(std::shared_ptr<Texture> texture)
 	}
 
 	mDiffuseTexture = std::move(texture);
+	mPendingDiffuseTexture = {};
+}
+
+void Material::setDiffuseTexture(std::shared_future<std::shared_ptr<const Texture>> pending,
+                                 std::shared_ptr<const Texture> placeholder)
+{
+	if (!pending.valid())
+	{
+		throw std::invalid_argument("Pending texture must have a shared state");
+	}
+
+	mDiffuseTexture = std::move(placeholder);
+	mPendingDiffuseTexture = std::move(pending);
+}
+
+bool Material::resolveDiffuseTexture(const bool wait)
+{
+	if (!mPendingDiffuseTexture.valid())
+	{
+		return true;
+	}
+
+	if (!wait && mPendingDiffuseTexture.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+	{
+		return false;
+	}
+
+	std::shared_ptr<const Texture> texture;
+	try
+	{
+		texture = mPendingDiffuseTexture.get();
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "Failed to load texture: " << e.what() << '\n';
+	}
+	mPendingDiffuseTexture = {};
+
+	if (texture && texture->isLoaded())
+	{
+		mDiffuseTexture = std::move(texture);
+	}
+	else
+	{
+		mDiffuseTexture = nullptr;
+	}
+	return true;
 }
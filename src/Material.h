@@ -1,15 +1,78 @@
 #pragma once
+#include <future>
 #include <memory>
+#include <optional>
+#include <utility>
 #include "Texture.h"
 
+class ShaderProgram;
+
+// how the alpha of the shaded color is used
+enum class AlphaMode
+{
+	Opaque, // ignored
+	Mask, // pixels below the cutoff are discarded
+	Blend // blended over what is behind, drawn back to front after opaque geometry
+};
+
 class Material
 {
 public:
 	Material();
 
-	void setDiffuseTexture(std::shared_ptr<Texture> texture);
+	void setDiffuseTexture(std::shared_ptr<const Texture> texture);
 	const Texture* getDiffuseTexture() const { return mDiffuseTexture.get(); }
 
+	// draws with placeholder until resolveDiffuseTexture() finds the pending texture finished
+	void setDiffuseTexture(std::shared_future<std::shared_ptr<const Texture>> pending,
+	                       std::shared_ptr<const Texture> placeholder);
+	bool isDiffuseTexturePending() const { return mPendingDiffuseTexture.valid(); }
+
+	// swaps in the pending texture once it has finished, blocking only when wait is set;
+	// a failed load leaves the material untextured, returns false while the texture is still loading
+	bool resolveDiffuseTexture(bool wait = false);
+
+	// overrides the texture's own filter when set
+	void setTextureFilter(std::optional<TextureFilter> filter) { mTextureFilter = filter; }
+	std::optional<TextureFilter> getTextureFilter() const { return mTextureFilter; }
+
+	// overrides the texture's own wrap modes (u, v) when set, so one shared texture can be clamped
+	// by one material and repeated by another
+	void setTextureWrap(std::optional<std::pair<TextureWrap, TextureWrap>> wrap) { mTextureWrap = wrap; }
+	std::optional<std::pair<TextureWrap, TextureWrap>> getTextureWrap() const { return mTextureWrap; }
+
+	// unlit materials output the texture color without diffuse lighting
+	void setLit(const bool lit) { mLit = lit; }
+	bool isLit() const { return mLit; }
+
+	// lights vertices and interpolates the result, cheaper and coarser, for distant or minor meshes
+	void setVertexLighting(const bool vertexLighting) { mVertexLighting = vertexLighting; }
+	bool isVertexLighting() const { return mVertexLighting; }
+
+	// still depth tested when off, later geometry is not occluded by it; blended materials never write depth
+	void setDepthWrite(const bool depthWrite) { mDepthWrite = depthWrite; }
+	bool getDepthWrite() const { return mDepthWrite; }
+
+	void setAlphaMode(const AlphaMode alphaMode) { mAlphaMode = alphaMode; }
+	AlphaMode getAlphaMode() const { return mAlphaMode; }
+
+	// alpha in [0,1] a masked pixel needs to be kept
+	void setAlphaCutoff(const float alphaCutoff) { mAlphaCutoff = alphaCutoff; }
+	float getAlphaCutoff() const { return mAlphaCutoff; }
+
+	// custom vertex and fragment programs, null draws with the renderer's default shader
+	void setShader(std::shared_ptr<const ShaderProgram> shader) { mShader = std::move(shader); }
+	const ShaderProgram* getShader() const { return mShader.get(); }
+
 private:
-	std::shared_ptr<Texture> mDiffuseTexture;
+	std::shared_ptr<const Texture> mDiffuseTexture;
+	std::shared_future<std::shared_ptr<const Texture>> mPendingDiffuseTexture;
+	std::optional<TextureFilter> mTextureFilter;
+	std::optional<std::pair<TextureWrap, TextureWrap>> mTextureWrap;
+	bool mLit = true;
+	bool mVertexLighting = false;
+	bool mDepthWrite = true;
+	AlphaMode mAlphaMode = AlphaMode::Opaque;
+	float mAlphaCutoff = 0.5f;
+	std::shared_ptr<const ShaderProgram> mShader;
 };
@@ -1,6 +1,8 @@
 #include "Mesh.h"
 #include <stdexcept>
 #include <cassert>
+#include <algorithm>
+#include <cmath>
 
 Mesh::Mesh(VertexArray vertexArray) : mVertexArray(std::move(vertexArray)), mLocalMatrix(1.0f)
 {
@@ -10,6 +12,8 @@ Mesh::Mesh(VertexArray vertexArray) : mVertexArray(std::move(vertexArray)), mLoc
 	}
 
 	validateVertexArray();
+	computeBounds();
+	buildMeshlets();
 }
 
 Mesh::Mesh(VertexArray vertexArray, const std::shared_ptr<Material>& material) : mVertexArray(std::move(vertexArray)),
@@ -26,6 +30,41 @@ Mesh::Mesh(VertexArray vertexArray, const std::shared_ptr<Material>& material) :
 	}
 
 	validateVertexArray();
+	computeBounds();
+	buildMeshlets();
+}
+
+Mesh::Mesh(VertexArray vertexArray, const std::shared_ptr<Material>& material, const BoundingBox& boundingBox,
+           const BoundingSphere& boundingSphere, std::vector<Meshlet> meshlets) : mVertexArray(std::move(vertexArray)),
+	mLocalMatrix(1.0f), mMaterial(material), mBoundingBox(boundingBox), mBoundingSphere(boundingSphere),
+	mMeshlets(std::move(meshlets))
+{
+	if (mVertexArray.size() == 0)
+	{
+		throw std::invalid_argument("Vertex array cannot be empty");
+	}
+
+	if (!material)
+	{
+		throw std::invalid_argument("Material cannot be null");
+	}
+
+	validateVertexArray();
+
+	// meshlets have to cover every triangle in order
+	uint32_t nextTriangle = 0;
+	for (const Meshlet& meshlet : mMeshlets)
+	{
+		if (meshlet.firstTriangle != nextTriangle)
+		{
+			throw std::invalid_argument("Meshlets must cover the triangles in order");
+		}
+		nextTriangle += meshlet.triangleCount;
+	}
+	if (nextTriangle != mVertexArray.size() / 3)
+	{
+		throw std::invalid_argument("Meshlets must cover the triangles in order");
+	}
 }
 
 void Mesh::validateVertexArray() const
@@ -48,6 +87,103 @@ void Mesh::validateVertexArray() const
 	}
 }
 
+void Mesh::computeBounds()
+{
+	const size_t count = mVertexArray.positionsX.size();
+
+	glm::vec3 minimum(mVertexArray.positionsX[0], mVertexArray.positionsY[0], mVertexArray.positionsZ[0]);
+	glm::vec3 maximum = minimum;
+	for (size_t i = 1; i < count; ++i)
+	{
+		const glm::vec3 position(mVertexArray.positionsX[i], mVertexArray.positionsY[i], mVertexArray.positionsZ[i]);
+		minimum = glm::min(minimum, position);
+		maximum = glm::max(maximum, position);
+	}
+	mBoundingBox = {minimum, maximum};
+
+	// sphere around the box centre, radius from the farthest vertex
+	const glm::vec3 center = mBoundingBox.getCenter();
+	float radiusSquared = 0.0f;
+	for (size_t i = 0; i < count; ++i)
+	{
+		const glm::vec3 offset = glm::vec3(mVertexArray.positionsX[i], mVertexArray.positionsY[i],
+		                                   mVertexArray.positionsZ[i]) - center;
+		radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+	}
+	mBoundingSphere = {center, std::sqrt(radiusSquared)};
+}
+
+void Mesh::buildMeshlets()
+{
+	const auto& va = mVertexArray;
+	const uint32_t triangleTotal = static_cast<uint32_t>(va.positionsX.size() / 3);
+	auto position = [&](const size_t i) { return glm::vec3(va.positionsX[i], va.positionsY[i], va.positionsZ[i]); };
+
+	mMeshlets.clear();
+	mMeshlets.reserve((triangleTotal + MESHLET_MAX_TRIANGLES - 1) / MESHLET_MAX_TRIANGLES);
+
+	std::vector<glm::vec3> faceNormals;
+	faceNormals.reserve(MESHLET_MAX_TRIANGLES);
+
+	for (uint32_t first = 0; first < triangleTotal; first += MESHLET_MAX_TRIANGLES)
+	{
+		Meshlet meshlet{};
+		meshlet.firstTriangle = first;
+		meshlet.triangleCount = std::min(MESHLET_MAX_TRIANGLES, triangleTotal - first);
+
+		const size_t firstVertex = static_cast<size_t>(first) * 3;
+		const size_t endVertex = firstVertex + static_cast<size_t>(meshlet.triangleCount) * 3;
+
+		// bounding sphere around the cluster box
+		BoundingBox box{position(firstVertex), position(firstVertex)};
+		for (size_t i = firstVertex + 1; i < endVertex; ++i)
+		{
+			box.min = glm::min(box.min, position(i));
+			box.max = glm::max(box.max, position(i));
+		}
+
+		float radiusSquared = 0.0f;
+		for (size_t i = firstVertex; i < endVertex; ++i)
+		{
+			const glm::vec3 offset = position(i) - box.getCenter();
+			radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+		}
+		meshlet.bounds = {box.getCenter(), std::sqrt(radiusSquared)};
+
+		// normal cone from the geometric face normals, degenerate faces are never drawn
+		faceNormals.clear();
+		glm::vec3 axis(0.0f);
+		for (size_t i = firstVertex; i < endVertex; i += 3)
+		{
+			const glm::vec3 normal = glm::cross(position(i + 1) - position(i), position(i + 2) - position(i));
+			const float length = glm::length(normal);
+			if (length <= 1e-12f) continue;
+
+			faceNormals.push_back(normal / length);
+			axis += faceNormals.back();
+		}
+
+		meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+		meshlet.coneCutoff = 2.0f;
+
+		const float axisLength = glm::length(axis);
+		if (axisLength > 1e-6f)
+		{
+			meshlet.coneAxis = axis / axisLength;
+
+			float minDot = 1.0f;
+			for (const glm::vec3& normal : faceNormals)
+				minDot = std::min(minDot, glm::dot(normal, meshlet.coneAxis));
+
+			// a cone wider than a hemisphere always has a front face in view
+			if (minDot > 0.0f)
+				meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+		}
+
+		mMeshlets.push_back(meshlet);
+	}
+}
+
 void Mesh::setLocalMatrix(const glm::mat4& matrix)
 {
 	mLocalMatrix = matrix;
@@ -1,26 +1,58 @@
 #pragma once
+#include <cstdint>
+#include <vector>
 #include "VertexArray.h"
 #include "Material.h"
+#include "Bounds.h"
 #include "glm/mat4x4.hpp"
 
+// contiguous run of triangles that is culled as a unit
+struct Meshlet
+{
+	uint32_t firstTriangle;
+	uint32_t triangleCount;
+	BoundingSphere bounds;
+
+	// every face normal n satisfies dot(n, coneAxis) >= sqrt(1 - coneCutoff^2);
+	// a cutoff above 1 disables cone culling
+	glm::vec3 coneAxis;
+	float coneCutoff;
+};
+
 class Mesh
 {
 public:
+	static constexpr uint32_t MESHLET_MAX_TRIANGLES = 64;
+
 	explicit Mesh(VertexArray vertexArray);
 
 	Mesh(VertexArray vertexArray, const std::shared_ptr<Material>& material);
 
+	// takes bounds and meshlets computed earlier, e.g. read back from the mesh cache
+	Mesh(VertexArray vertexArray, const std::shared_ptr<Material>& material, const BoundingBox& boundingBox,
+	     const BoundingSphere& boundingSphere, std::vector<Meshlet> meshlets);
+
 	const VertexArray& getVertexArray() const { return mVertexArray; }
 	const glm::mat4& getLocalMatrix() const { return mLocalMatrix; }
 	const Material* getMaterial() const { return mMaterial.get(); }
+	const BoundingBox& getBoundingBox() const { return mBoundingBox; }
+	const BoundingSphere& getBoundingSphere() const { return mBoundingSphere; }
+	const std::vector<Meshlet>& getMeshlets() const { return mMeshlets; }
 
 	void setLocalMatrix(const glm::mat4& matrix);
 	void setMaterial(const std::shared_ptr<Material>& material);
 
 private:
 	void validateVertexArray() const;
+	void computeBounds();
+	void buildMeshlets();
 
 	VertexArray mVertexArray;
 	glm::mat4 mLocalMatrix = glm::mat4(1.0f);
 	std::shared_ptr<Material> mMaterial;
+
+	// object-space bounds, cached at construction
+	BoundingBox mBoundingBox;
+	BoundingSphere mBoundingSphere;
+	std::vector<Meshlet> mMeshlets;
 };
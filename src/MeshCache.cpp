@@ -0,0 +1,348 @@
+#include "MeshCache.h"
+#include "MappedFile.h"
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace
+{
+	struct FileHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint64_t sourceHash;
+		uint64_t fileSize;
+		uint32_t materialCount;
+		uint32_t meshCount;
+	};
+
+	struct MaterialRecord
+	{
+		uint32_t flags;
+		uint32_t pathLength; // path bytes follow, padded to 4
+	};
+
+	struct MeshRecord
+	{
+		uint64_t streamOffset; // STREAM_COUNT streams of vertexCount floats, each STREAM_ALIGNMENT aligned
+		uint64_t meshletOffset;
+		uint32_t vertexCount;
+		uint32_t meshletCount;
+		int32_t material;
+		float boundingBox[6];
+		float boundingSphere[4];
+	};
+
+	struct MeshletRecord
+	{
+		uint32_t firstTriangle;
+		uint32_t triangleCount;
+		float bounds[4];
+		float coneAxis[3];
+		float coneCutoff;
+	};
+
+	constexpr char MAGIC[4] = { 'S', 'R', 'M', 'C' };
+	constexpr uint32_t CLAMP_TEXTURE = 1;
+	constexpr size_t STREAM_COUNT = 8;
+	constexpr size_t STREAM_ALIGNMENT = 64;
+}
+
+static size_t alignUp(const size_t value, const size_t alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static size_t getStreamBytes(const uint32_t vertexCount)
+{
+	return alignUp(static_cast<size_t>(vertexCount) * sizeof(float), STREAM_ALIGNMENT);
+}
+
+// streams in the order they are stored
+template <typename Vertices>
+static auto getStreams(Vertices& vertices)
+{
+	return std::array{
+		&vertices.positionsX, &vertices.positionsY, &vertices.positionsZ,
+		&vertices.uvsU, &vertices.uvsV,
+		&vertices.normalsX, &vertices.normalsY, &vertices.normalsZ
+	};
+}
+
+// FNV-1a over 8-byte words, the tail is zero padded and the size is folded in last
+static uint64_t hashBytes(const uint8_t* data, const size_t size, uint64_t hash)
+{
+	const size_t wordBytes = size & ~size_t(7);
+	for (size_t i = 0; i < wordBytes; i += 8)
+	{
+		uint64_t word;
+		std::memcpy(&word, data + i, 8);
+		hash = (hash ^ word) * 1099511628211ull;
+	}
+
+	uint64_t tail = 0;
+	std::memcpy(&tail, data + wordBytes, size - wordBytes);
+	hash = (hash ^ tail) * 1099511628211ull;
+	return (hash ^ size) * 1099511628211ull;
+}
+
+uint64_t hashMeshSource(const std::string& path, const std::string& materialDirectory)
+{
+	const MappedFile file(path);
+	if (!file.data()) return 0;
+
+	uint64_t hash = hashBytes(file.data(), file.size(), 14695981039346656037ull);
+
+	// the material table is cached too, so every file named on an mtllib line is part of the source;
+	// a missing one still changes the hash when it appears
+	const char* text = reinterpret_cast<const char*>(file.data());
+	const char* end = text + file.size();
+	for (const char* line = text; line < end;)
+	{
+		const char* lineEnd = static_cast<const char*>(std::memchr(line, '\n', end - line));
+		if (!lineEnd) lineEnd = end;
+
+		const char* cursor = line;
+		while (cursor < lineEnd && (*cursor == ' ' || *cursor == '\t')) ++cursor;
+		if (lineEnd - cursor > 7 && std::memcmp(cursor, "mtllib", 6) == 0 &&
+			std::isspace(static_cast<unsigned char>(cursor[6])))
+		{
+			std::istringstream names(std::string(cursor + 7, lineEnd));
+			std::string name;
+			while (names >> name)
+			{
+				const MappedFile library(materialDirectory + name);
+				if (library.data())
+					hash = hashBytes(library.data(), library.size(), hash);
+				else
+					hash = (hash ^ ~0ull) * 1099511628211ull;
+			}
+		}
+		line = lineEnd + 1;
+	}
+
+	// zero means unreadable
+	return hash ? hash : 1;
+}
+
+bool writeMeshCache(const std::string& path, const uint64_t sourceHash, const std::vector<MeshCacheMaterial>& materials,
+                    const std::span<const Mesh> meshes, const std::vector<int32_t>& meshMaterials)
+{
+	if (meshes.size() != meshMaterials.size())
+	{
+		throw std::invalid_argument("Mesh cache needs one material index per mesh");
+	}
+
+	FileHeader header{};
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = MESH_CACHE_VERSION;
+	header.sourceHash = sourceHash;
+	header.materialCount = static_cast<uint32_t>(materials.size());
+	header.meshCount = static_cast<uint32_t>(meshes.size());
+
+	// lay out the material table, the mesh table, then the aligned streams and meshlets of each mesh
+	size_t offset = sizeof(FileHeader);
+	for (const MeshCacheMaterial& material : materials)
+	{
+		offset += sizeof(MaterialRecord) + alignUp(material.diffuseTexture.size(), 4);
+	}
+	offset += meshes.size() * sizeof(MeshRecord);
+
+	std::vector<MeshRecord> records(meshes.size());
+	for (size_t i = 0; i < meshes.size(); ++i)
+	{
+		const Mesh& mesh = meshes[i];
+		MeshRecord& record = records[i];
+		record.vertexCount = static_cast<uint32_t>(mesh.getVertexArray().size());
+		record.meshletCount = static_cast<uint32_t>(mesh.getMeshlets().size());
+		record.material = meshMaterials[i];
+
+		const BoundingBox& box = mesh.getBoundingBox();
+		const BoundingSphere& sphere = mesh.getBoundingSphere();
+		const float boxValues[6] = { box.min.x, box.min.y, box.min.z, box.max.x, box.max.y, box.max.z };
+		const float sphereValues[4] = { sphere.center.x, sphere.center.y, sphere.center.z, sphere.radius };
+		std::memcpy(record.boundingBox, boxValues, sizeof(boxValues));
+		std::memcpy(record.boundingSphere, sphereValues, sizeof(sphereValues));
+
+		record.streamOffset = alignUp(offset, STREAM_ALIGNMENT);
+		record.meshletOffset = record.streamOffset + STREAM_COUNT * getStreamBytes(record.vertexCount);
+		offset = record.meshletOffset + record.meshletCount * sizeof(MeshletRecord);
+	}
+	header.fileSize = offset;
+
+	std::vector<uint8_t> bytes(offset, 0);
+	size_t cursor = 0;
+	auto append = [&](const void* data, const size_t size)
+	{
+		std::memcpy(bytes.data() + cursor, data, size);
+		cursor += size;
+	};
+
+	append(&header, sizeof(header));
+	for (const MeshCacheMaterial& material : materials)
+	{
+		const MaterialRecord record{ material.clampTexture ? CLAMP_TEXTURE : 0,
+		                             static_cast<uint32_t>(material.diffuseTexture.size()) };
+		append(&record, sizeof(record));
+		append(material.diffuseTexture.data(), material.diffuseTexture.size());
+		cursor = alignUp(cursor, 4);
+	}
+	append(records.data(), records.size() * sizeof(MeshRecord));
+
+	for (size_t i = 0; i < meshes.size(); ++i)
+	{
+		const VertexArray& vertices = meshes[i].getVertexArray();
+		const MeshRecord& record = records[i];
+
+		const auto streams = getStreams(vertices);
+		for (size_t s = 0; s < STREAM_COUNT; ++s)
+		{
+			std::memcpy(bytes.data() + record.streamOffset + s * getStreamBytes(record.vertexCount),
+			            streams[s]->data(), record.vertexCount * sizeof(float));
+		}
+
+		cursor = record.meshletOffset;
+		for (const Meshlet& meshlet : meshes[i].getMeshlets())
+		{
+			const MeshletRecord meshletRecord{
+				meshlet.firstTriangle, meshlet.triangleCount,
+				{ meshlet.bounds.center.x, meshlet.bounds.center.y, meshlet.bounds.center.z, meshlet.bounds.radius },
+				{ meshlet.coneAxis.x, meshlet.coneAxis.y, meshlet.coneAxis.z }, meshlet.coneCutoff
+			};
+			append(&meshletRecord, sizeof(meshletRecord));
+		}
+	}
+
+	// unique per writer, several loaders may cache the same model at once
+	static std::atomic<uint32_t> sWriteCounter = 0;
+	const std::string temporaryPath = path + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()))
+		+ "_" + std::to_string(sWriteCounter++);
+
+	{
+		std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+		if (!file || !file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size())))
+		{
+			std::cerr << "Failed to write mesh cache: " << path << '\n';
+			std::error_code ignored;
+			std::filesystem::remove(temporaryPath, ignored);
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporaryPath, path, error);
+	if (error)
+	{
+		std::cerr << "Failed to write mesh cache: " << path << " - " << error.message() << '\n';
+		std::filesystem::remove(temporaryPath, error);
+		return false;
+	}
+	return true;
+}
+
+bool readMeshCache(const std::string& path, const uint64_t sourceHash, MeshCacheContents& contents)
+{
+	const MappedFile file(path);
+	if (!file.data() || file.size() < sizeof(FileHeader)) return false;
+
+	const uint8_t* bytes = file.data();
+	FileHeader header;
+	std::memcpy(&header, bytes, sizeof(header));
+	if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != MESH_CACHE_VERSION ||
+		header.sourceHash != sourceHash)
+	{
+		return false;
+	}
+
+	auto malformed = [&]
+	{
+		std::cerr << "Ignoring malformed mesh cache: " << path << '\n';
+		return false;
+	};
+
+	if (header.fileSize != file.size()) return malformed();
+
+	// every material record takes at least its fixed part, so the count cannot exceed what the file holds
+	size_t cursor = sizeof(FileHeader);
+	if (header.materialCount > (file.size() - cursor) / sizeof(MaterialRecord)) return malformed();
+	MeshCacheContents result;
+	result.materials.resize(header.materialCount);
+	for (MeshCacheMaterial& material : result.materials)
+	{
+		MaterialRecord record;
+		if (cursor + sizeof(record) > file.size()) return malformed();
+		std::memcpy(&record, bytes + cursor, sizeof(record));
+		cursor += sizeof(record);
+
+		if (record.pathLength > file.size() - cursor) return malformed();
+		material.diffuseTexture.assign(reinterpret_cast<const char*>(bytes + cursor), record.pathLength);
+		material.clampTexture = (record.flags & CLAMP_TEXTURE) != 0;
+		cursor = alignUp(cursor + record.pathLength, 4);
+	}
+
+	if (header.meshCount > (file.size() - std::min(cursor, file.size())) / sizeof(MeshRecord)) return malformed();
+	std::vector<MeshRecord> records(header.meshCount);
+	std::memcpy(records.data(), bytes + cursor, records.size() * sizeof(MeshRecord));
+
+	result.meshes.resize(records.size());
+	for (size_t i = 0; i < records.size(); ++i)
+	{
+		const MeshRecord& record = records[i];
+		MeshCacheEntry& entry = result.meshes[i];
+
+		const size_t streamBytes = getStreamBytes(record.vertexCount);
+		if (record.vertexCount == 0 || record.vertexCount % 3 != 0 ||
+			record.material < -1 || record.material >= static_cast<int32_t>(header.materialCount) ||
+			record.streamOffset > file.size() || STREAM_COUNT * streamBytes > file.size() - record.streamOffset ||
+			record.meshletOffset > file.size() ||
+			record.meshletCount > (file.size() - record.meshletOffset) / sizeof(MeshletRecord))
+		{
+			return malformed();
+		}
+
+		// one bulk copy per stream straight out of the mapping
+		const auto streams = getStreams(entry.vertices);
+		for (size_t s = 0; s < STREAM_COUNT; ++s)
+		{
+			const float* source = reinterpret_cast<const float*>(bytes + record.streamOffset + s * streamBytes);
+			streams[s]->assign(source, source + record.vertexCount);
+		}
+
+		// meshlets must tile the triangles in order
+		entry.meshlets.resize(record.meshletCount);
+		uint32_t nextTriangle = 0;
+		for (size_t m = 0; m < record.meshletCount; ++m)
+		{
+			MeshletRecord meshletRecord;
+			std::memcpy(&meshletRecord, bytes + record.meshletOffset + m * sizeof(MeshletRecord), sizeof(meshletRecord));
+			if (meshletRecord.firstTriangle != nextTriangle || meshletRecord.triangleCount == 0) return malformed();
+			nextTriangle += meshletRecord.triangleCount;
+
+			Meshlet& meshlet = entry.meshlets[m];
+			meshlet.firstTriangle = meshletRecord.firstTriangle;
+			meshlet.triangleCount = meshletRecord.triangleCount;
+			meshlet.bounds = { glm::vec3(meshletRecord.bounds[0], meshletRecord.bounds[1], meshletRecord.bounds[2]),
+			                   meshletRecord.bounds[3] };
+			meshlet.coneAxis = glm::vec3(meshletRecord.coneAxis[0], meshletRecord.coneAxis[1], meshletRecord.coneAxis[2]);
+			meshlet.coneCutoff = meshletRecord.coneCutoff;
+		}
+		if (nextTriangle != record.vertexCount / 3) return malformed();
+
+		entry.boundingBox = { glm::vec3(record.boundingBox[0], record.boundingBox[1], record.boundingBox[2]),
+		                      glm::vec3(record.boundingBox[3], record.boundingBox[4], record.boundingBox[5]) };
+		entry.boundingSphere = { glm::vec3(record.boundingSphere[0], record.boundingSphere[1], record.boundingSphere[2]),
+		                         record.boundingSphere[3] };
+		entry.material = record.material;
+	}
+
+	contents = std::move(result);
+	return true;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+#include "Mesh.h"
+
+// binary mesh cache written next to an OBJ after it is first parsed: the eight SoA vertex streams of each mesh,
+// its meshlets and bounds, and the material table; a source hash in the header invalidates it when the OBJ or
+// one of its MTL files changes
+
+constexpr uint32_t MESH_CACHE_VERSION = 1;
+
+// diffuse map of a material, path as written in the MTL relative to the model directory
+struct MeshCacheMaterial
+{
+	std::string diffuseTexture;
+	bool clampTexture = false;
+};
+
+struct MeshCacheEntry
+{
+	VertexArray vertices;
+	std::vector<Meshlet> meshlets;
+	BoundingBox boundingBox;
+	BoundingSphere boundingSphere;
+	int32_t material = -1; // index into the material table, -1 for a default material
+};
+
+struct MeshCacheContents
+{
+	std::vector<MeshCacheMaterial> materials;
+	std::vector<MeshCacheEntry> meshes;
+};
+
+// hash of the OBJ contents and size plus its mtllib files, looked up in materialDirectory as parseObj does;
+// zero when the OBJ cannot be read
+uint64_t hashMeshSource(const std::string& path, const std::string& materialDirectory);
+
+// writes to a temporary file and renames it into place, so concurrent readers never see a partial cache;
+// meshMaterials holds the material index of each mesh
+bool writeMeshCache(const std::string& path, uint64_t sourceHash, const std::vector<MeshCacheMaterial>& materials,
+                    std::span<const Mesh> meshes, const std::vector<int32_t>& meshMaterials);
+
+// maps the file and copies the streams out; false when it is missing, stale or malformed
+bool readMeshCache(const std::string& path, uint64_t sourceHash, MeshCacheContents& contents);
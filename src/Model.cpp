@@ -1,10 +1,17 @@
 #include "Model.h"
+#include "AssetLoader.h"
+#include "MeshCache.h"
+#include "ObjParser.h"
+#include "TextureCache.h"
+#include <algorithm>
+#include <atomic>
+#include <execution>
 #include <iostream>
 #include <filesystem>
+#include <numeric>
+#include <optional>
 #include <stdexcept>
 #include <cassert>
-#define TINYOBJLOADER_IMPLEMENTATION
-#include "tiny_obj_loader.h"
 #include <glm/ext/matrix_transform.hpp>
 
 Model::Model(const std::vector<Mesh>& meshes)
@@ -34,84 +41,139 @@ Model::Model(const std::string& filename)
 	updateModelMatrix();
 }
 
-void Model::loadModel(const std::string& filename)
+Model::Model(const std::string& filename, AssetLoader& loader)
+	: mModelMatrix(1.0f), mPosition(0.0f), mRotation(0.0f), mScale(1.0f)
 {
-	std::cout << "Loading model: " << filename << '\n';
+	if (filename.empty())
+	{
+		throw std::invalid_argument("Model filename cannot be empty");
+	}
 
-	tinyobj::attrib_t attrib;
-	std::vector<tinyobj::shape_t> shapes;
-	std::vector<tinyobj::material_t> materials;
-	std::string warning, error;
+	if (!std::filesystem::exists(filename))
+	{
+		throw std::runtime_error("Model file does not exist: " + filename);
+	}
 
-	std::filesystem::path filePath(filename);
-	std::string baseDir = filePath.parent_path().string() + "/";
-	bool success = tinyobj::LoadObj(&attrib, &shapes, &materials, &error, filename.c_str(), baseDir.c_str(), true);
-	if (!warning.empty())
+	loadModel(filename, &loader);
+	updateModelMatrix();
+}
+
+static std::shared_ptr<Material> createMaterial(const std::string& baseDir, const MeshCacheMaterial& description,
+                                                AssetLoader* loader)
+{
+	auto material = std::make_shared<Material>();
+
+	if (!description.diffuseTexture.empty())
 	{
-		std::cerr << "WARN: " << warning << '\n';
+		std::string texturePath = baseDir + description.diffuseTexture;
+
+		// obj textures repeat unless the material asks for -clamp on; the wrap is the material's, so
+		// materials clamping and repeating the same image share one decoded texture
+		const TextureWrap wrap = description.clampTexture ? TextureWrap::ClampToEdge : TextureWrap::Repeat;
+		material->setTextureWrap(std::pair{wrap, wrap});
+		if (loader)
+		{
+			// decodes on the worker pool while the geometry is built
+			material->setDiffuseTexture(loader->loadTexture(texturePath), AssetLoader::getPlaceholderTexture());
+		}
+		else if (auto texture = TextureCache::instance().load(texturePath))
+		{
+			material->setDiffuseTexture(texture);
+		}
+		else
+		{
+			std::cerr << "Failed to load texture: " << texturePath << '\n';
+		}
 	}
 
-	if (!success)
+	return material;
+}
+
+void Model::loadModel(const std::string& filename, AssetLoader* loader)
+{
+	std::cout << "Loading model: " << filename << '\n';
+
+	std::filesystem::path filePath(filename);
+	std::string baseDir = filePath.parent_path().string() + "/";
+
+	// the binary cache skips OBJ parsing and meshlet building entirely
+	const std::string cachePath = filename + ".meshcache";
+	const uint64_t sourceHash = hashMeshSource(filename, baseDir);
+	MeshCacheContents cached;
+	if (sourceHash != 0 && readMeshCache(cachePath, sourceHash, cached))
 	{
-		std::string errorMsg = "Failed to load OBJ file: " + filename;
-		if (!error.empty())
+		std::vector<std::shared_ptr<Material>> cachedMaterials;
+		for (const MeshCacheMaterial& description : cached.materials)
+		{
+			cachedMaterials.push_back(createMaterial(baseDir, description, loader));
+		}
+		mMaterials.insert(mMaterials.end(), cachedMaterials.begin(), cachedMaterials.end());
+
+		for (MeshCacheEntry& entry : cached.meshes)
+		{
+			const auto material = entry.material >= 0 ? cachedMaterials[entry.material] : std::make_shared<Material>();
+			mMeshes.emplace_back(std::move(entry.vertices), material, entry.boundingBox, entry.boundingSphere,
+			                     std::move(entry.meshlets));
+		}
+
+		std::cout << "Model loaded from cache: " << cachePath << " (" << cached.meshes.size() << " meshes)" << '\n';
+		if (mMeshes.empty())
 		{
-			errorMsg += " - " + error;
+			throw std::runtime_error("No valid meshes were created from model: " + filename);
 		}
-		throw std::runtime_error(errorMsg);
+		return;
+	}
+
+	const ObjData obj = parseObj(filename, baseDir);
+	if (!obj.warnings.empty())
+	{
+		std::cerr << "WARN: " << obj.warnings << '\n';
 	}
 
-	if (attrib.vertices.empty())
+	if (obj.positions.empty())
 	{
 		throw std::runtime_error("Model has no vertices: " + filename);
 	}
 
-	if (shapes.empty())
+	if (obj.shapes.empty())
 	{
 		throw std::runtime_error("Model has no shapes: " + filename);
 	}
 
 	std::cout << "Model loaded: " << filename
-		<< " (" << attrib.vertices.size() / 3 << " vertices, "
-		<< shapes.size() << " shapes, "
-		<< materials.size() << " materials)" << '\n';
+		<< " (" << obj.positions.size() / 3 << " vertices, "
+		<< obj.shapes.size() << " shapes, "
+		<< obj.materials.size() << " materials)" << '\n';
 
+	std::vector<MeshCacheMaterial> materialTable;
 	std::vector<std::shared_ptr<Material>> loadedMaterials;
-	for (const auto& mat : materials)
+	for (const auto& mat : obj.materials)
 	{
-		auto material = std::make_shared<Material>();
-
-		if (!mat.diffuse_texname.empty())
-		{
-			std::string texturePath = baseDir + mat.diffuse_texname;
-			auto texture = std::make_shared<Texture>(texturePath);
-			if (texture->isLoaded())
-			{
-				material->setDiffuseTexture(texture);
-			}
-			else
-			{
-				std::cerr << "Failed to load texture: " << texturePath << '\n';
-			}
-		}
-
-		loadedMaterials.push_back(material);
+		materialTable.push_back({mat.diffuse_texname, mat.diffuse_texopt.clamp});
+		loadedMaterials.push_back(createMaterial(baseDir, materialTable.back(), loader));
 	}
+	mMaterials.insert(mMaterials.end(), loadedMaterials.begin(), loadedMaterials.end());
+
+	// each shape is converted to SoA and split into meshlets on its own thread
+	std::vector<std::optional<Mesh>> shapeMeshes(obj.shapes.size());
+	std::vector<int32_t> shapeMaterials(obj.shapes.size(), -1);
+	std::vector<size_t> shapeIndices(obj.shapes.size());
+	std::iota(shapeIndices.begin(), shapeIndices.end(), size_t(0));
+	std::atomic<size_t> invalidTriangles = 0;
 
-	for (size_t i = 0; i < shapes.size(); i++)
+	std::for_each(std::execution::par, shapeIndices.begin(), shapeIndices.end(), [&](const size_t i)
 	{
-		const auto& shape = shapes[i];
-		VertexArray vertexArray;
+		const ObjShape& shape = obj.shapes[i];
 
 		std::shared_ptr<Material> shapeMaterial = nullptr;
-		if (!shape.mesh.material_ids.empty() && shape.mesh.material_ids[0] >= 0 &&
-			shape.mesh.material_ids[0] < static_cast<int>(loadedMaterials.size()))
+		if (shape.materialId >= 0 && shape.materialId < static_cast<int>(loadedMaterials.size()))
 		{
-			int matId = shape.mesh.material_ids[0];
-			shapeMaterial = loadedMaterials[matId];
+			shapeMaterials[i] = shape.materialId;
+			shapeMaterial = loadedMaterials[shape.materialId];
 		}
 		else if (!loadedMaterials.empty())
 		{
+			shapeMaterials[i] = 0;
 			shapeMaterial = loadedMaterials[0]; // use first material as fallback
 		}
 		else
@@ -119,72 +181,81 @@ void Model::loadModel(const std::string& filename)
 			shapeMaterial = std::make_shared<Material>(); // default material
 		}
 
-		size_t indexOffset = 0;
-		for (size_t f = 0; f < shape.mesh.num_face_vertices.size(); f++)
-		{
-			int fv = shape.mesh.num_face_vertices[f];
+		// sized from the face count up front, shrunk afterwards if triangles had bad indices
+		VertexArray vertexArray;
+		vertexArray.resize(std::max(shape.corners.size(), size_t(1)));
+
+		const int positionCount = static_cast<int>(obj.positions.size() / 3);
+		const int texcoordCount = static_cast<int>(obj.texcoords.size() / 2);
+		const int normalCount = static_cast<int>(obj.normals.size() / 3);
 
-			if (fv != 3)
+		size_t written = 0;
+		for (size_t corner = 0; corner + 2 < shape.corners.size(); corner += 3)
+		{
+			const ObjCorner* triangle = &shape.corners[corner];
+			if (triangle[0].position < 0 || triangle[0].position >= positionCount ||
+				triangle[1].position < 0 || triangle[1].position >= positionCount ||
+				triangle[2].position < 0 || triangle[2].position >= positionCount)
 			{
-				indexOffset += fv;
+				++invalidTriangles;
 				continue;
 			}
 
-			for (size_t v = 0; v < fv; v++)
+			for (int v = 0; v < 3; ++v)
 			{
-				if (indexOffset + v >= shape.mesh.indices.size())
-				{
-					std::cerr << "Warning: Face index out of bounds in model loading\n";
-					continue;
-				}
+				const ObjCorner& idx = triangle[v];
 
-				tinyobj::index_t idx = shape.mesh.indices[indexOffset + v];
-
-				if (idx.vertex_index < 0 || idx.vertex_index * 3 + 2 >= static_cast<int>(attrib.vertices.size()))
-				{
-					std::cerr << "Warning: Invalid vertex index in model loading\n";
-					continue;
-				}
-
-				float posX = attrib.vertices[3 * idx.vertex_index + 0];
-				float posY = attrib.vertices[3 * idx.vertex_index + 1];
-				float posZ = attrib.vertices[3 * idx.vertex_index + 2];
+				vertexArray.positionsX[written] = obj.positions[3 * idx.position + 0];
+				vertexArray.positionsY[written] = obj.positions[3 * idx.position + 1];
+				vertexArray.positionsZ[written] = obj.positions[3 * idx.position + 2];
 
 				float uvU = 0.0f;
 				float uvV = 0.0f;
-				if (idx.texcoord_index >= 0 && idx.texcoord_index * 2 + 1 < static_cast<int>(attrib.texcoords.size()))
+				if (idx.texcoord >= 0 && idx.texcoord < texcoordCount)
 				{
-					uvU = attrib.texcoords[2 * idx.texcoord_index + 0];
-					uvV = 1.0f - attrib.texcoords[2 * idx.texcoord_index + 1]; // flip Y 
+					uvU = obj.texcoords[2 * idx.texcoord + 0];
+					uvV = 1.0f - obj.texcoords[2 * idx.texcoord + 1]; // flip Y 
 				}
+				vertexArray.uvsU[written] = uvU;
+				vertexArray.uvsV[written] = uvV;
 
 				float normalX = 0.0f;
 				float normalY = 0.0f;
 				float normalZ = 1.0f;
-				if (idx.normal_index >= 0 && idx.normal_index * 3 + 2 < static_cast<int>(attrib.normals.size()))
+				if (idx.normal >= 0 && idx.normal < normalCount)
 				{
-					normalX = attrib.normals[3 * idx.normal_index + 0];
-					normalY = attrib.normals[3 * idx.normal_index + 1];
-					normalZ = attrib.normals[3 * idx.normal_index + 2];
+					normalX = obj.normals[3 * idx.normal + 0];
+					normalY = obj.normals[3 * idx.normal + 1];
+					normalZ = obj.normals[3 * idx.normal + 2];
 				}
+				vertexArray.normalsX[written] = normalX;
+				vertexArray.normalsY[written] = normalY;
+				vertexArray.normalsZ[written] = normalZ;
 
-				vertexArray.positionsX.push_back(posX);
-				vertexArray.positionsY.push_back(posY);
-				vertexArray.positionsZ.push_back(posZ);
-
-				vertexArray.uvsU.push_back(uvU);
-				vertexArray.uvsV.push_back(uvV);
-
-				vertexArray.normalsX.push_back(normalX);
-				vertexArray.normalsY.push_back(normalY);
-				vertexArray.normalsZ.push_back(normalZ);
+				++written;
 			}
-			indexOffset += fv;
 		}
 
-		if (!vertexArray.positionsX.empty())
+		if (written > 0)
 		{
-			mMeshes.emplace_back(vertexArray, shapeMaterial);
+			vertexArray.resize(written);
+			shapeMeshes[i].emplace(std::move(vertexArray), shapeMaterial);
+		}
+	});
+
+	if (invalidTriangles > 0)
+	{
+		std::cerr << "Warning: " << invalidTriangles << " triangles with invalid vertex indices were skipped\n";
+	}
+
+	const size_t firstMesh = mMeshes.size();
+	std::vector<int32_t> meshMaterials;
+	for (size_t i = 0; i < shapeMeshes.size(); ++i)
+	{
+		if (shapeMeshes[i])
+		{
+			mMeshes.push_back(std::move(*shapeMeshes[i]));
+			meshMaterials.push_back(shapeMaterials[i]);
 		}
 		else
 		{
@@ -195,6 +266,29 @@ void Model::loadModel(const std::string& filename)
 	{
 		throw std::runtime_error("No valid meshes were created from model: " + filename);
 	}
+
+	if (sourceHash != 0)
+	{
+		writeMeshCache(cachePath, sourceHash, materialTable, std::span(mMeshes).subspan(firstMesh), meshMaterials);
+	}
+}
+
+bool Model::resolvePendingTextures()
+{
+	bool resolved = true;
+	for (const auto& material : mMaterials)
+	{
+		resolved &= material->resolveDiffuseTexture();
+	}
+	return resolved;
+}
+
+void Model::waitForTextures()
+{
+	for (const auto& material : mMaterials)
+	{
+		material->resolveDiffuseTexture(true);
+	}
 }
 
 void Model::setPosition(const glm::vec3& position)
@@ -5,6 +5,8 @@
 
 #include "Mesh.h"
 
+class AssetLoader;
+
 class Model
 {
 public:
@@ -12,7 +14,14 @@ public:
 
 	explicit Model(const std::string& filename);
 
-	void loadModel(const std::string& filename);
+	// queues texture decoding on loader instead of blocking, materials show a placeholder meanwhile
+	Model(const std::string& filename, AssetLoader& loader);
+
+	void loadModel(const std::string& filename, AssetLoader* loader = nullptr);
+
+	// swaps in textures that finished loading, true once none are pending
+	bool resolvePendingTextures();
+	void waitForTextures();
 
 	void setPosition(const glm::vec3& position);
 	void setRotation(const glm::vec3& rotation);
@@ -29,6 +38,7 @@ private:
 	void updateModelMatrix();
 
 	std::vector<Mesh> mMeshes;
+	std::vector<std::shared_ptr<Material>> mMaterials;
 	glm::mat4 mModelMatrix;
 
 	glm::vec3 mPosition;
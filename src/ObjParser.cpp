@@ -0,0 +1,370 @@
+#include "ObjParser.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <execution>
+#include <fstream>
+#include <map>
+#include <numeric>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "tiny_obj_loader.h"
+
+namespace
+{
+	// o, g, usemtl or mtllib, placed before the corner it precedes
+	struct Statement
+	{
+		enum class Kind { Shape, UseMaterial, MaterialLibrary };
+
+		Kind kind;
+		size_t corner;
+		std::string argument;
+	};
+
+	// negative indices count back from the attributes read so far, which is only known once
+	// every earlier chunk has been counted
+	struct RelativeIndex
+	{
+		size_t corner;
+		int component; // 0 position, 1 texcoord, 2 normal
+		int localIndex; // relative to the first attribute of the chunk, may be negative
+	};
+
+	struct Chunk
+	{
+		std::vector<float> positions;
+		std::vector<float> texcoords;
+		std::vector<float> normals;
+		std::vector<ObjCorner> corners;
+		std::vector<Statement> statements;
+		std::vector<RelativeIndex> relativeIndices;
+		size_t invalidFaces = 0;
+	};
+
+	constexpr int INVALID_INDEX = -2;
+	constexpr size_t TARGET_CHUNK_BYTES = size_t(1) << 20;
+}
+
+static bool isSpace(const char c)
+{
+	return c == ' ' || c == '\t';
+}
+
+static const char* skipSpaces(const char* cursor, const char* end)
+{
+	while (cursor < end && isSpace(*cursor)) ++cursor;
+	return cursor;
+}
+
+static float parseFloat(const char*& cursor, const char* end)
+{
+	cursor = skipSpaces(cursor, end);
+	if (cursor < end && *cursor == '+') ++cursor;
+
+	float value = 0.0f;
+	const auto result = std::from_chars(cursor, end, value);
+	cursor = result.ptr;
+	return result.ec == std::errc() ? value : 0.0f;
+}
+
+static std::string_view parseWord(const char*& cursor, const char* end)
+{
+	cursor = skipSpaces(cursor, end);
+	const char* start = cursor;
+	while (cursor < end && !isSpace(*cursor)) ++cursor;
+	return {start, static_cast<size_t>(cursor - start)};
+}
+
+// one face vertex "v", "v/vt", "v//vn" or "v/vt/vn"
+static bool parseFaceVertex(const char*& cursor, const char* end, int (&indices)[3])
+{
+	indices[0] = indices[1] = indices[2] = 0;
+	for (int component = 0; component < 3; ++component)
+	{
+		if (cursor < end && *cursor != '/')
+		{
+			const auto result = std::from_chars(cursor, end, indices[component]);
+			if (result.ec != std::errc()) return component > 0;
+			cursor = result.ptr;
+		}
+
+		if (cursor >= end || *cursor != '/') break;
+		++cursor;
+	}
+	return true;
+}
+
+static void parseChunk(const char* begin, const char* end, Chunk& chunk)
+{
+	std::vector<ObjCorner> face;
+	std::vector<RelativeIndex> faceRelative;
+
+	const char* line = begin;
+	while (line < end)
+	{
+		const char* lineEnd = static_cast<const char*>(std::memchr(line, '\n', end - line));
+		if (!lineEnd) lineEnd = end;
+		const char* next = lineEnd + (lineEnd < end ? 1 : 0);
+		if (lineEnd > line && lineEnd[-1] == '\r') --lineEnd;
+
+		const char* cursor = skipSpaces(line, lineEnd);
+		line = next;
+		if (cursor + 1 >= lineEnd || *cursor == '#') continue;
+
+		if (cursor[0] == 'v' && isSpace(cursor[1]))
+		{
+			cursor += 2;
+			chunk.positions.push_back(parseFloat(cursor, lineEnd));
+			chunk.positions.push_back(parseFloat(cursor, lineEnd));
+			chunk.positions.push_back(parseFloat(cursor, lineEnd));
+		}
+		else if (cursor[0] == 'v' && cursor[1] == 't' && cursor + 2 < lineEnd && isSpace(cursor[2]))
+		{
+			cursor += 3;
+			chunk.texcoords.push_back(parseFloat(cursor, lineEnd));
+			chunk.texcoords.push_back(parseFloat(cursor, lineEnd));
+		}
+		else if (cursor[0] == 'v' && cursor[1] == 'n' && cursor + 2 < lineEnd && isSpace(cursor[2]))
+		{
+			cursor += 3;
+			chunk.normals.push_back(parseFloat(cursor, lineEnd));
+			chunk.normals.push_back(parseFloat(cursor, lineEnd));
+			chunk.normals.push_back(parseFloat(cursor, lineEnd));
+		}
+		else if (cursor[0] == 'f' && isSpace(cursor[1]))
+		{
+			cursor += 2;
+			face.clear();
+			faceRelative.clear();
+			bool valid = true;
+
+			const int counts[3] = {
+				static_cast<int>(chunk.positions.size() / 3),
+				static_cast<int>(chunk.texcoords.size() / 2),
+				static_cast<int>(chunk.normals.size() / 3)
+			};
+
+			while ((cursor = skipSpaces(cursor, lineEnd)) < lineEnd)
+			{
+				int raw[3];
+				if (!parseFaceVertex(cursor, lineEnd, raw))
+				{
+					valid = false;
+					break;
+				}
+
+				ObjCorner corner{};
+				int* resolved[3] = {&corner.position, &corner.texcoord, &corner.normal};
+				for (int component = 0; component < 3; ++component)
+				{
+					if (raw[component] > 0)
+					{
+						*resolved[component] = raw[component] - 1;
+					}
+					else if (raw[component] < 0)
+					{
+						*resolved[component] = INVALID_INDEX;
+						faceRelative.push_back({face.size(), component, counts[component] + raw[component]});
+					}
+					else
+					{
+						// a missing position makes the face unusable
+						*resolved[component] = component == 0 ? INVALID_INDEX : -1;
+					}
+				}
+				face.push_back(corner);
+			}
+
+			if (!valid || face.size() < 3)
+			{
+				++chunk.invalidFaces;
+				continue;
+			}
+
+			// fan around the first vertex
+			auto emit = [&](const size_t polygonCorner)
+			{
+				for (const RelativeIndex& relative : faceRelative)
+				{
+					if (relative.corner == polygonCorner)
+						chunk.relativeIndices.push_back({chunk.corners.size(), relative.component, relative.localIndex});
+				}
+				chunk.corners.push_back(face[polygonCorner]);
+			};
+			for (size_t i = 2; i < face.size(); ++i)
+			{
+				emit(0);
+				emit(i - 1);
+				emit(i);
+			}
+		}
+		else if ((cursor[0] == 'o' || cursor[0] == 'g') && isSpace(cursor[1]))
+		{
+			cursor += 2;
+			chunk.statements.push_back({Statement::Kind::Shape, chunk.corners.size(), std::string(parseWord(cursor, lineEnd))});
+		}
+		else if (lineEnd - cursor > 7 && std::memcmp(cursor, "usemtl", 6) == 0 && isSpace(cursor[6]))
+		{
+			cursor += 7;
+			chunk.statements.push_back({Statement::Kind::UseMaterial, chunk.corners.size(), std::string(parseWord(cursor, lineEnd))});
+		}
+		else if (lineEnd - cursor > 7 && std::memcmp(cursor, "mtllib", 6) == 0 && isSpace(cursor[6]))
+		{
+			cursor += 7;
+			chunk.statements.push_back({Statement::Kind::MaterialLibrary, chunk.corners.size(), std::string(skipSpaces(cursor, lineEnd), lineEnd)});
+		}
+	}
+}
+
+// tries each file name on the line in turn, like tinyobj
+static void loadMaterialLibrary(const std::string& line, const std::string& materialDirectory,
+                                std::map<std::string, int>& materialMap, ObjData& data)
+{
+	const char* cursor = line.data();
+	const char* end = cursor + line.size();
+	while (cursor < end)
+	{
+		const std::string fileName(parseWord(cursor, end));
+		if (fileName.empty()) break;
+
+		std::ifstream file(materialDirectory + fileName);
+		if (file)
+		{
+			std::string warning;
+			tinyobj::LoadMtl(&materialMap, &data.materials, &file, &warning);
+			data.warnings += warning;
+			return;
+		}
+	}
+	data.warnings += "Failed to load material file(s): " + line + '\n';
+}
+
+ObjData parseObj(const std::string& path, const std::string& materialDirectory, size_t chunkCount)
+{
+	const MappedFile file(path);
+	ObjData data;
+	if (!file.data())
+	{
+		if (std::ifstream(path)) return data; // empty file
+		throw std::runtime_error("Failed to open OBJ file: " + path);
+	}
+
+	const char* text = reinterpret_cast<const char*>(file.data());
+	const size_t size = file.size();
+	if (chunkCount == 0)
+	{
+		const size_t threads = std::max(1u, std::thread::hardware_concurrency());
+		chunkCount = std::clamp(size / TARGET_CHUNK_BYTES, size_t(1), threads * 4);
+	}
+
+	// split at line starts, a chunk may end up empty
+	std::vector<size_t> boundaries(chunkCount + 1, size);
+	boundaries[0] = 0;
+	for (size_t i = 1; i < chunkCount; ++i)
+	{
+		size_t offset = std::max(boundaries[i - 1], size * i / chunkCount);
+		if (offset > 0 && offset < size && text[offset - 1] != '\n')
+		{
+			const void* newline = std::memchr(text + offset, '\n', size - offset);
+			offset = newline ? static_cast<const char*>(newline) - text + 1 : size;
+		}
+		boundaries[i] = offset;
+	}
+
+	std::vector<Chunk> chunks(chunkCount);
+	std::vector<size_t> chunkIndices(chunkCount);
+	std::iota(chunkIndices.begin(), chunkIndices.end(), size_t(0));
+	std::for_each(std::execution::par, chunkIndices.begin(), chunkIndices.end(), [&](const size_t i)
+	{
+		parseChunk(text + boundaries[i], text + boundaries[i + 1], chunks[i]);
+	});
+
+	// attribute offsets of each chunk
+	std::vector<size_t> positionBase(chunkCount + 1, 0), texcoordBase(chunkCount + 1, 0), normalBase(chunkCount + 1, 0);
+	for (size_t i = 0; i < chunkCount; ++i)
+	{
+		positionBase[i + 1] = positionBase[i] + chunks[i].positions.size() / 3;
+		texcoordBase[i + 1] = texcoordBase[i] + chunks[i].texcoords.size() / 2;
+		normalBase[i + 1] = normalBase[i] + chunks[i].normals.size() / 3;
+	}
+	data.positions.resize(positionBase[chunkCount] * 3);
+	data.texcoords.resize(texcoordBase[chunkCount] * 2);
+	data.normals.resize(normalBase[chunkCount] * 3);
+
+	std::for_each(std::execution::par, chunkIndices.begin(), chunkIndices.end(), [&](const size_t i)
+	{
+		Chunk& chunk = chunks[i];
+		std::copy(chunk.positions.begin(), chunk.positions.end(), data.positions.begin() + positionBase[i] * 3);
+		std::copy(chunk.texcoords.begin(), chunk.texcoords.end(), data.texcoords.begin() + texcoordBase[i] * 2);
+		std::copy(chunk.normals.begin(), chunk.normals.end(), data.normals.begin() + normalBase[i] * 3);
+
+		for (const RelativeIndex& relative : chunk.relativeIndices)
+		{
+			const size_t bases[3] = {positionBase[i], texcoordBase[i], normalBase[i]};
+			const long long index = static_cast<long long>(bases[relative.component]) + relative.localIndex;
+			int* targets[3] = {&chunk.corners[relative.corner].position, &chunk.corners[relative.corner].texcoord,
+			                   &chunk.corners[relative.corner].normal};
+			*targets[relative.component] = index >= 0 ? static_cast<int>(index) : INVALID_INDEX;
+		}
+	});
+
+	// walk the statements in file order to cut shapes and assign materials
+	std::map<std::string, int> materialMap;
+	int material = -1;
+	ObjShape shape;
+	size_t invalidFaces = 0;
+	auto flushShape = [&](std::string nextName)
+	{
+		if (!shape.corners.empty()) data.shapes.push_back(std::move(shape));
+		shape = ObjShape();
+		shape.name = std::move(nextName);
+	};
+	auto appendCorners = [&](const Chunk& chunk, const size_t first, const size_t last)
+	{
+		if (first == last) return;
+		if (shape.corners.empty()) shape.materialId = material;
+		shape.corners.insert(shape.corners.end(), chunk.corners.begin() + first, chunk.corners.begin() + last);
+	};
+
+	for (Chunk& chunk : chunks)
+	{
+		size_t corner = 0;
+		for (Statement& statement : chunk.statements)
+		{
+			appendCorners(chunk, corner, statement.corner);
+			corner = statement.corner;
+
+			switch (statement.kind)
+			{
+			case Statement::Kind::Shape:
+				flushShape(std::move(statement.argument));
+				break;
+			case Statement::Kind::UseMaterial:
+			{
+				const auto it = materialMap.find(statement.argument);
+				material = it != materialMap.end() ? it->second : -1;
+				break;
+			}
+			case Statement::Kind::MaterialLibrary:
+				loadMaterialLibrary(statement.argument, materialDirectory, materialMap, data);
+				break;
+			}
+		}
+		appendCorners(chunk, corner, chunk.corners.size());
+		invalidFaces += chunk.invalidFaces;
+
+		// release each chunk as soon as it has been stitched
+		chunk = Chunk();
+	}
+	flushShape({});
+
+	if (invalidFaces > 0)
+	{
+		data.warnings += std::to_string(invalidFaces) + " malformed faces were skipped\n";
+	}
+	return data;
+}
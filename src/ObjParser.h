@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "tiny_obj_loader.h"
+
+// zero-based attribute indices of one triangle corner, -1 when the face has no such attribute
+struct ObjCorner
+{
+	int position;
+	int texcoord;
+	int normal;
+};
+
+// faces between two o/g statements, polygons fanned into triangles
+struct ObjShape
+{
+	std::string name;
+	int materialId = -1; // material active at the first face, as with tinyobj
+	std::vector<ObjCorner> corners;
+};
+
+struct ObjData
+{
+	std::vector<float> positions; // xyz
+	std::vector<float> texcoords; // uv
+	std::vector<float> normals; // xyz
+	std::vector<ObjShape> shapes;
+	std::vector<tinyobj::material_t> materials;
+	std::string warnings;
+};
+
+// maps the file and parses newline-aligned chunks in parallel, then stitches the chunks together in order;
+// materials come from the mtllib files next to materialDirectory through tinyobj's MTL reader.
+// zero chunks picks a count from the file size; throws std::runtime_error when the file cannot be read
+ObjData parseObj(const std::string& path, const std::string& materialDirectory, size_t chunkCount = 0);
@@ -0,0 +1,480 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <immintrin.h>
+#include <glm/glm.hpp>
+#include "Framebuffer.h"
+#include "Light.h"
+#include "Texture.h"
+
+// attribute plane: value = base + dx * (x - originX) + dy * (y - originY)
+struct AttributePlane
+{
+	float base, dx, dy;
+};
+
+struct TriangleData
+{
+	// screen-space bounds
+	int minX, maxX, minY, maxY;
+
+	// fixed-point edge functions at pixel centres, A*x + B*y + C < 0 inside
+	int edgeA[3];
+	int edgeB[3];
+	int64_t edgeC[3];
+
+	// added to the pixel centre edge values for each MSAA sample, only set up for multisampled targets
+	int sampleEdgeOffsets[4][3];
+
+	// attribute plane origin (vertex 0 in pixels)
+	float originX, originY;
+
+	// clip-space w range of the corners, view depth for perspective projections
+	float minW, maxW;
+
+	//attributes, all but depth and invW are divided by w
+	AttributePlane depth;
+	AttributePlane invW;
+	AttributePlane u, v;
+	AttributePlane normalX;
+	AttributePlane normalY;
+	AttributePlane normalZ;
+	AttributePlane worldX, worldY, worldZ;
+	AttributePlane lightR, lightG, lightB; // per-vertex lighting only
+};
+
+// post-transform vertex carried through clipping
+struct ClipVertex
+{
+	glm::vec4 position;
+	float u, v;
+	glm::vec3 normal;
+	glm::vec3 worldPosition;
+	glm::vec3 light; // lit intensity per channel, only computed for per-vertex lighting
+};
+
+// pipeline configuration of a draw, every combination is compiled into its own rasterizer
+enum PipelineFlags : uint32_t
+{
+	PIPELINE_TEXTURED = 1 << 0, // samples the diffuse texture, interpolates UVs
+	PIPELINE_MIPMAPPED = 1 << 1, // picks a mip level per quad
+	PIPELINE_LIT = 1 << 2, // diffuse lighting, interpolates normals
+	PIPELINE_DEPTH_WRITE = 1 << 3,
+	PIPELINE_VERTEX_LIT = 1 << 4, // with PIPELINE_LIT: lights vertices, interpolates their light instead of normals
+	PIPELINE_ALPHA_TEST = 1 << 5, // discards lanes whose alpha is below the cutoff
+	PIPELINE_BLEND = 1 << 6, // blends over the framebuffer by alpha, triangles are sorted back to front per tile
+	PIPELINE_VARIANTS = 1 << 7 // bound of the flag combinations, only normalized ones get a rasterizer
+};
+
+// clears flags that change nothing in their combination, so equivalent states share one variant:
+// mipmapping without a texture, per-vertex lighting without lighting, and depth writes or the alpha
+// test on blended surfaces, which never write depth and whose materials have no cutoff
+constexpr uint32_t normalizePipeline(uint32_t pipeline)
+{
+	if (!(pipeline & PIPELINE_TEXTURED))
+		pipeline &= ~PIPELINE_MIPMAPPED;
+	if (!(pipeline & PIPELINE_LIT))
+		pipeline &= ~PIPELINE_VERTEX_LIT;
+	if (pipeline & PIPELINE_BLEND)
+		pipeline &= ~(PIPELINE_DEPTH_WRITE | PIPELINE_ALPHA_TEST);
+	return pipeline;
+}
+
+// 4x MSAA rotated grid sample positions in 1/16 pixel, relative to the pixel centre
+inline constexpr int MSAA_SAMPLE_COUNT = 4;
+inline constexpr int MSAA_SAMPLE_POSITIONS[MSAA_SAMPLE_COUNT][2] = {{-2, -6}, {6, -2}, {-6, 2}, {2, 6}};
+
+// material state the fragment stage needs, resolved once per draw
+struct DrawState
+{
+	uint32_t pipeline;
+	const Texture* diffuseMap; // loaded, null when untextured
+	TextureFilter filter;
+	uint32_t baseColor; // used instead of the texture when untextured
+	int alphaCutoff = 0; // lowest alpha in [0,255] kept by the alpha test
+	TextureWrap wrapU = TextureWrap::ClampToEdge;
+	TextureWrap wrapV = TextureWrap::ClampToEdge;
+
+	// lights overlapping the tile being shaded, filled in per tile
+	const ShadingLight* lights = nullptr;
+	const uint16_t* lightIndices = nullptr;
+	int lightCount = 0;
+};
+
+// four horizontally adjacent pixels in SoA form, varyings are already perspective-correct;
+// uv is only interpolated for textured pipelines, the normal and world position for per-pixel lit ones
+// and the light for per-vertex lit ones, zero otherwise
+struct FragmentQuad
+{
+	__m128i x, y;
+	__m128 depth;
+	__m128 u, v;
+	__m128 normalX, normalY, normalZ; // world space, not renormalized
+	__m128 worldX, worldY, worldZ;
+	__m128 lightR, lightG, lightB;
+	float lod; // mip level of the diffuse map, 0 unless mipmapped
+	int mask; // covered and depth-passing lanes
+};
+
+// triangles binned to one screen tile
+struct TileJob
+{
+	int minX, minY, maxX, maxY; // max is exclusive
+	const TriangleData* triangles;
+	const size_t* triangleIndices;
+	int triangleCount;
+	const uint16_t* lightIndices;
+	int lightCount;
+};
+
+// scanline rasterizer, instantiated for every fragment program and pipeline variant
+namespace Rasterizer
+{
+	// any edge value past this keeps its sign across a tile, so clamping makes 32-bit stepping safe
+	inline constexpr int64_t EDGE_CLAMP = int64_t(1) << 29;
+
+	inline const __m128i OFFSETS_I = _mm_set_epi32(3, 2, 1, 0);
+	inline const __m128i INC_XI = _mm_set1_epi32(4);
+	inline const __m128 ONE = _mm_set1_ps(1.0f);
+	inline const __m128 ZERO = _mm_setzero_ps();
+	inline const __m128 PIXEL_OFFSETS = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+	inline const __m128 INC_XF = _mm_set1_ps(4.0f);
+
+	// programs declaring WRITES_COLOR = false only write depth, nothing is interpolated or shaded
+	template <typename Program>
+	constexpr bool writesColor()
+	{
+		if constexpr (requires { Program::WRITES_COLOR; })
+			return Program::WRITES_COLOR;
+		else
+			return true;
+	}
+
+	// programs declaring WRITES_GBUFFER = true store their quads through writeGBuffer instead of
+	// shading them into the framebuffer, the geometry pass of deferred shading
+	template <typename Program>
+	constexpr bool writesGBuffer()
+	{
+		if constexpr (requires { Program::WRITES_GBUFFER; })
+			return Program::WRITES_GBUFFER;
+		else
+			return false;
+	}
+
+	// the variant a program runs for a pipeline: depth-only programs keep only the depth write, and blended
+	// surfaces never reach the G-buffer, which the resolve lights per pixel
+	template <typename Program>
+	constexpr uint32_t programPipeline(const uint32_t pipeline)
+	{
+		if constexpr (!writesColor<Program>())
+			return pipeline & PIPELINE_DEPTH_WRITE;
+		else if constexpr (writesGBuffer<Program>())
+			return normalizePipeline(pipeline) & ~(PIPELINE_BLEND | PIPELINE_VERTEX_LIT);
+		else
+			return normalizePipeline(pipeline);
+	}
+
+	// every pipeline programPipeline can return for the program, in ascending order
+	template <typename Program>
+	constexpr auto reachablePipelines()
+	{
+		constexpr size_t count = []
+		{
+			size_t reachable = 0;
+			for (uint32_t pipeline = 0; pipeline < PIPELINE_VARIANTS; ++pipeline)
+				reachable += programPipeline<Program>(pipeline) == pipeline;
+			return reachable;
+		}();
+
+		std::array<uint32_t, count> pipelines{};
+		size_t next = 0;
+		for (uint32_t pipeline = 0; pipeline < PIPELINE_VARIANTS; ++pipeline)
+		{
+			if (programPipeline<Program>(pipeline) == pipeline)
+				pipelines[next++] = pipeline;
+		}
+		return pipelines;
+	}
+
+	// programs may specialize fragment on the pipeline or take any pipeline with a plain function
+	template <uint32_t Pipeline, typename Program>
+	__m128i shadeQuad(const Program& program, const FragmentQuad& quad, const DrawState& draw)
+	{
+		if constexpr (!writesColor<Program>())
+			return _mm_setzero_si128();
+		else if constexpr (requires { program.template fragment<Pipeline>(quad, draw); })
+			return program.template fragment<Pipeline>(quad, draw);
+		else
+			return program.fragment(quad, draw);
+	}
+
+	// lanes of four packed colors that pass the draw's alpha test
+	inline int alphaTestMask(const __m128i colors, const DrawState& draw)
+	{
+		const __m128i alpha = _mm_srli_epi32(colors, 24);
+		return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(alpha, _mm_set1_epi32(draw.alphaCutoff - 1))));
+	}
+
+	// coverage and depth are tested for each of Samples samples, fragments are shaded once per pixel
+	template <uint32_t Pipeline, int Samples, typename Program>
+	void rasterizeScanline(const Program& program, Framebuffer& framebuffer, const DrawState& draw,
+	                       const TriangleData& triangle, const int y, const int startX, const int endX)
+	{
+		static_assert(Samples == 1 || Samples == MSAA_SAMPLE_COUNT, "Unsupported sample count");
+		constexpr bool multisampled = Samples > 1;
+
+		constexpr bool textured = (Pipeline & PIPELINE_TEXTURED) != 0;
+		constexpr bool mipmapped = textured && (Pipeline & PIPELINE_MIPMAPPED) != 0;
+		constexpr bool lit = (Pipeline & PIPELINE_LIT) != 0;
+		constexpr bool vertexLit = lit && (Pipeline & PIPELINE_VERTEX_LIT) != 0;
+		constexpr bool pixelLit = lit && !vertexLit;
+
+		// validate scanline bounds
+		assert(startX <= endX && "Start X must be less than or equal to end X");
+		assert(y >= 0 && "Y coordinate must be non-negative");
+
+		if (startX >= endX) return; // empty scanline
+
+		const __m128i yInt = _mm_set1_epi32(y);
+		const __m128i endXInt = _mm_set1_epi32(endX);
+
+		const int baseX = startX;
+		const int quadCount = ((endX - baseX) + 3) >> 2; // ceiling division by 4
+
+		// process 4 pixels at once
+		__m128i xInt = _mm_add_epi32(_mm_set1_epi32(baseX), OFFSETS_I);
+
+		// evaluate edge equations exactly at the first pixel's samples, then clamp so 32-bit stepping cannot overflow
+		__m128i edges[Samples][3];
+		__m128i edgeSteps[3];
+		for (int i = 0; i < 3; ++i)
+		{
+			const int64_t value = static_cast<int64_t>(triangle.edgeA[i]) * baseX +
+				static_cast<int64_t>(triangle.edgeB[i]) * y + triangle.edgeC[i];
+
+			const __m128i edgeA = _mm_set1_epi32(triangle.edgeA[i]);
+			const __m128i offsets = _mm_mullo_epi32(edgeA, OFFSETS_I);
+			edgeSteps[i] = _mm_slli_epi32(edgeA, 2);
+
+			for (int s = 0; s < Samples; ++s)
+			{
+				const int64_t sampleValue = multisampled ? value + triangle.sampleEdgeOffsets[s][i] : value;
+				const int clamped = static_cast<int>(std::clamp(sampleValue, -EDGE_CLAMP, EDGE_CLAMP));
+				edges[s][i] = _mm_add_epi32(_mm_set1_epi32(clamped), offsets);
+			}
+		}
+
+		// depth at each sample relative to the pixel centre
+		float sampleDepthOffsets[Samples] = {};
+		if constexpr (multisampled)
+		{
+			for (int s = 0; s < Samples; ++s)
+			{
+				sampleDepthOffsets[s] = (triangle.depth.dx * MSAA_SAMPLE_POSITIONS[s][0] +
+					triangle.depth.dy * MSAA_SAMPLE_POSITIONS[s][1]) * (1.0f / 16.0f);
+			}
+		}
+
+		// pixel centres relative to the attribute plane origin
+		__m128 planeX = _mm_add_ps(_mm_set1_ps(static_cast<float>(baseX) + 0.5f - triangle.originX), PIXEL_OFFSETS);
+		const float planeY = static_cast<float>(y) + 0.5f - triangle.originY;
+
+		// planes the pipeline does not read are never touched
+		const __m128 depthRow = _mm_set1_ps(triangle.depth.base + triangle.depth.dy * planeY);
+		__m128 invWRow = ZERO, uRow = ZERO, vRow = ZERO;
+		__m128 normalXRow = ZERO, normalYRow = ZERO, normalZRow = ZERO;
+		__m128 worldXRow = ZERO, worldYRow = ZERO, worldZRow = ZERO;
+		__m128 lightRRow = ZERO, lightGRow = ZERO, lightBRow = ZERO;
+		if constexpr (textured || lit)
+		{
+			invWRow = _mm_set1_ps(triangle.invW.base + triangle.invW.dy * planeY);
+		}
+		if constexpr (textured)
+		{
+			uRow = _mm_set1_ps(triangle.u.base + triangle.u.dy * planeY);
+			vRow = _mm_set1_ps(triangle.v.base + triangle.v.dy * planeY);
+		}
+		if constexpr (pixelLit)
+		{
+			normalXRow = _mm_set1_ps(triangle.normalX.base + triangle.normalX.dy * planeY);
+			normalYRow = _mm_set1_ps(triangle.normalY.base + triangle.normalY.dy * planeY);
+			normalZRow = _mm_set1_ps(triangle.normalZ.base + triangle.normalZ.dy * planeY);
+			worldXRow = _mm_set1_ps(triangle.worldX.base + triangle.worldX.dy * planeY);
+			worldYRow = _mm_set1_ps(triangle.worldY.base + triangle.worldY.dy * planeY);
+			worldZRow = _mm_set1_ps(triangle.worldZ.base + triangle.worldZ.dy * planeY);
+		}
+		if constexpr (vertexLit)
+		{
+			lightRRow = _mm_set1_ps(triangle.lightR.base + triangle.lightR.dy * planeY);
+			lightGRow = _mm_set1_ps(triangle.lightG.base + triangle.lightG.dy * planeY);
+			lightBRow = _mm_set1_ps(triangle.lightB.base + triangle.lightB.dy * planeY);
+		}
+
+		for (int q = 0; q < quadCount; ++q, planeX = _mm_add_ps(planeX, INC_XF))
+		{
+			// inside when every edge value is negative, lanes past the span are dropped
+			const int spanMask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(xInt, endXInt)));
+			int sampleMasks[Samples];
+			int insideMask = 0;
+			for (int s = 0; s < Samples; ++s)
+			{
+				const __m128i inside = _mm_and_si128(_mm_and_si128(edges[s][0], edges[s][1]), edges[s][2]);
+				sampleMasks[s] = _mm_movemask_ps(_mm_castsi128_ps(inside)) & spanMask;
+				insideMask |= sampleMasks[s];
+
+				edges[s][0] = _mm_add_epi32(edges[s][0], edgeSteps[0]);
+				edges[s][1] = _mm_add_epi32(edges[s][1], edgeSteps[1]);
+				edges[s][2] = _mm_add_epi32(edges[s][2], edgeSteps[2]);
+			}
+
+			const __m128i quadX = xInt;
+			xInt = _mm_add_epi32(xInt, INC_XI);
+
+			if (!insideMask) continue;
+
+			// interpolate depth, then test every covered sample
+			const __m128 depth = _mm_fmadd_ps(_mm_set1_ps(triangle.depth.dx), planeX, depthRow);
+			__m128 sampleDepths[Samples];
+			insideMask = 0;
+			for (int s = 0; s < Samples; ++s)
+			{
+				sampleDepths[s] = multisampled ? _mm_add_ps(depth, _mm_set1_ps(sampleDepthOffsets[s])) : depth;
+				if (!sampleMasks[s]) continue;
+				sampleMasks[s] &= framebuffer.depthTest(quadX, yInt, sampleDepths[s], s);
+				insideMask |= sampleMasks[s];
+			}
+
+			if (!insideMask) continue;
+
+			if constexpr (!writesColor<Program>())
+			{
+				for (int s = 0; s < Samples; ++s)
+					framebuffer.setDepth(quadX, yInt, sampleDepths[s], sampleMasks[s], s);
+				continue;
+			}
+
+			FragmentQuad quad{
+				quadX, yInt, depth, ZERO, ZERO, ZERO, ZERO, ZERO, ZERO, ZERO, ZERO, ZERO, ZERO, ZERO, 0.0f, insideMask
+			};
+			__m128 rcp = ONE;
+
+			// perspective correction, attributes were divided by w at setup
+			if constexpr (textured || lit)
+			{
+				const __m128 invW = _mm_fmadd_ps(_mm_set1_ps(triangle.invW.dx), planeX, invWRow);
+				rcp = _mm_div_ps(ONE, invW);
+			}
+
+			// interpolate attributes
+			if constexpr (textured)
+			{
+				quad.u = _mm_mul_ps(_mm_fmadd_ps(_mm_set1_ps(triangle.u.dx), planeX, uRow), rcp);
+				quad.v = _mm_mul_ps(_mm_fmadd_ps(_mm_set1_ps(triangle.v.dx), planeX, vRow), rcp);
+			}
+			if constexpr (pixelLit)
+			{
+				quad.normalX = _mm_mul_ps(_mm_fmadd_ps(_mm_set1_ps(triangle.normalX.dx), planeX, normalXRow), rcp);
+				quad.normalY = _mm_mul_ps(_mm_fmadd_ps(_mm_set1_ps(triangle.normalY.dx), planeX, normalYRow), rcp);
+				quad.normalZ = _mm_mul_ps(_mm_fmadd_ps(_mm_set1_ps(triangle.normalZ.dx), planeX, normalZRow), rcp);
+				quad.worldX = _mm_mul_ps(_mm_fmadd_ps(_mm_set1_ps(triangle.worldX.dx), planeX, worldXRow), rcp);
+				quad.worldY = _mm_mul_ps(_mm_fmadd_ps(_mm_set1_ps(triangle.worldY.dx), planeX, worldYRow), rcp);
+				quad.worldZ = _mm_mul_ps(_mm_fmadd_ps(_mm_set1_ps(triangle.worldZ.dx), planeX, worldZRow), rcp);
+			}
+			if constexpr (vertexLit)
+			{
+				quad.lightR = _mm_mul_ps(_mm_fmadd_ps(_mm_set1_ps(triangle.lightR.dx), planeX, lightRRow), rcp);
+				quad.lightG = _mm_mul_ps(_mm_fmadd_ps(_mm_set1_ps(triangle.lightG.dx), planeX, lightGRow), rcp);
+				quad.lightB = _mm_mul_ps(_mm_fmadd_ps(_mm_set1_ps(triangle.lightB.dx), planeX, lightBRow), rcp);
+			}
+
+			// analytic uv derivatives of the perspective divide pick one mip level per quad
+			if constexpr (mipmapped)
+			{
+				const __m128 invWdx = _mm_set1_ps(triangle.invW.dx);
+				const __m128 invWdy = _mm_set1_ps(triangle.invW.dy);
+				const __m128 dudx = _mm_mul_ps(_mm_fnmadd_ps(quad.u, invWdx, _mm_set1_ps(triangle.u.dx)), rcp);
+				const __m128 dvdx = _mm_mul_ps(_mm_fnmadd_ps(quad.v, invWdx, _mm_set1_ps(triangle.v.dx)), rcp);
+				const __m128 dudy = _mm_mul_ps(_mm_fnmadd_ps(quad.u, invWdy, _mm_set1_ps(triangle.u.dy)), rcp);
+				const __m128 dvdy = _mm_mul_ps(_mm_fnmadd_ps(quad.v, invWdy, _mm_set1_ps(triangle.v.dy)), rcp);
+				quad.lod = draw.diffuseMap->computeLod(dudx, dvdx, dudy, dvdy, insideMask);
+			}
+
+			// the pixel is shaded once at its centre, its color goes to every sample that passed;
+			// depth is written after shading, so alpha-tested lanes do not occlude
+			if constexpr (writesGBuffer<Program>())
+			{
+				static_assert(!multisampled, "The G-buffer stores one surface per pixel");
+				sampleMasks[0] &= program.template writeGBuffer<Pipeline>(quad, draw);
+			}
+			else
+			{
+				const __m128i colors = shadeQuad<Pipeline>(program, quad, draw);
+				const int alphaMask = (Pipeline & PIPELINE_ALPHA_TEST) != 0 ? alphaTestMask(colors, draw) : 0xF;
+
+				for (int s = 0; s < Samples; ++s)
+				{
+					sampleMasks[s] &= alphaMask;
+					if constexpr ((Pipeline & PIPELINE_BLEND) != 0)
+						framebuffer.blendPixel(quadX, yInt, colors, sampleMasks[s], s);
+					else
+						framebuffer.setPixel(quadX, yInt, colors, sampleMasks[s], s);
+				}
+			}
+
+			if constexpr ((Pipeline & PIPELINE_DEPTH_WRITE) != 0)
+			{
+				for (int s = 0; s < Samples; ++s)
+					framebuffer.setDepth(quadX, yInt, sampleDepths[s], sampleMasks[s], s);
+			}
+		}
+	}
+
+	template <uint32_t Pipeline, int Samples, typename Program>
+	void rasterizeTriangles(const Program& program, Framebuffer& framebuffer, const DrawState& draw,
+	                        const TileJob& tile)
+	{
+		for (int i = 0; i < tile.triangleCount; ++i)
+		{
+			const TriangleData& triangle = tile.triangles[tile.triangleIndices[i]];
+
+			const int minX = std::max(tile.minX, triangle.minX);
+			const int maxX = std::min(tile.maxX - 1, triangle.maxX);
+			const int minY = std::max(tile.minY, triangle.minY);
+			const int maxY = std::min(tile.maxY - 1, triangle.maxY);
+
+			if (minX > maxX || minY > maxY) continue;
+
+			for (int y = minY; y <= maxY; ++y)
+			{
+				rasterizeScanline<Pipeline, Samples>(program, framebuffer, draw, triangle, y, minX, maxX + 1);
+			}
+		}
+	}
+
+	template <uint32_t Pipeline, typename Program>
+	void rasterizeTile(const Program& program, Framebuffer& framebuffer, const DrawState& draw, const TileJob& tile)
+	{
+		// validate input parameters
+		assert(tile.triangleIndices && "Triangle indices pointer cannot be null");
+		assert(tile.triangleCount >= 0 && "Triangle count must be non-negative");
+
+		DrawState tileDraw = draw;
+		tileDraw.lightIndices = tile.lightIndices;
+		tileDraw.lightCount = tile.lightCount;
+
+		// the G-buffer pass never targets a multisampled framebuffer
+		if constexpr (!writesGBuffer<Program>())
+		{
+			if (framebuffer.getSampleCount() == MSAA_SAMPLE_COUNT)
+			{
+				rasterizeTriangles<Pipeline, MSAA_SAMPLE_COUNT>(program, framebuffer, tileDraw, tile);
+				return;
+			}
+		}
+
+		assert(framebuffer.getSampleCount() == 1 && "Unsupported sample count");
+		rasterizeTriangles<Pipeline, 1>(program, framebuffer, tileDraw, tile);
+	}
+}
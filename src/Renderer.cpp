@@ -1,14 +1,23 @@
 #include "Renderer.h"
 #include "Camera.h"
 #include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <emmintrin.h>
 #include <execution>
 #include <numeric>
 #include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
 
 Renderer::Renderer()
 {
 	preallocateBuffers(1024);
+
+	// matches the former fixed light: n . (0.5, 0.5, 0.5)
+	mLights.push_back(Light::directional(glm::vec3(-1.0f), glm::vec3(1.0f), std::sqrt(0.75f)));
 }
 
 void Renderer::preallocateBuffers(const size_t vertexCount)
@@ -22,6 +31,98 @@ void Renderer::preallocateBuffers(const size_t vertexCount)
 }
 
 void Renderer::renderModel(Framebuffer& framebuffer, const Camera& camera, const Model& model)
+{
+	drawModel(framebuffer, camera, model, nullptr);
+}
+
+void Renderer::setFrameTimeBudget(const float milliseconds)
+{
+	if (!std::isfinite(milliseconds) || milliseconds < 0.0f)
+	{
+		throw std::invalid_argument("Frame time budget must be finite and not negative");
+	}
+
+	// the scale carries over to a new budget and adapts from there
+	mFrameTimeBudget = milliseconds;
+	if (milliseconds == 0.0f)
+	{
+		mRenderScale = 1.0f;
+		mScaledTarget.reset();
+	}
+}
+
+Framebuffer& Renderer::beginFrame(Framebuffer& output)
+{
+	if (mFrameTimeBudget == 0.0f)
+		return output;
+
+	// the internal target matches the output's size, only its viewport shrinks. It keeps the
+	// sample count the caller gave it, the output is only ever scaled into
+	if (!mScaledTarget || mScaledTarget->getWidth() != output.getWidth() ||
+		mScaledTarget->getHeight() != output.getHeight() ||
+		mScaledTarget->getDepthFormat() != output.getDepthFormat())
+	{
+		mScaledTarget = std::make_unique<Framebuffer>(output.getWidth(), output.getHeight(), output.getDepthFormat());
+	}
+	if (mScaledTarget->isReverseZ() != output.isReverseZ())
+		mScaledTarget->setReverseZ(output.isReverseZ());
+
+	const int width = std::max(1, static_cast<int>(std::lround(output.getWidth() * mRenderScale)));
+	const int height = std::max(1, static_cast<int>(std::lround(output.getHeight() * mRenderScale)));
+	mScaledTarget->setViewport({0, 0, width, height});
+
+	mFrameStart = std::chrono::steady_clock::now();
+	return *mScaledTarget;
+}
+
+void Renderer::endFrame(Framebuffer& output)
+{
+	if (mFrameTimeBudget == 0.0f)
+		return;
+	assert(mScaledTarget && "endFrame without beginFrame");
+
+	mScaledTarget->upscale(output);
+
+	const auto frameTime = std::chrono::steady_clock::now() - mFrameStart;
+	adaptRenderScale(std::chrono::duration<float, std::milli>(frameTime).count());
+}
+
+void Renderer::adaptRenderScale(const float frameMilliseconds)
+{
+	// frame time grows with the pixel count, the square of the scale. Only grow with some headroom
+	// left and go half way each frame, so the resolution settles instead of oscillating. The target
+	// is held within a factor of two, so one unusually fast or slow frame moves the scale by at most
+	// half again or a quarter
+	const float ratio = mFrameTimeBudget / std::max(frameMilliseconds, 0.001f);
+	if (ratio >= 1.0f && ratio < 1.2f)
+		return;
+
+	const float target = std::clamp(mRenderScale * std::sqrt(ratio), 0.5f * mRenderScale, 2.0f * mRenderScale);
+	mRenderScale = std::clamp(0.5f * (mRenderScale + target), MIN_RENDER_SCALE, 1.0f);
+}
+
+void Renderer::renderModelDeferred(GBuffer& gbuffer, Framebuffer& framebuffer, const Camera& camera,
+                                   const Model& model)
+{
+	if (gbuffer.getWidth() != framebuffer.getWidth() || gbuffer.getHeight() != framebuffer.getHeight())
+	{
+		throw std::invalid_argument("G-buffer and framebuffer must have the same size");
+	}
+
+	if (framebuffer.getSampleCount() > 1)
+	{
+		throw std::invalid_argument("Deferred shading does not support multisampled framebuffers");
+	}
+
+	if (!framebuffer.isViewportFull())
+	{
+		throw std::invalid_argument("Deferred shading draws to the whole framebuffer");
+	}
+
+	drawModel(framebuffer, camera, model, &gbuffer);
+}
+
+void Renderer::drawModel(Framebuffer& framebuffer, const Camera& camera, const Model& model, GBuffer* gbuffer)
 {
 	if (model.getMeshes().empty())
 	{
@@ -30,32 +131,139 @@ void Renderer::renderModel(Framebuffer& framebuffer, const Camera& camera, const
 	}
 
 	const glm::mat4& modelMatrix = model.getModelMatrix();
+	const Frustum& frustum = camera.getFrustum();
 
 	for (const auto& mesh : model.getMeshes())
 	{
-		renderMesh(framebuffer, camera, mesh, modelMatrix);
+		// skip meshes entirely outside the view before any vertex work
+		const glm::mat4 meshMatrix = modelMatrix * mesh.getLocalMatrix();
+		if (!frustum.intersects(mesh.getBoundingSphere().transformed(meshMatrix)) ||
+			!frustum.intersects(mesh.getBoundingBox().transformed(meshMatrix)))
+		{
+			++mStats.culledMeshes;
+			continue;
+		}
+
+		// blended meshes wait for the opaque ones, the G-buffer holds one surface per pixel
+		const auto material = mesh.getMaterial();
+		if (material && material->getAlphaMode() == AlphaMode::Blend)
+		{
+			(gbuffer ? mDeferredTransparentDraws : mTransparentDraws).push_back({&mesh, modelMatrix});
+			continue;
+		}
+
+		if (!gbuffer)
+		{
+			renderMesh(framebuffer, camera, mesh, modelMatrix);
+			continue;
+		}
+
+		// lighting waits for the resolve, custom shaders are not run in the geometry pass
+		mGBufferShader.bind(gbuffer, gbuffer->addMaterial(material));
+
+		// the resolve lights every pixel, so the G-buffer always needs the normals
+		DrawState draw = resolveDrawState(material);
+		draw.pipeline &= ~PIPELINE_VERTEX_LIT;
+		drawMesh(framebuffer, camera, mesh, modelMatrix, mGBufferShader, draw);
+	}
+}
+
+void Renderer::renderTransparent(Framebuffer& framebuffer, const Camera& camera)
+{
+	drawTransparent(framebuffer, camera, mTransparentDraws);
+}
+
+void Renderer::drawTransparent(Framebuffer& framebuffer, const Camera& camera,
+                               std::vector<TransparentDraw>& draws)
+{
+	if (draws.empty())
+		return;
+
+	// every draw's triangles are assembled first, so the tiles see all of them at once
+	mTriangleData.clear();
+	mValidTriangles.clear();
+	mTriangleCount = 0;
+	mTriangleBatches.clear();
+	mDrawBatches.clear();
+	prepareLights();
+
+	for (const TransparentDraw& queued : draws)
+	{
+		const auto material = queued.mesh->getMaterial();
+		const ShaderProgram& shader = material && material->getShader() ? *material->getShader() : mDefaultShader;
+
+		DrawState draw = resolveDrawState(material);
+		if (draw.pipeline & PIPELINE_LIT)
+			draw.lights = mShadingLights.data();
+
+		assembleMesh(framebuffer, camera, *queued.mesh, queued.modelMatrix, shader, draw);
+		mDrawBatches.push_back({&shader, draw, shader.getTileRasterizer(draw.pipeline)});
+		mTriangleBatches.resize(mTriangleData.size(), static_cast<uint32_t>(mDrawBatches.size() - 1));
 	}
+	draws.clear();
+
+	if (mValidTriangles.empty())
+		return;
+
+	mStats.rasterizedTriangles += mValidTriangles.size();
+	rasterizeTiles(framebuffer, mDrawBatches, camera.getViewProjectionMatrix());
 }
 
 void Renderer::renderMesh(Framebuffer& framebuffer, const Camera& camera, const Mesh& mesh,
                           const glm::mat4& modelMatrix)
 {
-	const auto& vertices = mesh.getVertexArray();
 	const auto material = mesh.getMaterial();
-	assert(vertices.size() > 0 && "Mesh must have vertices to be rendered");
+	const ShaderProgram& shader = material && material->getShader() ? *material->getShader() : mDefaultShader;
 
-	assert(vertices.size() % 3 == 0 && "Vertex count must be divisible by 3");
+	DrawState draw = resolveDrawState(material);
+	if (draw.pipeline & PIPELINE_LIT)
+	{
+		prepareLights();
+		draw.lights = mShadingLights.data();
+	}
+	drawMesh(framebuffer, camera, mesh, modelMatrix, shader, draw);
+}
 
-	const glm::mat4 mvp = camera.getViewProjectionMatrix() * modelMatrix * mesh.getLocalMatrix();
-	const glm::mat3 normalMatrix = glm::inverseTranspose(glm::mat3(modelMatrix * mesh.getLocalMatrix()));
+void Renderer::renderShadowMap(ShadowMap& shadowMap, const Camera& lightCamera,
+                               const std::span<const Model* const> casters)
+{
+	Framebuffer& depthBuffer = shadowMap.getDepthBuffer();
+	depthBuffer.setReverseZ(lightCamera.isReverseZ()); // also clears the depth
+	shadowMap.setViewProjection(lightCamera.getViewProjectionMatrix());
+
+	const Frustum& frustum = lightCamera.getFrustum();
+
+	// positions only: no attribute planes, no shading and no color writes
+	const DrawState draw{PIPELINE_DEPTH_WRITE, nullptr, TextureFilter::Nearest, 0};
 
+	for (const Model* caster : casters)
+	{
+		const glm::mat4& modelMatrix = caster->getModelMatrix();
+		for (const auto& mesh : caster->getMeshes())
+		{
+			const glm::mat4 meshMatrix = modelMatrix * mesh.getLocalMatrix();
+			if (!frustum.intersects(mesh.getBoundingSphere().transformed(meshMatrix)) ||
+				!frustum.intersects(mesh.getBoundingBox().transformed(meshMatrix)))
+			{
+				++mStats.culledMeshes;
+				continue;
+			}
+
+			drawMesh(depthBuffer, lightCamera, mesh, modelMatrix, mDepthShader, draw);
+		}
+	}
+}
+
+void Renderer::drawMesh(Framebuffer& framebuffer, const Camera& camera, const Mesh& mesh,
+                        const glm::mat4& modelMatrix, const ShaderProgram& shader, const DrawState& draw)
+{
 	mTriangleData.clear();
 	mValidTriangles.clear();
 	mTriangleCount = 0;
 
-	preallocateBuffers(vertices.positionsX.size());
+	preallocateBuffers(mesh.getVertexArray().positionsX.size());
 
-	processVerticesAndAssembleTriangles(vertices, mvp, normalMatrix, framebuffer.getWidth(), framebuffer.getHeight());
+	assembleMesh(framebuffer, camera, mesh, modelMatrix, shader, draw);
 
 	// skip if no triangles are visible
 	if (mValidTriangles.empty())
@@ -63,162 +271,541 @@ void Renderer::renderMesh(Framebuffer& framebuffer, const Camera& camera, const
 		return;
 	}
 
-	rasterizeTiles(framebuffer, material);
+	mStats.rasterizedTriangles += mValidTriangles.size();
+
+	const DrawBatch batch{&shader, draw, shader.getTileRasterizer(draw.pipeline)};
+	rasterizeTiles(framebuffer, {&batch, 1}, camera.getViewProjectionMatrix());
+}
+
+void Renderer::assembleMesh(Framebuffer& framebuffer, const Camera& camera, const Mesh& mesh,
+                            const glm::mat4& modelMatrix, const ShaderProgram& shader, const DrawState& draw)
+{
+	const auto& vertices = mesh.getVertexArray();
+	assert(vertices.size() > 0 && "Mesh must have vertices to be rendered");
+
+	assert(vertices.size() % 3 == 0 && "Vertex count must be divisible by 3");
+
+	if (camera.isReverseZ() != framebuffer.isReverseZ())
+	{
+		throw std::invalid_argument("Camera and framebuffer must agree on reverse-Z depth");
+	}
+
+	const glm::mat4 meshMatrix = modelMatrix * mesh.getLocalMatrix();
+	const glm::mat4 mvp = camera.getViewProjectionMatrix() * meshMatrix;
+	const glm::mat3 normalMatrix = glm::inverseTranspose(glm::mat3(meshMatrix));
+
+	cullMeshlets(mesh, camera, meshMatrix);
+	if (mVisibleMeshlets.empty())
+	{
+		return;
+	}
+
+	const VertexUniforms uniforms{mvp, meshMatrix};
+
+	processVerticesAndAssembleTriangles(vertices, mVisibleMeshlets, shader, uniforms, normalMatrix,
+	                                    framebuffer.getViewport(), camera.isReverseZ(),
+	                                    framebuffer.getSampleCount() > 1, draw);
+}
+
+DrawState Renderer::resolveDrawState(const Material* material)
+{
+	if (!material)
+	{
+		return {PIPELINE_DEPTH_WRITE, nullptr, TextureFilter::Nearest, 0x00FFFF};
+	}
+
+	DrawState draw{0, nullptr, TextureFilter::Nearest, 0xFFFFFFFF};
+
+	const Texture* diffuseMap = material->getDiffuseTexture();
+	if (diffuseMap && diffuseMap->isLoaded())
+	{
+		draw.pipeline |= PIPELINE_TEXTURED;
+		draw.diffuseMap = diffuseMap;
+		draw.filter = material->getTextureFilter().value_or(diffuseMap->getFilter());
+		std::tie(draw.wrapU, draw.wrapV) =
+			material->getTextureWrap().value_or(std::pair{diffuseMap->getWrapU(), diffuseMap->getWrapV()});
+
+		// mip selection only matters when there is more than one level
+		if (diffuseMap->getMipLevelCount() > 1)
+			draw.pipeline |= PIPELINE_MIPMAPPED;
+	}
+
+	if (material->isLit())
+		draw.pipeline |= PIPELINE_LIT;
+	if (material->isLit() && material->isVertexLighting())
+		draw.pipeline |= PIPELINE_VERTEX_LIT;
+
+	switch (material->getAlphaMode())
+	{
+	case AlphaMode::Mask:
+		draw.pipeline |= PIPELINE_ALPHA_TEST;
+		draw.alphaCutoff = static_cast<int>(std::lround(std::clamp(material->getAlphaCutoff(), 0.0f, 1.0f) * 255.0f));
+		break;
+
+	case AlphaMode::Blend:
+		draw.pipeline |= PIPELINE_BLEND;
+		break;
+
+	case AlphaMode::Opaque:
+	default:
+		break;
+	}
+
+	// blended surfaces would hide what is drawn behind them later, normalizing drops the depth write
+	if (material->getDepthWrite())
+		draw.pipeline |= PIPELINE_DEPTH_WRITE;
+
+	draw.pipeline = normalizePipeline(draw.pipeline);
+	return draw;
+}
+
+void Renderer::prepareLights()
+{
+	assert(mLights.size() <= UINT16_MAX && "Too many lights");
+
+	mShadingLights.clear();
+	mLightBounds.clear();
+
+	for (const Light& light : mLights)
+	{
+		if (light.type != LightType::Directional) continue;
+		mShadingLights.push_back(ShadingLight::fromLight(light));
+		mLightBounds.emplace_back();
+	}
+	mDirectionalLightCount = mShadingLights.size();
+
+	for (const Light& light : mLights)
+	{
+		if (light.type == LightType::Directional) continue;
+		mShadingLights.push_back(ShadingLight::fromLight(light));
+		mLightBounds.push_back(light.getBounds());
+	}
+
+	// per-vertex lighting is not culled per tile, every vertex sees every light
+	mAllLightIndices.resize(mShadingLights.size());
+	std::ranges::iota(mAllLightIndices, uint16_t{0});
+}
+
+void Renderer::cullMeshlets(const Mesh& mesh, const Camera& camera, const glm::mat4& meshMatrix)
+{
+	mVisibleMeshlets.clear();
+
+	const Frustum& frustum = camera.getFrustum();
+
+	// facing is exact in object space, unless the transform mirrors the winding
+	const bool coneCulling = glm::determinant(glm::mat3(meshMatrix)) > 0.0f;
+	const glm::vec4 localCamera = glm::inverse(meshMatrix) * glm::vec4(camera.getPosition(), 1.0f);
+	const glm::vec3 cameraPosition(localCamera.x, localCamera.y, localCamera.z);
+
+	for (const Meshlet& meshlet : mesh.getMeshlets())
+	{
+		if (!frustum.intersects(meshlet.bounds.transformed(meshMatrix)))
+		{
+			++mStats.culledMeshlets;
+			continue;
+		}
+
+		// every triangle faces away from any camera position in this half-cone
+		const glm::vec3 toCenter = meshlet.bounds.center - cameraPosition;
+		if (coneCulling && glm::dot(toCenter, meshlet.coneAxis) >=
+			meshlet.coneCutoff * glm::length(toCenter) + meshlet.bounds.radius)
+		{
+			++mStats.culledMeshlets;
+			continue;
+		}
+
+		mVisibleMeshlets.push_back(&meshlet);
+	}
+}
+
+// Sutherland-Hodgman clip of a convex polygon against the planes set in planeMask
+static int clipPolygon(ClipVertex* polygon, int vertexCount, ClipVertex* scratch,
+                       const glm::vec4* planes, const int planeCount, const int planeMask)
+{
+	ClipVertex* input = polygon;
+	ClipVertex* output = scratch;
+
+	for (int p = 0; p < planeCount && vertexCount >= 3; ++p)
+	{
+		if (!(planeMask & (1 << p))) continue;
+
+		int outputCount = 0;
+		for (int i = 0; i < vertexCount; ++i)
+		{
+			const ClipVertex& current = input[i];
+			const ClipVertex& next = input[(i + 1) % vertexCount];
+			const float currentDist = glm::dot(planes[p], current.position);
+			const float nextDist = glm::dot(planes[p], next.position);
+
+			if (currentDist >= 0.0f)
+				output[outputCount++] = current;
+
+			// edge crosses the plane, emit the intersection
+			if ((currentDist >= 0.0f) != (nextDist >= 0.0f))
+			{
+				const float t = currentDist / (currentDist - nextDist);
+				ClipVertex& clipped = output[outputCount++];
+				clipped.position = current.position + (next.position - current.position) * t;
+				clipped.u = current.u + (next.u - current.u) * t;
+				clipped.v = current.v + (next.v - current.v) * t;
+				clipped.normal = current.normal + (next.normal - current.normal) * t;
+				clipped.worldPosition = current.worldPosition + (next.worldPosition - current.worldPosition) * t;
+				clipped.light = current.light + (next.light - current.light) * t;
+			}
+		}
+
+		std::swap(input, output);
+		vertexCount = outputCount;
+	}
+
+	if (input != polygon)
+		std::copy(input, input + vertexCount, polygon);
+
+	return vertexCount;
 }
 
-void Renderer::processVerticesAndAssembleTriangles(const VertexArray& vertices, const glm::mat4& mvp,
+void Renderer::processVerticesAndAssembleTriangles(const VertexArray& vertices,
+                                                   const std::vector<const Meshlet*>& meshlets,
+                                                   const ShaderProgram& shader, const VertexUniforms& uniforms,
                                                    const glm::mat3& normalMatrix,
-                                                   const int fbWidth, const int fbHeight)
+                                                   const Viewport& viewport, const bool reverseZ,
+                                                   const bool multisampled, const DrawState& draw)
 {
-	const size_t vertexCount = vertices.positionsX.size();
+	const uint32_t pipeline = draw.pipeline;
+	const bool vertexLit = (pipeline & PIPELINE_LIT) && (pipeline & PIPELINE_VERTEX_LIT);
+
+	[[maybe_unused]] const size_t vertexCount = vertices.positionsX.size();
+
+	assert(viewport.width > 0 && viewport.height > 0 && "Viewport dimensions must be positive");
+
+	// window-space depth is [0,1]; reverse-Z projections already produce that range
+	const float depthScale = reverseZ ? 1.0f : 0.5f;
+	const float depthOffset = reverseZ ? 0.0f : 0.5f;
 
-	assert(fbWidth > 0 && fbHeight > 0 && "Framebuffer dimensions must be positive");
+	// guard band extent in NDC, triangles only get clipped at the sides once they reach past it
+	const float guardX = 1.0f + 2.0f * GUARD_BAND_PIXELS / static_cast<float>(viewport.width);
+	const float guardY = 1.0f + 2.0f * GUARD_BAND_PIXELS / static_cast<float>(viewport.height);
 
-	const int screenWidth = fbWidth;
-	const int screenHeight = fbHeight;
-	for (size_t baseVertex = 0; baseVertex + 2 < vertexCount; baseVertex += 3)
+	// plane . clipPos >= 0 is inside; near plane is z >= -w, or z <= w for reverse-Z
+	const glm::vec4 clipPlanes[CLIP_PLANE_COUNT] = {
+		reverseZ ? glm::vec4(0.0f, 0.0f, -1.0f, 1.0f) : glm::vec4(0.0f, 0.0f, 1.0f, 1.0f),
+		glm::vec4(1.0f, 0.0f, 0.0f, guardX),
+		glm::vec4(-1.0f, 0.0f, 0.0f, guardX),
+		glm::vec4(0.0f, 1.0f, 0.0f, guardY),
+		glm::vec4(0.0f, -1.0f, 0.0f, guardY)
+	};
+
+	ClipVertex polygon[MAX_CLIP_VERTICES];
+	ClipVertex scratch[MAX_CLIP_VERTICES];
+
+	for (const Meshlet* meshlet : meshlets)
 	{
-		float invW[3], ndcX[3], ndcY[3], ndcZ[3];
-		int screenX[3], screenY[3];
-		bool isCulled = false;
+		const size_t firstVertex = static_cast<size_t>(meshlet->firstTriangle) * 3;
+		const size_t endVertex = firstVertex + static_cast<size_t>(meshlet->triangleCount) * 3;
+		assert(endVertex <= vertexCount && "Meshlet range out of bounds");
 
-		for (int i = 0; i < 3; ++i)
+		// run the vertex program over the whole meshlet before clipping
+		const size_t meshletVertexCount = endVertex - firstVertex;
+		if (mShadedVertices.size() < meshletVertexCount)
+			mShadedVertices.resize(meshletVertexCount);
+		shader.shadeVertices(vertices, firstVertex, meshletVertexCount, uniforms, mShadedVertices.data());
+
+		// lit once per vertex before clipping, which interpolates the light like any other attribute
+		if (vertexLit)
+			lightVertices(meshletVertexCount, normalMatrix, draw);
+
+		for (size_t baseVertex = 0; baseVertex < meshletVertexCount; baseVertex += 3)
 		{
-			const size_t vertexIndex = baseVertex + i;
-
-			// apply MVP
-			const glm::vec4 clipPos = mvp * glm::vec4(
-				vertices.positionsX[vertexIndex],
-				vertices.positionsY[vertexIndex],
-				vertices.positionsZ[vertexIndex],
-				1.0f
-			);
-
-			// cull behind camera
-			if (clipPos.w <= 0.0f)
+			int outsideAll = 0x1F;
+			int clipMask = 0;
+
+			for (int i = 0; i < 3; ++i)
+			{
+				ClipVertex& vertex = polygon[i];
+				vertex = mShadedVertices[baseVertex + i];
+
+				// outcodes against the near plane and the visible frustum sides
+				const glm::vec4& pos = vertex.position;
+				const int outcode = (glm::dot(clipPlanes[0], pos) < 0.0f ? 0x1 : 0) |
+					(pos.x < -pos.w ? 0x2 : 0) | (pos.x > pos.w ? 0x4 : 0) |
+					(pos.y < -pos.w ? 0x8 : 0) | (pos.y > pos.w ? 0x10 : 0);
+				outsideAll &= outcode;
+
+				for (int p = 0; p < CLIP_PLANE_COUNT; ++p)
+				{
+					if (glm::dot(clipPlanes[p], pos) < 0.0f)
+						clipMask |= 1 << p;
+				}
+			}
+
+			// all vertices outside the same plane
+			if (outsideAll) continue;
+
+			if (!clipMask)
+			{
+				assembleTriangle(polygon, normalMatrix, viewport, depthScale, depthOffset, pipeline,
+				                 multisampled);
+				continue;
+			}
+
+			const int clippedCount = clipPolygon(polygon, 3, scratch, clipPlanes, CLIP_PLANE_COUNT, clipMask);
+
+			// triangulate the clipped polygon as a fan
+			for (int i = 1; i + 1 < clippedCount; ++i)
 			{
-				isCulled = true;
-				break;
+				const ClipVertex corners[3] = {polygon[0], polygon[i], polygon[i + 1]};
+				assembleTriangle(corners, normalMatrix, viewport, depthScale, depthOffset, pipeline,
+				                 multisampled);
 			}
+		}
+	}
+}
 
-			// perspective division
-			invW[i] = 1.0f / clipPos.w;
+void Renderer::lightVertices(const size_t count, const glm::mat3& normalMatrix, const DrawState& draw)
+{
+	DrawState vertexDraw = draw;
+	vertexDraw.lightIndices = mAllLightIndices.data();
+	vertexDraw.lightCount = static_cast<int>(mAllLightIndices.size());
 
-			ndcX[i] = clipPos.x * invW[i];
-			ndcY[i] = clipPos.y * invW[i];
-			ndcZ[i] = clipPos.z * invW[i];
+	const auto column = [&](const int c)
+	{
+		return std::array{
+			_mm_set1_ps(normalMatrix[c].x), _mm_set1_ps(normalMatrix[c].y), _mm_set1_ps(normalMatrix[c].z)
+		};
+	};
+	const auto normalColumn0 = column(0);
+	const auto normalColumn1 = column(1);
+	const auto normalColumn2 = column(2);
+
+	// four vertices at a time in SoA form, the last group repeats its final vertex
+	for (size_t first = 0; first < count; first += 4)
+	{
+		alignas(16) float objectNormal[3][4], world[3][4];
+		for (int lane = 0; lane < 4; ++lane)
+		{
+			const ClipVertex& vertex = mShadedVertices[std::min(first + lane, count - 1)];
+			for (int c = 0; c < 3; ++c)
+			{
+				objectNormal[c][lane] = vertex.normal[c];
+				world[c][lane] = vertex.worldPosition[c];
+			}
+		}
 
-			// from NDC [-1,1] to screen coordinates (y gets flipped)
-			screenX[i] = static_cast<int>((ndcX[i] + 1.0f) * 0.5f * fbWidth);
-			screenY[i] = static_cast<int>((1.0f - ndcY[i]) * 0.5f * fbHeight);
+		// to world space, then normalized
+		const __m128 objectX = _mm_load_ps(objectNormal[0]);
+		const __m128 objectY = _mm_load_ps(objectNormal[1]);
+		const __m128 objectZ = _mm_load_ps(objectNormal[2]);
+		__m128 normalX = _mm_fmadd_ps(normalColumn0[0], objectX,
+		                              _mm_fmadd_ps(normalColumn1[0], objectY, _mm_mul_ps(normalColumn2[0], objectZ)));
+		__m128 normalY = _mm_fmadd_ps(normalColumn0[1], objectX,
+		                              _mm_fmadd_ps(normalColumn1[1], objectY, _mm_mul_ps(normalColumn2[1], objectZ)));
+		__m128 normalZ = _mm_fmadd_ps(normalColumn0[2], objectX,
+		                              _mm_fmadd_ps(normalColumn1[2], objectY, _mm_mul_ps(normalColumn2[2], objectZ)));
+		const __m128 lengthSquared = _mm_fmadd_ps(normalX, normalX,
+		                                          _mm_fmadd_ps(normalY, normalY, _mm_mul_ps(normalZ, normalZ)));
+		const __m128 invLength = _mm_div_ps(Rasterizer::ONE, _mm_sqrt_ps(_mm_max_ps(lengthSquared,
+		                                                                          _mm_set1_ps(1e-20f))));
+		normalX = _mm_mul_ps(normalX, invLength);
+		normalY = _mm_mul_ps(normalY, invLength);
+		normalZ = _mm_mul_ps(normalZ, invLength);
+
+		__m128 lightR, lightG, lightB;
+		mDefaultShader.computeLight(normalX, normalY, normalZ, _mm_load_ps(world[0]), _mm_load_ps(world[1]),
+		                            _mm_load_ps(world[2]), vertexDraw, lightR, lightG, lightB);
+
+		alignas(16) float light[3][4];
+		_mm_store_ps(light[0], lightR);
+		_mm_store_ps(light[1], lightG);
+		_mm_store_ps(light[2], lightB);
+		for (size_t lane = 0; lane < 4 && first + lane < count; ++lane)
+		{
+			mShadedVertices[first + lane].light = glm::vec3(light[0][lane], light[1][lane], light[2][lane]);
 		}
+	}
+}
 
-		if (isCulled) continue; // Backface culling using signed area
-		const float signedArea = static_cast<float>(screenX[1] - screenX[0]) * static_cast<float>(screenY[2] - screenY[
-				0]) -
-			static_cast<float>(screenX[2] - screenX[0]) * static_cast<float>(screenY[1] - screenY[0]);
+void Renderer::assembleTriangle(const ClipVertex* corners, const glm::mat3& normalMatrix,
+                                const Viewport& viewport, const float depthScale, const float depthOffset, const uint32_t pipeline,
+                                const bool multisampled)
+{
+	float invW[3], windowZ[3];
+	int fixedX[3], fixedY[3];
 
-		if (signedArea >= 0.0f) continue;
+	for (int i = 0; i < 3; ++i)
+	{
+		const glm::vec4& clipPos = corners[i].position;
+
+		// clipping leaves w positive, this also rejects NaN
+		if (!(clipPos.w > 0.0f)) return;
 
-		mTriangleData.emplace_back();
-		size_t triangleIndex = mTriangleData.size() - 1;
-		TriangleData& triangle = mTriangleData[triangleIndex];
+		// perspective division
+		invW[i] = 1.0f / clipPos.w;
 
-		// inverse area for barycentric coordinates and avoid division by zero
-		const float invArea = (std::abs(signedArea) > 1e-6f) ? (1.0f / std::abs(signedArea)) : 0.0f;
-		triangle.invArea = _mm_set1_ps(invArea);
+		const float ndcX = clipPos.x * invW[i];
+		const float ndcY = clipPos.y * invW[i];
+		windowZ[i] = clipPos.z * invW[i] * depthScale + depthOffset;
 
-		setupTriangle(triangle, screenX, screenY, ndcZ, invW, vertices, baseVertex, normalMatrix);
+		// from NDC [-1,1] to viewport coordinates (y gets flipped)
+		const float fx = viewport.x + (ndcX + 1.0f) * 0.5f * viewport.width;
+		const float fy = viewport.y + (1.0f - ndcY) * 0.5f * viewport.height;
 
-		triangle.minX = std::max(0, triangle.minX);
-		triangle.maxX = std::min(screenWidth - 1, triangle.maxX);
-		triangle.minY = std::max(0, triangle.minY);
-		triangle.maxY = std::min(screenHeight - 1, triangle.maxY);
+		// guard band keeps fixed-point coordinates in range
+		if (!(std::abs(fx) < MAX_SCREEN_COORD && std::abs(fy) < MAX_SCREEN_COORD)) return;
 
-		mValidTriangles.push_back(triangleIndex);
-		++mTriangleCount;
+		// snap to the subpixel grid
+		fixedX[i] = static_cast<int>(std::floor(fx * SUBPIXEL_SCALE + 0.5f));
+		fixedY[i] = static_cast<int>(std::floor(fy * SUBPIXEL_SCALE + 0.5f));
 	}
+
+	// Backface culling using exact signed area
+	const int64_t signedArea =
+		static_cast<int64_t>(fixedX[1] - fixedX[0]) * (fixedY[2] - fixedY[0]) -
+		static_cast<int64_t>(fixedX[2] - fixedX[0]) * (fixedY[1] - fixedY[0]);
+
+	if (signedArea >= 0) return;
+
+	// pixels whose centre, or any sample when multisampled, is covered by the bounds,
+	// skip triangles that only overlap the guard band around the viewport
+	const int reach = SUBPIXEL_SCALE / 2 - (multisampled ? MSAA_SAMPLE_REACH : 0);
+	const int minX = std::max(viewport.x, (std::min({fixedX[0], fixedX[1], fixedX[2]}) - reach + SUBPIXEL_SCALE - 1) >>
+	                          SUBPIXEL_BITS);
+	const int maxX = std::min(viewport.x + viewport.width - 1,
+	                          (std::max({fixedX[0], fixedX[1], fixedX[2]}) - reach) >> SUBPIXEL_BITS);
+	const int minY = std::max(viewport.y, (std::min({fixedY[0], fixedY[1], fixedY[2]}) - reach + SUBPIXEL_SCALE - 1) >>
+	                          SUBPIXEL_BITS);
+	const int maxY = std::min(viewport.y + viewport.height - 1,
+	                          (std::max({fixedY[0], fixedY[1], fixedY[2]}) - reach) >> SUBPIXEL_BITS);
+	if (minX > maxX || minY > maxY) return;
+
+	mTriangleData.emplace_back();
+	size_t triangleIndex = mTriangleData.size() - 1;
+	TriangleData& triangle = mTriangleData[triangleIndex];
+
+	setupTriangle(triangle, fixedX, fixedY, windowZ, invW, corners, normalMatrix, pipeline, multisampled);
+
+	triangle.minX = minX;
+	triangle.maxX = maxX;
+	triangle.minY = minY;
+	triangle.maxY = maxY;
+	triangle.minW = std::min({corners[0].position.w, corners[1].position.w, corners[2].position.w});
+	triangle.maxW = std::max({corners[0].position.w, corners[1].position.w, corners[2].position.w});
+
+	mValidTriangles.push_back(triangleIndex);
+	++mTriangleCount;
+}
+
+// plane through the three vertex values, relative to vertex 0
+static AttributePlane makePlane(const float* values, const float dx1, const float dy1,
+                                const float dx2, const float dy2, const float invDet)
+{
+	const float d1 = values[1] - values[0];
+	const float d2 = values[2] - values[0];
+	return {
+		values[0],
+		(d1 * dy2 - d2 * dy1) * invDet,
+		(d2 * dx1 - d1 * dx2) * invDet
+	};
 }
 
-void Renderer::setupTriangle(TriangleData& triangle, int* screenX, int* screenY,
-                             const float* ndcZ, const float* invW, const VertexArray& vertices,
-                             const size_t baseVertex, const glm::mat3& normalMatrix)
+void Renderer::setupTriangle(TriangleData& triangle, const int* fixedX, const int* fixedY,
+                             const float* windowZ, const float* invW, const ClipVertex* corners,
+                             const glm::mat3& normalMatrix, const uint32_t pipeline, const bool multisampled)
 {
-	assert(baseVertex + 2 < vertices.size() && "Vertex indices should be within bounds");
-
-	// calculate bounds for binning
-	triangle.minX = std::min({screenX[0], screenX[1], screenX[2]});
-	triangle.maxX = std::max({screenX[0], screenX[1], screenX[2]});
-	triangle.minY = std::min({screenY[0], screenY[1], screenY[2]});
-	triangle.maxY = std::max({screenY[0], screenY[1], screenY[2]});
-
-	// edge equations: Ax + By + C = 0
-	const float edge1A = static_cast<float>(screenY[1] - screenY[2]);
-	const float edge1B = static_cast<float>(screenX[2] - screenX[1]);
-	const float edge1C = static_cast<float>(screenX[1] * screenY[2] - screenX[2] * screenY[1]);
-
-	const float edge2A = static_cast<float>(screenY[2] - screenY[0]);
-	const float edge2B = static_cast<float>(screenX[0] - screenX[2]);
-	const float edge2C = static_cast<float>(screenX[2] * screenY[0] - screenX[0] * screenY[2]);
-
-	const float edge3A = static_cast<float>(screenY[0] - screenY[1]);
-	const float edge3B = static_cast<float>(screenX[1] - screenX[0]);
-	const float edge3C = static_cast<float>(screenX[0] * screenY[1] - screenX[1] * screenY[0]);
-
-	triangle.edgeA[0] = _mm_set1_ps(edge1A);
-	triangle.edgeB[0] = _mm_set1_ps(edge1B);
-	triangle.edgeC[0] = _mm_set1_ps(edge1C);
-	triangle.edgeA[1] = _mm_set1_ps(edge2A);
-	triangle.edgeB[1] = _mm_set1_ps(edge2B);
-	triangle.edgeC[1] = _mm_set1_ps(edge2C);
-	triangle.edgeA[2] = _mm_set1_ps(edge3A);
-	triangle.edgeB[2] = _mm_set1_ps(edge3B);
-	triangle.edgeC[2] = _mm_set1_ps(edge3C);
-
-	triangle.edgeDeltaX[0] = _mm_set1_ps(edge1A * 4.0f);
-	triangle.edgeDeltaX[1] = _mm_set1_ps(edge2A * 4.0f);
-	triangle.edgeDeltaX[2] = _mm_set1_ps(edge3A * 4.0f);
-
-	// Store vertex attributes
+	// edge equations A*x + B*y + C in subpixel units, vertices j -> k opposite vertex i
+	constexpr int halfPixel = SUBPIXEL_SCALE / 2;
 	for (int i = 0; i < 3; ++i)
 	{
-		const size_t vertexIndex = baseVertex + i;
-		// additional bounds checking
-		if (vertexIndex >= vertices.uvsU.size() ||
-			vertexIndex >= vertices.uvsV.size() ||
-			vertexIndex >= vertices.normalsX.size() ||
-			vertexIndex >= vertices.normalsY.size() ||
-			vertexIndex >= vertices.normalsZ.size())
+		const int j = (i + 1) % 3;
+		const int k = (i + 2) % 3;
+
+		const int edgeA = fixedY[j] - fixedY[k];
+		const int edgeB = fixedX[k] - fixedX[j];
+		const int64_t edgeC = static_cast<int64_t>(fixedX[j]) * fixedY[k] - static_cast<int64_t>(fixedX[k]) * fixedY[j];
+
+		// top-left fill rule: pixels exactly on other edges are left out
+		const bool isTopLeft = edgeA < 0 || (edgeA == 0 && edgeB < 0);
+		const int64_t bias = isTopLeft ? 0 : 1;
+
+		// fold the pixel centre offset and subpixel scale into C, so that for whole pixels
+		// A*x + B*y + C < 0 exactly when the subpixel edge function passes the fill rule
+		const int64_t centred = static_cast<int64_t>(halfPixel) * (edgeA + edgeB) + edgeC + bias;
+		triangle.edgeA[i] = edgeA;
+		triangle.edgeB[i] = edgeB;
+		triangle.edgeC[i] = -((-centred) >> SUBPIXEL_BITS) - 1;
+
+		// the same folding at each sample position, stored relative to the pixel centre
+		if (!multisampled) continue;
+		for (int s = 0; s < MSAA_SAMPLE_COUNT; ++s)
 		{
-			assert(false && "Vertex attribute index out of bounds");
-			// use default values for missing attributes
-			triangle.depth[i] = _mm_set1_ps(ndcZ[i]);
-			triangle.invW[i] = _mm_set1_ps(invW[i]);
-			triangle.u[i] = _mm_set1_ps(0.0f);
-			triangle.v[i] = _mm_set1_ps(0.0f);
-			triangle.normalX[i] = _mm_set1_ps(0.0f);
-			triangle.normalY[i] = _mm_set1_ps(0.0f);
-			triangle.normalZ[i] = _mm_set1_ps(1.0f);
-			continue;
+			const int64_t sampleX = halfPixel + MSAA_SAMPLE_POSITIONS[s][0] * (SUBPIXEL_SCALE / 16);
+			const int64_t sampleY = halfPixel + MSAA_SAMPLE_POSITIONS[s][1] * (SUBPIXEL_SCALE / 16);
+			const int64_t sampleCentred = sampleX * edgeA + sampleY * edgeB + edgeC + bias;
+			const int64_t sampleC = -((-sampleCentred) >> SUBPIXEL_BITS) - 1;
+			triangle.sampleEdgeOffsets[s][i] = static_cast<int>(sampleC - triangle.edgeC[i]);
 		}
+	}
+
+	// attribute planes in pixel units, perspective-correct attributes are divided by w
+	constexpr float invScale = 1.0f / SUBPIXEL_SCALE;
+	triangle.originX = fixedX[0] * invScale;
+	triangle.originY = fixedY[0] * invScale;
 
-		triangle.depth[i] = _mm_set1_ps(ndcZ[i]);
-		triangle.invW[i] = _mm_set1_ps(invW[i]);
+	const float dx1 = (fixedX[1] - fixedX[0]) * invScale;
+	const float dy1 = (fixedY[1] - fixedY[0]) * invScale;
+	const float dx2 = (fixedX[2] - fixedX[0]) * invScale;
+	const float dy2 = (fixedY[2] - fixedY[0]) * invScale;
+	const float invDet = 1.0f / (dx1 * dy2 - dx2 * dy1);
 
-		triangle.u[i] = _mm_set1_ps(vertices.uvsU[vertexIndex]);
-		triangle.v[i] = _mm_set1_ps(vertices.uvsV[vertexIndex]);
+	triangle.depth = makePlane(windowZ, dx1, dy1, dx2, dy2, invDet);
+	triangle.invW = makePlane(invW, dx1, dy1, dx2, dy2, invDet);
 
-		//  to world space for lighting
-		const glm::vec3 normal(
-			vertices.normalsX[vertexIndex],
-			vertices.normalsY[vertexIndex],
-			vertices.normalsZ[vertexIndex]
-		);
-		const glm::vec3 worldNormal = glm::normalize(normalMatrix * normal);
+	if (pipeline & PIPELINE_TEXTURED)
+	{
+		float u[3], v[3];
+		for (int i = 0; i < 3; ++i)
+		{
+			u[i] = corners[i].u * invW[i];
+			v[i] = corners[i].v * invW[i];
+		}
+		triangle.u = makePlane(u, dx1, dy1, dx2, dy2, invDet);
+		triangle.v = makePlane(v, dx1, dy1, dx2, dy2, invDet);
+	}
 
-		triangle.normalX[i] = _mm_set1_ps(worldNormal.x);
-		triangle.normalY[i] = _mm_set1_ps(worldNormal.y);
-		triangle.normalZ[i] = _mm_set1_ps(worldNormal.z);
+	if ((pipeline & PIPELINE_LIT) && (pipeline & PIPELINE_VERTEX_LIT))
+	{
+		float lightR[3], lightG[3], lightB[3];
+		for (int i = 0; i < 3; ++i)
+		{
+			lightR[i] = corners[i].light.r * invW[i];
+			lightG[i] = corners[i].light.g * invW[i];
+			lightB[i] = corners[i].light.b * invW[i];
+		}
+		triangle.lightR = makePlane(lightR, dx1, dy1, dx2, dy2, invDet);
+		triangle.lightG = makePlane(lightG, dx1, dy1, dx2, dy2, invDet);
+		triangle.lightB = makePlane(lightB, dx1, dy1, dx2, dy2, invDet);
+	}
+	else if (pipeline & PIPELINE_LIT)
+	{
+		float normalX[3], normalY[3], normalZ[3];
+		float worldX[3], worldY[3], worldZ[3];
+		for (int i = 0; i < 3; ++i)
+		{
+			//  to world space for lighting
+			const glm::vec3 worldNormal = glm::normalize(normalMatrix * corners[i].normal);
+
+			normalX[i] = worldNormal.x * invW[i];
+			normalY[i] = worldNormal.y * invW[i];
+			normalZ[i] = worldNormal.z * invW[i];
+			worldX[i] = corners[i].worldPosition.x * invW[i];
+			worldY[i] = corners[i].worldPosition.y * invW[i];
+			worldZ[i] = corners[i].worldPosition.z * invW[i];
+		}
+		triangle.normalX = makePlane(normalX, dx1, dy1, dx2, dy2, invDet);
+		triangle.normalY = makePlane(normalY, dx1, dy1, dx2, dy2, invDet);
+		triangle.normalZ = makePlane(normalZ, dx1, dy1, dx2, dy2, invDet);
+		triangle.worldX = makePlane(worldX, dx1, dy1, dx2, dy2, invDet);
+		triangle.worldY = makePlane(worldY, dx1, dy1, dx2, dy2, invDet);
+		triangle.worldZ = makePlane(worldZ, dx1, dy1, dx2, dy2, invDet);
 	}
 }
 
@@ -282,12 +869,14 @@ void Renderer::binTriangles()
 	}
 }
 
-void Renderer::rasterizeTiles(Framebuffer& framebuffer, const Material* material)
+void Renderer::rasterizeTiles(Framebuffer& framebuffer, const std::span<const DrawBatch> batches,
+                              const glm::mat4& viewProjection)
 {
 	const int fbWidth = framebuffer.getWidth();
 	const int fbHeight = framebuffer.getHeight();
+	const Viewport& viewport = framebuffer.getViewport();
 
-	// tile grid dimensions
+	// tile grid dimensions, the grid stays aligned to the framebuffer whatever the viewport
 	const int newTileCountX = (fbWidth + TILE_WIDTH - 1) >> TILE_SHIFT;
 	const int newTileCountY = (fbHeight + TILE_HEIGHT - 1) >> TILE_SHIFT;
 	const size_t totalTiles = static_cast<size_t>(newTileCountX) * newTileCountY;
@@ -304,8 +893,25 @@ void Renderer::rasterizeTiles(Framebuffer& framebuffer, const Material* material
 
 	binTriangles();
 
-	std::vector<size_t> tileIndices(totalTiles);
-	std::ranges::iota(tileIndices, 0);
+	// a single batch owns every triangle, the transparent pass records the batch of each
+	const bool singleBatch = batches.size() == 1;
+	const bool blended = (batches.front().draw.pipeline & PIPELINE_BLEND) != 0;
+	auto batchOf = [&](const size_t triangleIndex)
+	{
+		return singleBatch ? 0u : mTriangleBatches[triangleIndex];
+	};
+
+	// only tiles overlapping the viewport, clipped to it
+	const int firstTileX = viewport.x >> TILE_SHIFT;
+	const int firstTileY = viewport.y >> TILE_SHIFT;
+	const int viewportTilesX = ((viewport.x + viewport.width - 1) >> TILE_SHIFT) - firstTileX + 1;
+	const int viewportTilesY = ((viewport.y + viewport.height - 1) >> TILE_SHIFT) - firstTileY + 1;
+
+	std::vector<size_t> tileIndices(static_cast<size_t>(viewportTilesX) * viewportTilesY);
+	for (int ty = 0; ty < viewportTilesY; ++ty)
+		for (int tx = 0; tx < viewportTilesX; ++tx)
+			tileIndices[static_cast<size_t>(ty) * viewportTilesX + tx] =
+				static_cast<size_t>(firstTileY + ty) * mTileCountX + firstTileX + tx;
 
 	std::for_each(std::execution::par, tileIndices.begin(), tileIndices.end(),
 	              [&](const size_t tileIndex)
@@ -317,232 +923,275 @@ void Renderer::rasterizeTiles(Framebuffer& framebuffer, const Material* material
 		              const int tileX = static_cast<int>(tileIndex % mTileCountX);
 		              const int tileY = static_cast<int>(tileIndex / mTileCountX);
 
-		              const int tileMinX = tileX << TILE_SHIFT;
-		              const int tileMinY = tileY << TILE_SHIFT;
-		              const int tileMaxX = std::min(tileMinX + TILE_WIDTH, fbWidth);
-		              const int tileMaxY = std::min(tileMinY + TILE_HEIGHT, fbHeight);
-
-		              const size_t offset = mBinTriangleOffsets[tileIndex];
-		              const size_t* triangleIndices = &mBinnedTriangles[offset];
-
-		              rasterizeTile(framebuffer, material,
-		                            tileMinX, tileMinY, tileMaxX, tileMaxY,
-		                            triangleIndices, triangleCount);
+		              const int tileMinX = std::max(tileX << TILE_SHIFT, viewport.x);
+		              const int tileMinY = std::max(tileY << TILE_SHIFT, viewport.y);
+		              const int tileMaxX = std::min((tileX << TILE_SHIFT) + TILE_WIDTH, viewport.x + viewport.width);
+		              const int tileMaxY = std::min((tileY << TILE_SHIFT) + TILE_HEIGHT, viewport.y + viewport.height);
+
+		              size_t* binned = &mBinnedTriangles[mBinTriangleOffsets[tileIndex]];
+
+		              // back to front within the tile, so the sort only pays for local overlap
+		              if (blended)
+			              sortBackToFront(binned, triangleCount);
+
+		              // consecutive triangles of one batch go to its rasterizer together; every light
+		              // may overlap the tile, so the per-thread index buffer holds all of them
+		              thread_local std::vector<uint16_t> tileLights;
+		              tileLights.resize(mShadingLights.size());
+		              for (int first = 0; first < triangleCount;)
+		              {
+			              const uint32_t batchIndex = batchOf(binned[first]);
+			              int last = first + 1;
+			              while (last < triangleCount && batchOf(binned[last]) == batchIndex)
+				              ++last;
+
+			              const DrawBatch& batch = batches[batchIndex];
+			              TileJob tile{
+				              tileMinX, tileMinY, tileMaxX, tileMaxY,
+				              mTriangleData.data(), binned + first, last - first,
+				              tileLights.data(), 0
+			              };
+
+			              // per-vertex lighting already saw every light
+			              if (batch.draw.lights && !(batch.draw.pipeline & PIPELINE_VERTEX_LIT))
+			              {
+				              // depth range of the triangles drawn here, conservative since they may extend past the tile
+				              float minW = std::numeric_limits<float>::max();
+				              float maxW = 0.0f;
+				              for (int i = first; i < last; ++i)
+				              {
+					              const TriangleData& triangle = mTriangleData[binned[i]];
+					              minW = std::min(minW, triangle.minW);
+					              maxW = std::max(maxW, triangle.maxW);
+				              }
+				              tile.lightCount = cullTileLights(tile, minW, maxW, viewProjection, viewport,
+				                                               tileLights.data());
+			              }
+
+			              batch.rasterizer(*batch.shader, framebuffer, batch.draw, tile);
+			              first = last;
+		              }
 	              });
 }
 
-void Renderer::rasterizeScanline(Framebuffer& framebuffer, const Material* material,
-                                 const TriangleData& triangle, int y, int startX, int endX) const
+void Renderer::sortBackToFront(size_t* triangleIndices, const int count) const
 {
-	// validate scanline bounds
-	assert(startX <= endX && "Start X must be less than or equal to end X");
-	assert(y >= 0 && "Y coordinate must be non-negative");
-
-	if (startX >= endX) return; // empty scanline
-
-	__m128 yFloat = _mm_set1_ps(static_cast<float>(y));
-	__m128i yInt = _mm_set1_epi32(y);
-
-	int baseX = startX;
-	int quadCount = ((endX - baseX) + 3) >> 2; // ceiling division by 4
-
-	// process 4 pixels at once 
-	__m128 xBase = _mm_add_ps(_mm_set1_ps(static_cast<float>(baseX)), PIXEL_OFFSETS);
-	__m128i xInt = _mm_add_epi32(_mm_set1_epi32(baseX), OFFSETS_I);
-
-	// evaluate edge equations at y position
-	__m128 bc0 = _mm_fmadd_ps(triangle.edgeB[0], yFloat, triangle.edgeC[0]);
-	__m128 bc1 = _mm_fmadd_ps(triangle.edgeB[1], yFloat, triangle.edgeC[1]);
-	__m128 bc2 = _mm_fmadd_ps(triangle.edgeB[2], yFloat, triangle.edgeC[2]);
-
-	__m128 edge0 = _mm_fmadd_ps(triangle.edgeA[0], xBase, bc0);
-	__m128 edge1 = _mm_fmadd_ps(triangle.edgeA[1], xBase, bc1);
-	__m128 edge2 = _mm_fmadd_ps(triangle.edgeA[2], xBase, bc2);
-
-	for (int q = 0; q < quadCount; ++q)
+	// keys are gathered into a per-thread buffer once, so comparisons stay out of the triangle data;
+	// earlier triangles have lower indices, which breaks ties in submission order
+	thread_local std::vector<std::pair<float, size_t>> keys;
+	keys.resize(count);
+	for (int i = 0; i < count; ++i)
 	{
-		// check if pixels inside triangle (edge value <= 0)
-		__m128 inside0 = _mm_cmple_ps(edge0, ZERO);
-		__m128 inside1 = _mm_cmple_ps(edge1, ZERO);
-		__m128 inside2 = _mm_cmple_ps(edge2, ZERO);
-		int insideMask = _mm_movemask_ps(_mm_and_ps(_mm_and_ps(inside0, inside1), inside2));
+		const TriangleData& triangle = mTriangleData[triangleIndices[i]];
+		keys[i] = {-(triangle.minW + triangle.maxW), triangleIndices[i]};
+	}
 
-		if (!insideMask)
-		{
-			// skip
-			edge0 = _mm_add_ps(edge0, triangle.edgeDeltaX[0]);
-			edge1 = _mm_add_ps(edge1, triangle.edgeDeltaX[1]);
-			edge2 = _mm_add_ps(edge2, triangle.edgeDeltaX[2]);
-			xInt = _mm_add_epi32(xInt, INC_XI);
-			continue;
-		}
+	std::sort(keys.begin(), keys.end());
+	for (int i = 0; i < count; ++i)
+		triangleIndices[i] = keys[i].second;
+}
 
-		// barycentric coords
-		__m128 negInvArea = _mm_mul_ps(NEG_ONE, triangle.invArea);
-		__m128 w0 = _mm_mul_ps(edge0, negInvArea);
-		__m128 w1 = _mm_mul_ps(edge1, negInvArea);
-		__m128 w2 = _mm_sub_ps(_mm_sub_ps(ONE, w0), w1);
+int Renderer::cullTileLights(const TileJob& tile, const float minW, const float maxW,
+                             const glm::mat4& viewProjection, const Viewport& viewport,
+                             uint16_t* lightIndices) const
+{
+	int lightCount = 0;
 
-		// interpolate depth
-		__m128 depth = _mm_fmadd_ps(w2, triangle.depth[2],
-		                            _mm_fmadd_ps(w1, triangle.depth[1],
-		                                         _mm_mul_ps(w0, triangle.depth[0])));
+	// directional lights reach every tile
+	for (size_t i = 0; i < mDirectionalLightCount; ++i)
+		lightIndices[lightCount++] = static_cast<uint16_t>(i);
 
-		int depthPassMask = framebuffer.depthTest(xInt, yInt, depth);
-		insideMask &= depthPassMask;
+	if (mDirectionalLightCount == mShadingLights.size())
+		return lightCount;
 
-		if (!insideMask)
-		{
-			edge0 = _mm_add_ps(edge0, triangle.edgeDeltaX[0]);
-			edge1 = _mm_add_ps(edge1, triangle.edgeDeltaX[1]);
-			edge2 = _mm_add_ps(edge2, triangle.edgeDeltaX[2]);
-			xInt = _mm_add_epi32(xInt, INC_XI);
-			continue;
-		}
+	// tile rectangle in NDC, y points up
+	const float scaleX = 2.0f / viewport.width;
+	const float scaleY = 2.0f / viewport.height;
+	const glm::vec2 ndcMin((tile.minX - viewport.x) * scaleX - 1.0f, 1.0f - (tile.maxY - viewport.y) * scaleY);
+	const glm::vec2 ndcMax((tile.maxX - viewport.x) * scaleX - 1.0f, 1.0f - (tile.minY - viewport.y) * scaleY);
+	const Frustum frustum = Frustum::fromTile(viewProjection, ndcMin, ndcMax, minW, maxW);
 
-		// perspective correction for texture coords
-		__m128 p0 = _mm_mul_ps(w0, triangle.invW[0]);
-		__m128 p1 = _mm_mul_ps(w1, triangle.invW[1]);
-		__m128 p2 = _mm_mul_ps(w2, triangle.invW[2]);
-		__m128 invSum = _mm_add_ps(_mm_add_ps(p0, p1), p2);
+	for (size_t i = mDirectionalLightCount; i < mShadingLights.size(); ++i)
+	{
+		if (frustum.intersects(mLightBounds[i]))
+			lightIndices[lightCount++] = static_cast<uint16_t>(i);
+	}
+	return lightCount;
+}
 
-		__m128 rcp = _mm_div_ps(ONE, invSum);
+void Renderer::resolveDeferred(const GBuffer& gbuffer, Framebuffer& framebuffer, const Camera& camera)
+{
+	if (gbuffer.getWidth() != framebuffer.getWidth() || gbuffer.getHeight() != framebuffer.getHeight())
+	{
+		throw std::invalid_argument("G-buffer and framebuffer must have the same size");
+	}
 
+	if (camera.isReverseZ() != framebuffer.isReverseZ())
+	{
+		throw std::invalid_argument("Camera and framebuffer must agree on reverse-Z depth");
+	}
 
-		// correct weights with perspective divide
-		p0 = _mm_mul_ps(p0, rcp);
-		p1 = _mm_mul_ps(p1, rcp);
-		p2 = _mm_mul_ps(p2, rcp);
+	if (framebuffer.getSampleCount() > 1)
+	{
+		throw std::invalid_argument("Deferred shading does not support multisampled framebuffers");
+	}
 
-		// interpolate attributes
-		__m128 texU = _mm_fmadd_ps(p2, triangle.u[2],
-		                           _mm_fmadd_ps(p1, triangle.u[1],
-		                                        _mm_mul_ps(p0, triangle.u[0])));
+	if (!framebuffer.isViewportFull())
+	{
+		throw std::invalid_argument("Deferred shading draws to the whole framebuffer");
+	}
 
-		__m128 texV = _mm_fmadd_ps(p2, triangle.v[2],
-		                           _mm_fmadd_ps(p1, triangle.v[1],
-		                                        _mm_mul_ps(p0, triangle.v[0])));
+	prepareLights();
 
-		__m128 normalX = _mm_fmadd_ps(p2, triangle.normalX[2],
-		                              _mm_fmadd_ps(p1, triangle.normalX[1],
-		                                           _mm_mul_ps(p0, triangle.normalX[0])));
+	std::array<bool, 256> litMaterials{};
+	for (size_t id = 1; id <= gbuffer.getMaterialCount(); ++id)
+	{
+		const Material* material = gbuffer.getMaterial(static_cast<uint8_t>(id));
+		litMaterials[id] = material && material->isLit();
+	}
 
-		__m128 normalY = _mm_fmadd_ps(p2, triangle.normalY[2],
-		                              _mm_fmadd_ps(p1, triangle.normalY[1],
-		                                           _mm_mul_ps(p0, triangle.normalY[0])));
+	const glm::mat4& viewProjection = camera.getViewProjectionMatrix();
+	const glm::mat4 inverseViewProjection = glm::inverse(viewProjection);
 
-		__m128 normalZ = _mm_fmadd_ps(p2, triangle.normalZ[2],
-		                              _mm_fmadd_ps(p1, triangle.normalZ[1],
-		                                           _mm_mul_ps(p0, triangle.normalZ[0])));
+	// same tile grid as the geometry pass, each tile is shaded once with its own lights
+	const int fbWidth = framebuffer.getWidth();
+	const int fbHeight = framebuffer.getHeight();
+	const int tileCountX = (fbWidth + TILE_WIDTH - 1) >> TILE_SHIFT;
+	const int tileCountY = (fbHeight + TILE_HEIGHT - 1) >> TILE_SHIFT;
 
-		__m128i colors;
-		fragmentShader(texU, texV, normalX, normalY, normalZ, material, colors);
+	std::vector<size_t> tileIndices(static_cast<size_t>(tileCountX) * tileCountY);
+	std::ranges::iota(tileIndices, 0);
 
-		framebuffer.setDepth(xInt, yInt, depth, insideMask);
-		framebuffer.setPixel(xInt, yInt, colors, insideMask);
+	std::for_each(std::execution::par, tileIndices.begin(), tileIndices.end(),
+	              [&](const size_t tileIndex)
+	              {
+		              const int tileMinX = static_cast<int>(tileIndex % tileCountX) << TILE_SHIFT;
+		              const int tileMinY = static_cast<int>(tileIndex / tileCountX) << TILE_SHIFT;
+
+		              thread_local std::vector<uint16_t> tileLights;
+		              tileLights.resize(mShadingLights.size());
+		              const TileJob tile{
+			              tileMinX, tileMinY,
+			              std::min(tileMinX + TILE_WIDTH, fbWidth), std::min(tileMinY + TILE_HEIGHT, fbHeight),
+			              nullptr, nullptr, 0, tileLights.data(), 0
+		              };
+
+		              resolveTile(gbuffer, framebuffer, tile, viewProjection, inverseViewProjection, litMaterials,
+		                          tileLights.data());
+	              });
 
-		edge0 = _mm_add_ps(edge0, triangle.edgeDeltaX[0]);
-		edge1 = _mm_add_ps(edge1, triangle.edgeDeltaX[1]);
-		edge2 = _mm_add_ps(edge2, triangle.edgeDeltaX[2]);
-		xInt = _mm_add_epi32(xInt, INC_XI);
-	}
+	// blended meshes queued by the geometry pass go on top of the lit result
+	drawTransparent(framebuffer, camera, mDeferredTransparentDraws);
 }
 
-void Renderer::rasterizeTile(Framebuffer& framebuffer, const Material* material,
-                             const int tileMinX, const int tileMinY, const int tileMaxX, const int tileMaxY,
-                             const size_t* triangleIndices, const int triangleCount) const
+void Renderer::resolveTile(const GBuffer& gbuffer, Framebuffer& framebuffer, const TileJob& tile,
+                           const glm::mat4& viewProjection, const glm::mat4& inverseViewProjection,
+                           const std::array<bool, 256>& litMaterials, uint16_t* lightIndices) const
 {
-	// validate input parameters
-	assert(triangleIndices && "Triangle indices pointer cannot be null");
-	assert(triangleCount >= 0 && "Triangle count must be non-negative");
-
-	for (int i = 0; i < triangleCount; ++i)
-	{
-		const size_t triangleIndex = triangleIndices[i];
-		assert(triangleIndex < mTriangleData.size() && "Triangle index out of bounds");
+	const uint8_t* materialIds = gbuffer.getMaterialIds();
+	const bool reverseZ = framebuffer.isReverseZ();
 
-		const TriangleData& triangle = mTriangleData[triangleIndex];
+	DrawState draw{PIPELINE_LIT, nullptr, TextureFilter::Nearest, 0};
+	draw.lights = mShadingLights.data();
+	draw.lightIndices = lightIndices;
 
-		const int minX = std::max(tileMinX, triangle.minX);
-		const int maxX = std::min(tileMaxX - 1, triangle.maxX);
-		const int minY = std::max(tileMinY, triangle.minY);
-		const int maxY = std::min(tileMaxY - 1, triangle.maxY);
-
-		if (minX > maxX || minY > maxY) continue;
+	// local lights are culled against the depth range of the covered pixels
+	float minW = 0.0f;
+	float maxW = 0.0f;
+	if (mShadingLights.size() > mDirectionalLightCount)
+	{
+		float minDepth = std::numeric_limits<float>::max();
+		float maxDepth = std::numeric_limits<float>::lowest();
+		for (int y = tile.minY; y < tile.maxY; ++y)
+		{
+			for (int x = tile.minX; x < tile.maxX; ++x)
+			{
+				if (materialIds[gbuffer.getIndex(x, y)] == 0) continue;
+				const float depth = framebuffer.getDepth(x, y);
+				minDepth = std::min(minDepth, depth);
+				maxDepth = std::max(maxDepth, depth);
+			}
+		}
 
-		for (int y = minY; y <= maxY; ++y)
+		if (minDepth > maxDepth)
 		{
-			rasterizeScanline(framebuffer, material, triangle, y, minX, maxX + 1);
+			return; // nothing drawn here
 		}
-	}
-}
 
-void Renderer::fragmentShader(__m128 u, __m128 v, __m128 normalX, __m128 normalY, __m128 normalZ,
-                              const Material* material, __m128i& colors) const
-{
-	if (!material)
-	{
-		colors = _mm_set1_epi32(0x00FFFF);
-		return;
+		// for a perspective projection clip-space w only depends on depth
+		auto depthToW = [&](const float depth)
+		{
+			const float ndcZ = reverseZ ? depth : depth * 2.0f - 1.0f;
+			return 1.0f / (inverseViewProjection * glm::vec4(0.0f, 0.0f, ndcZ, 1.0f)).w;
+		};
+		minW = std::min(depthToW(minDepth), depthToW(maxDepth));
+		maxW = std::max(depthToW(minDepth), depthToW(maxDepth));
 	}
+	draw.lightCount = cullTileLights(tile, minW, maxW, viewProjection, framebuffer.getViewport(), lightIndices);
 
-	// normal light dot product for diffuse lighting
-	__m128 dot = _mm_add_ps(
-		_mm_mul_ps(normalX, lightDirX),
-		_mm_add_ps(
-			_mm_mul_ps(normalY, lightDirY),
-			_mm_mul_ps(normalZ, lightDirZ)
-		)
-	);
-
-	// lambert term (clamp to [0,1])
-	__m128 lambert = _mm_max_ps(dot, ZERO);
-	lambert = _mm_min_ps(lambert, ONE);
-
-	// add ambient light and clamp
-	__m128 lighting = _mm_min_ps(_mm_add_ps(ambientIntensity, lambert), ONE);
-
-	// get texture color or use white
-	__m128i texColor;
-	const Texture* diffuseMap = material ? material->getDiffuseTexture() : nullptr;
-	if (diffuseMap && diffuseMap->isLoaded())
-	{
-		texColor = diffuseMap->sample(u, v);
-	}
-	else
+	const glm::mat4& m = inverseViewProjection;
+	auto transform = [&](const int row, const __m128 x, const __m128 y, const __m128 z)
 	{
-		texColor = _mm_set1_epi32(0xFFFFFF);
-	}
+		return _mm_fmadd_ps(_mm_set1_ps(m[0][row]), x,
+		                    _mm_fmadd_ps(_mm_set1_ps(m[1][row]), y,
+		                                 _mm_fmadd_ps(_mm_set1_ps(m[2][row]), z, _mm_set1_ps(m[3][row]))));
+	};
 
-	// split RGB channels
-	__m128i r = _mm_and_si128(texColor, MASK_FF);
-	__m128i g = _mm_and_si128(_mm_srli_epi32(texColor, 8), MASK_FF);
-	__m128i b = _mm_and_si128(_mm_srli_epi32(texColor, 16), MASK_FF);
+	const __m128 ndcScaleX = _mm_set1_ps(2.0f / framebuffer.getWidth());
+	const __m128 ndcScaleY = _mm_set1_ps(-2.0f / framebuffer.getHeight());
+	const __m128i maxX = _mm_set1_epi32(framebuffer.getWidth() - 1);
 
-	// apply lighting
-	__m128 rFloat = _mm_mul_ps(_mm_cvtepi32_ps(r), INV_255);
-	__m128 gFloat = _mm_mul_ps(_mm_cvtepi32_ps(g), INV_255);
-	__m128 bFloat = _mm_mul_ps(_mm_cvtepi32_ps(b), INV_255);
-
-	rFloat = _mm_mul_ps(rFloat, lighting);
-	gFloat = _mm_mul_ps(gFloat, lighting);
-	bFloat = _mm_mul_ps(bFloat, lighting);
+	for (int y = tile.minY; y < tile.maxY; ++y)
+	{
+		const __m128i yInt = _mm_set1_epi32(y);
+		const __m128 ndcY = _mm_fmadd_ps(_mm_set1_ps(y + 0.5f), ndcScaleY, Rasterizer::ONE);
 
-	rFloat = _mm_mul_ps(rFloat, MUL_255);
-	gFloat = _mm_mul_ps(gFloat, MUL_255);
-	bFloat = _mm_mul_ps(bFloat, MUL_255);
+		// tiles are padded to whole quads in the G-buffer, lanes past the framebuffer have no material
+		for (int x = tile.minX; x < tile.maxX; x += 4)
+		{
+			const size_t index = gbuffer.getIndex(x, y);
+			uint32_t packedIds;
+			std::memcpy(&packedIds, materialIds + index, sizeof(packedIds));
+			if (packedIds == 0) continue;
+
+			int mask = 0;
+			alignas(16) int litLanes[4];
+			for (int i = 0; i < 4; ++i)
+			{
+				const uint8_t id = materialIds[index + i];
+				mask |= (id != 0) << i;
+				litLanes[i] = litMaterials[id] ? -1 : 0;
+			}
 
-	__m128i rOut = _mm_cvtps_epi32(rFloat);
-	__m128i gOut = _mm_cvtps_epi32(gFloat);
-	__m128i bOut = _mm_cvtps_epi32(bFloat);
+			const __m128i xInt = _mm_add_epi32(_mm_set1_epi32(x), Rasterizer::OFFSETS_I);
+			const __m128 depth = framebuffer.gatherDepth(_mm_min_epi32(xInt, maxX), yInt);
+			const __m128i albedo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(gbuffer.getAlbedo() + index));
 
-	// pack to output RGB format
-	rOut = _mm_and_si128(rOut, MASK_FF);
-	gOut = _mm_slli_epi32(_mm_and_si128(gOut, MASK_FF), 8);
-	bOut = _mm_slli_epi32(_mm_and_si128(bOut, MASK_FF), 16);
+			const __m128i lit = _mm_load_si128(reinterpret_cast<const __m128i*>(litLanes));
+			__m128i colors = albedo;
+			if (_mm_movemask_ps(_mm_castsi128_ps(lit)) & mask)
+			{
+				const __m128 zero = Rasterizer::ZERO;
+				FragmentQuad quad{
+					xInt, yInt, depth, zero, zero, zero, zero, zero, zero, zero, zero, zero, zero, zero, 0.0f, mask
+				};
+				GBuffer::decodeNormal(
+					_mm_loadu_si128(reinterpret_cast<const __m128i*>(gbuffer.getNormals() + index)),
+					quad.normalX, quad.normalY, quad.normalZ);
+
+				// world position back from the pixel centre and its depth
+				const __m128 ndcX = _mm_fmsub_ps(_mm_add_ps(_mm_cvtepi32_ps(xInt), _mm_set1_ps(0.5f)), ndcScaleX,
+				                                 Rasterizer::ONE);
+				const __m128 ndcZ = reverseZ ? depth : _mm_fmsub_ps(depth, _mm_set1_ps(2.0f), Rasterizer::ONE);
+				const __m128 invW = _mm_div_ps(Rasterizer::ONE, transform(3, ndcX, ndcY, ndcZ));
+				quad.worldX = _mm_mul_ps(transform(0, ndcX, ndcY, ndcZ), invW);
+				quad.worldY = _mm_mul_ps(transform(1, ndcX, ndcY, ndcZ), invW);
+				quad.worldZ = _mm_mul_ps(transform(2, ndcX, ndcY, ndcZ), invW);
+
+				colors = _mm_blendv_epi8(albedo, mDefaultShader.applyLighting(albedo, quad, draw), lit);
+			}
 
-	colors = _mm_or_si128(
-		_mm_or_si128(rOut, gOut),
-		bOut
-	);
+			framebuffer.setPixel(xInt, yInt, colors, mask);
+		}
+	}
 }
@@ -2,32 +2,22 @@
 #include <vector>
 #include <memory>
 #include <array>
+#include <chrono>
+#include <cstdint>
+#include <span>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_inverse.hpp>
 #include "Framebuffer.h"
 #include "Camera.h"
 #include "Model.h"
 #include "Mesh.h"
+#include "Shader.h"
 
-struct alignas(16) TriangleData
+struct RenderStats
 {
-	// screen-space bounds
-	int minX, maxX, minY, maxY;
-
-	// barycentric calculation data
-	__m128 invArea;
-	__m128 edgeA[3];
-	__m128 edgeB[3];
-	__m128 edgeC[3];
-	__m128 edgeDeltaX[3]; // for pixel stepping
-
-	//attributes
-	__m128 depth[3];
-	__m128 invW[3];
-	__m128 u[3], v[3];
-	__m128 normalX[3];
-	__m128 normalY[3];
-	__m128 normalZ[3];
+	size_t culledMeshes = 0;
+	size_t culledMeshlets = 0;
+	size_t rasterizedTriangles = 0;
 };
 
 class Renderer
@@ -35,19 +25,93 @@ class Renderer
 public:
 	Renderer();
 
+	const RenderStats& getStats() const { return mStats; }
+	void resetStats() { mStats = {}; }
+
+	// opaque and masked meshes are drawn right away, blended ones wait for renderTransparent
 	void renderModel(Framebuffer& framebuffer, const Camera& camera, const Model& model);
 	void renderMesh(Framebuffer& framebuffer, const Camera& camera, const Mesh& mesh,
 	                const glm::mat4& modelMatrix);
 
+	// draws the blended meshes renderModel queued since the last call, once per frame after every opaque model;
+	// their models must live until then. The triangles of all of them share one set of tile bins and are
+	// sorted back to front within each tile, so overlapping meshes blend in order triangle by triangle
+	void renderTransparent(Framebuffer& framebuffer, const Camera& camera);
+
+	// deferred shading: the geometry pass stores surfaces of any number of models in the G-buffer,
+	// which must be cleared with the framebuffer, then the resolve lights each tile once.
+	// Materials' own shaders are not run, draw those models with renderModel after the resolve.
+	// Blended meshes are kept aside and drawn forward at the end of the resolve, their models must live until then.
+	void renderModelDeferred(GBuffer& gbuffer, Framebuffer& framebuffer, const Camera& camera, const Model& model);
+	void resolveDeferred(const GBuffer& gbuffer, Framebuffer& framebuffer, const Camera& camera);
+
+	// depth-only pass from the light camera into the shadow map, which also takes its view-projection;
+	// the map is cleared once, then every caster is drawn into it
+	void renderShadowMap(ShadowMap& shadowMap, const Camera& lightCamera, std::span<const Model* const> casters);
+	void renderShadowMap(ShadowMap& shadowMap, const Camera& lightCamera, const Model& caster)
+	{
+		const Model* casters[] = {&caster};
+		renderShadowMap(shadowMap, lightCamera, casters);
+	}
+
+	// picks the pipeline variant for a material, null draws flat and unlit
+	static DrawState resolveDrawState(const Material* material);
+
+	// used by materials without a shader of their own
+	DefaultShader& getDefaultShader() { return mDefaultShader; }
+
+	// starts with one white directional light. Every light that overlaps a tile shades it, however many
+	// there are; lights are indexed with 16 bits, so at most 65535
+	void addLight(const Light& light) { mLights.push_back(light); }
+	void setLights(std::vector<Light> lights) { mLights = std::move(lights); }
+	void clearLights() { mLights.clear(); }
+	const std::vector<Light>& getLights() const { return mLights; }
+
+	// dynamic resolution: with a budget, frames are drawn at a reduced size into an internal
+	// framebuffer that is scaled up into the output, and the scale follows the measured frame time.
+	// 0 draws straight into the output at full size
+	void setFrameTimeBudget(float milliseconds);
+	float getFrameTimeBudget() const { return mFrameTimeBudget; }
+	float getRenderScale() const { return mRenderScale; }
+
+	// framebuffer to clear and draw the frame into; endFrame scales it into the output.
+	// Multisample the returned framebuffer rather than the output, and resolve it before endFrame
+	Framebuffer& beginFrame(Framebuffer& output);
+	void endFrame(Framebuffer& output);
+
 private:
 	static constexpr int TILE_WIDTH = 16;
 	static constexpr int TILE_HEIGHT = 16;
 	static constexpr int TILE_SHIFT = 4;
+	static_assert(TILE_WIDTH == GBuffer::TILE_SIZE && TILE_HEIGHT == GBuffer::TILE_SIZE,
+	              "Deferred tiles must match the G-buffer layout");
+
+	// 24.8 fixed-point vertex positions
+	static constexpr int SUBPIXEL_BITS = 8;
+	static constexpr int SUBPIXEL_SCALE = 1 << SUBPIXEL_BITS;
+
+	// furthest MSAA sample from the pixel centre along either axis, in subpixels
+	static constexpr int MSAA_SAMPLE_REACH = 6 * SUBPIXEL_SCALE / 16;
+
+	// triangles within this many pixels outside the screen are rasterized without side clipping;
+	// coordinates below 2^14 pixels keep edge steps within 2^23 subpixels
+	static constexpr int GUARD_BAND_PIXELS = 4096;
+	static constexpr float MAX_SCREEN_COORD = 16384.0f;
+
+	static constexpr int CLIP_PLANE_COUNT = 5; // near + 4 guard band sides
+	static constexpr int MAX_CLIP_VERTICES = 3 + CLIP_PLANE_COUNT;
+
+	// dynamic resolution never draws below this fraction of the output size per axis
+	static constexpr float MIN_RENDER_SCALE = 0.25f;
 
 	int mTileCountX = 0;
 	int mTileCountY = 0;
 	size_t mTriangleCount = 0;
 
+	RenderStats mStats;
+
+	std::vector<const Meshlet*> mVisibleMeshlets;
+	std::vector<ClipVertex> mShadedVertices;
 	std::vector<TriangleData> mTriangleData;
 	std::vector<size_t> mValidTriangles;
 
@@ -57,44 +121,99 @@ private:
 	std::vector<std::array<int, 4>> mTileRanges;
 	std::vector<int> mBinWritePos;
 
-	// lighting parameters
-	__m128 lightDirX = _mm_set1_ps(0.5f);
-	__m128 lightDirY = _mm_set1_ps(0.5f);
-	__m128 lightDirZ = _mm_set1_ps(0.5f);
-	__m128 ambientIntensity = _mm_set1_ps(0.2f);
+	DefaultShader mDefaultShader;
+	DepthShader mDepthShader;
+	GBufferShader mGBufferShader;
+
+	std::vector<Light> mLights;
+
+	// blended mesh waiting for the transparent pass
+	struct TransparentDraw
+	{
+		const Mesh* mesh;
+		glm::mat4 modelMatrix;
+	};
+	std::vector<TransparentDraw> mTransparentDraws;
+	std::vector<TransparentDraw> mDeferredTransparentDraws;
+
+	// one draw's program and state, several of them share the bins in the transparent pass
+	struct DrawBatch
+	{
+		const ShaderProgram* shader;
+		DrawState draw;
+		TileRasterizer rasterizer;
+	};
+	std::vector<DrawBatch> mDrawBatches;
+	std::vector<uint32_t> mTriangleBatches; // batch of each assembled triangle, only with several batches
+
+	// per draw: directional lights first, then point and spot lights with their world-space bounds
+	std::vector<ShadingLight> mShadingLights;
+	std::vector<BoundingSphere> mLightBounds;
+	size_t mDirectionalLightCount = 0;
+	std::vector<uint16_t> mAllLightIndices;
+
+	float mFrameTimeBudget = 0.0f;
+	float mRenderScale = 1.0f;
+	std::unique_ptr<Framebuffer> mScaledTarget;
+	std::chrono::steady_clock::time_point mFrameStart;
+
+	// moves the render scale towards the one that would have met the budget
+	void adaptRenderScale(float frameMilliseconds);
 
 	void preallocateBuffers(size_t vertexCount);
 
-	void processVerticesAndAssembleTriangles(const VertexArray& vertices, const glm::mat4& mvp,
+	void drawModel(Framebuffer& framebuffer, const Camera& camera, const Model& model, GBuffer* gbuffer);
+
+	// assembles the triangles of every draw, rasterizes them in one pass and empties the list
+	void drawTransparent(Framebuffer& framebuffer, const Camera& camera, std::vector<TransparentDraw>& draws);
+
+	void drawMesh(Framebuffer& framebuffer, const Camera& camera, const Mesh& mesh, const glm::mat4& modelMatrix,
+	              const ShaderProgram& shader, const DrawState& draw);
+
+	// appends the visible triangles of the mesh to the triangle data without rasterizing them
+	void assembleMesh(Framebuffer& framebuffer, const Camera& camera, const Mesh& mesh,
+	                  const glm::mat4& modelMatrix, const ShaderProgram& shader, const DrawState& draw);
+
+	void prepareLights();
+
+	void cullMeshlets(const Mesh& mesh, const Camera& camera, const glm::mat4& meshMatrix);
+
+	void processVerticesAndAssembleTriangles(const VertexArray& vertices,
+	                                         const std::vector<const Meshlet*>& meshlets,
+	                                         const ShaderProgram& shader, const VertexUniforms& uniforms,
 	                                         const glm::mat3& normalMatrix,
-	                                         int fbWidth, int fbHeight);
+	                                         const Viewport& viewport, bool reverseZ, bool multisampled,
+	                                         const DrawState& draw);
 
-	void setupTriangle(TriangleData& triangle, int* screenX, int* screenY,
-	                   const float* ndcZ, const float* invW, const VertexArray& vertices,
-	                   size_t baseVertex, const glm::mat3& normalMatrix);
+	// per-vertex lighting of the first count shaded vertices with every light of the draw
+	void lightVertices(size_t count, const glm::mat3& normalMatrix, const DrawState& draw);
 
-	void binTriangles();
+	void assembleTriangle(const ClipVertex* corners, const glm::mat3& normalMatrix,
+	                      const Viewport& viewport, float depthScale, float depthOffset, uint32_t pipeline,
+	                      bool multisampled);
 
-	void rasterizeTiles(Framebuffer& framebuffer, const Material* material);
+	// attribute planes the pipeline does not read are left unset, as are the sample
+	// edge offsets of single-sampled triangles
+	void setupTriangle(TriangleData& triangle, const int* fixedX, const int* fixedY,
+	                   const float* windowZ, const float* invW, const ClipVertex* corners,
+	                   const glm::mat3& normalMatrix, uint32_t pipeline, bool multisampled);
+
+	void binTriangles();
 
-	void rasterizeTile(Framebuffer& framebuffer, const Material* material,
-	                   int tileMinX, int tileMinY, int tileMaxX, int tileMaxY,
-	                   const size_t* triangleIndices, int triangleCount) const;
+	// with several batches each triangle is rasterized by its own, runs of one batch in a tile go in one call
+	void rasterizeTiles(Framebuffer& framebuffer, std::span<const DrawBatch> batches,
+	                    const glm::mat4& viewProjection);
 
-	void rasterizeScanline(Framebuffer& framebuffer, const Material* material,
-	                       const TriangleData& triangle, int y, int startX, int endX) const;
+	// back to front by mean clip-space w, ties keep submission order
+	void sortBackToFront(size_t* triangleIndices, int count) const;
 
-	void fragmentShader(__m128 u, __m128 v, __m128 normalX, __m128 normalY, __m128 normalZ,
-	                    const Material* material, __m128i& colors) const;
+	// directional lights plus the local lights whose range reaches the tile's frustum,
+	// bounded by the clip-space w range of what the tile shows; lightIndices has room for every light
+	int cullTileLights(const TileJob& tile, float minW, float maxW, const glm::mat4& viewProjection,
+	                   const Viewport& viewport, uint16_t* lightIndices) const;
 
-	// SIMD constants
-	static inline const __m128 INV_255 = _mm_set1_ps(1.0f / 255.0f);
-	static inline const __m128 MUL_255 = _mm_set1_ps(255.0f);
-	static inline const __m128i MASK_FF = _mm_set1_epi32(0xFF);
-	static inline const __m128i OFFSETS_I = _mm_set_epi32(3, 2, 1, 0);
-	static inline const __m128i INC_XI = _mm_set1_epi32(4);
-	static inline const __m128 ONE = _mm_set1_ps(1.0f);
-	static inline const __m128 NEG_ONE = _mm_set1_ps(-1.0f);
-	static inline const __m128 ZERO = _mm_setzero_ps();
-	static inline const __m128 PIXEL_OFFSETS = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+	// lights one tile of the G-buffer into the framebuffer
+	void resolveTile(const GBuffer& gbuffer, Framebuffer& framebuffer, const TileJob& tile,
+	                 const glm::mat4& viewProjection, const glm::mat4& inverseViewProjection,
+	                 const std::array<bool, 256>& litMaterials, uint16_t* lightIndices) const;
 };
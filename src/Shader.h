@@ -0,0 +1,345 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <utility>
+#include <glm/glm.hpp>
+#include "GBuffer.h"
+#include "Rasterizer.h"
+#include "VertexArray.h"
+
+// per-draw transforms handed to vertex programs
+struct VertexUniforms
+{
+	glm::mat4 mvp;
+	glm::mat4 model;
+};
+
+// object-space vertex as read from the vertex array
+struct VertexInput
+{
+	glm::vec3 position;
+	float u, v;
+	glm::vec3 normal;
+};
+
+class ShaderProgram;
+
+using TileRasterizer = void (*)(const ShaderProgram&, Framebuffer&, const DrawState&, const TileJob&);
+
+// type-erased shader bound to a material; the renderer only calls through it once per
+// meshlet and once per tile, the per-vertex and per-quad work is compiled into the program
+class ShaderProgram
+{
+public:
+	virtual ~ShaderProgram() = default;
+
+	// outputs clip-space vertices for vertices [first, first + count), normals stay in object space
+	virtual void shadeVertices(const VertexArray& vertices, size_t first, size_t count,
+	                           const VertexUniforms& uniforms, ClipVertex* output) const = 0;
+
+	virtual TileRasterizer getTileRasterizer(uint32_t pipeline) const = 0;
+};
+
+// CRTP base for shaders. Derived classes provide
+//   __m128i fragment(const FragmentQuad& quad, const DrawState& draw) const
+// returning packed RGB for the four pixels, optionally as a template on the pipeline flags,
+// unless they declare WRITES_COLOR = false for depth-only rendering or WRITES_GBUFFER = true
+// with an int writeGBuffer<Pipeline> of the same parameters, returning the lanes it stored, for
+// deferred shading. The fourth byte of a color is its alpha. They may also hide
+//   void vertex(const VertexInput& input, const VertexUniforms& uniforms, ClipVertex& output) const
+// Both are inlined into the vertex loop and the rasterizer, so no call is virtual per vertex or per pixel.
+template <typename Derived>
+class Shader : public ShaderProgram
+{
+public:
+	void vertex(const VertexInput& input, const VertexUniforms& uniforms, ClipVertex& output) const
+	{
+		output.position = uniforms.mvp * glm::vec4(input.position, 1.0f);
+		output.worldPosition = glm::vec3(uniforms.model * glm::vec4(input.position, 1.0f));
+		output.u = input.u;
+		output.v = input.v;
+		output.normal = input.normal;
+	}
+
+	void shadeVertices(const VertexArray& vertices, const size_t first, const size_t count,
+	                   const VertexUniforms& uniforms, ClipVertex* output) const final
+	{
+		const Derived& program = static_cast<const Derived&>(*this);
+		const size_t end = first + count;
+
+		// depth-only programs never read the other attributes
+		if constexpr (!Rasterizer::writesColor<Derived>())
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				const size_t index = first + i;
+				VertexInput input{};
+				input.position = glm::vec3(vertices.positionsX[index], vertices.positionsY[index],
+				                           vertices.positionsZ[index]);
+				program.vertex(input, uniforms, output[i]);
+			}
+			return;
+		}
+
+		const bool hasAttributes = vertices.uvsU.size() >= end && vertices.uvsV.size() >= end &&
+			vertices.normalsX.size() >= end && vertices.normalsY.size() >= end && vertices.normalsZ.size() >= end;
+		assert(hasAttributes && "Vertex attribute index out of bounds");
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			const size_t index = first + i;
+			VertexInput input;
+			input.position = glm::vec3(vertices.positionsX[index], vertices.positionsY[index],
+			                           vertices.positionsZ[index]);
+
+			if (hasAttributes)
+			{
+				input.u = vertices.uvsU[index];
+				input.v = vertices.uvsV[index];
+				input.normal = glm::vec3(vertices.normalsX[index], vertices.normalsY[index],
+				                         vertices.normalsZ[index]);
+			}
+			else
+			{
+				// use default values for missing attributes
+				input.u = 0.0f;
+				input.v = 0.0f;
+				input.normal = glm::vec3(0.0f, 0.0f, 1.0f);
+			}
+
+			program.vertex(input, uniforms, output[i]);
+		}
+	}
+
+	TileRasterizer getTileRasterizer(const uint32_t pipeline) const final
+	{
+		// one instantiation per variant this program can run, chosen once for the whole draw
+		static constexpr auto pipelines = Rasterizer::reachablePipelines<Derived>();
+		static constexpr auto tileRasterizers = []<size_t... Variants>(std::index_sequence<Variants...>)
+		{
+			return std::array<TileRasterizer, sizeof...(Variants)>{&rasterizeTile<pipelines[Variants]>...};
+		}(std::make_index_sequence<pipelines.size()>());
+
+		// slot of every flag combination's variant in the table
+		static constexpr auto variantSlots = []
+		{
+			std::array<uint8_t, PIPELINE_VARIANTS> slots{};
+			for (uint32_t flags = 0; flags < PIPELINE_VARIANTS; ++flags)
+			{
+				const uint32_t variant = Rasterizer::programPipeline<Derived>(flags);
+				for (size_t slot = 0; slot < pipelines.size(); ++slot)
+				{
+					if (pipelines[slot] == variant)
+						slots[flags] = static_cast<uint8_t>(slot);
+				}
+			}
+			return slots;
+		}();
+
+		assert(pipeline < PIPELINE_VARIANTS && "Invalid pipeline state");
+		return tileRasterizers[variantSlots[pipeline]];
+	}
+
+private:
+	template <uint32_t Pipeline>
+	static void rasterizeTile(const ShaderProgram& program, Framebuffer& framebuffer, const DrawState& draw,
+	                          const TileJob& tile)
+	{
+		Rasterizer::rasterizeTile<Pipeline>(static_cast<const Derived&>(program), framebuffer, draw, tile);
+	}
+};
+
+// diffuse texture sample or the flat base color, whichever the pipeline uses
+template <uint32_t Pipeline>
+__m128i sampleBaseColor(const FragmentQuad& quad, const DrawState& draw)
+{
+	if constexpr ((Pipeline & PIPELINE_TEXTURED) != 0)
+		return draw.diffuseMap->sample(quad.u, quad.v, quad.lod, draw.filter, draw.wrapU, draw.wrapV);
+	else
+		return _mm_set1_epi32(static_cast<int>(draw.baseColor));
+}
+
+// depth-only pass for shadow maps, only positions are transformed
+class DepthShader : public Shader<DepthShader>
+{
+public:
+	static constexpr bool WRITES_COLOR = false;
+
+	void vertex(const VertexInput& input, const VertexUniforms& uniforms, ClipVertex& output) const
+	{
+		output = {};
+		output.position = uniforms.mvp * glm::vec4(input.position, 1.0f);
+	}
+};
+
+// ambient + Lambertian diffuse from the tile's lights over the diffuse texture or the flat base color
+class DefaultShader : public Shader<DefaultShader>
+{
+public:
+	void setAmbientIntensity(const float intensity) { mAmbientIntensity = _mm_set1_ps(intensity); }
+
+	template <uint32_t Pipeline>
+	__m128i fragment(const FragmentQuad& quad, const DrawState& draw) const
+	{
+		// get texture color or use the flat base color
+		const __m128i texColor = sampleBaseColor<Pipeline>(quad, draw);
+
+		if constexpr ((Pipeline & PIPELINE_LIT) == 0)
+		{
+			return texColor;
+		}
+		else if constexpr ((Pipeline & PIPELINE_VERTEX_LIT) != 0)
+		{
+			return modulate(texColor, quad.lightR, quad.lightG, quad.lightB);
+		}
+		else
+		{
+			return applyLighting(texColor, quad, draw);
+		}
+	}
+
+	// lights the four albedo colors with the lights listed in the draw, also used by the deferred resolve
+	__m128i applyLighting(const __m128i texColor, const FragmentQuad& quad, const DrawState& draw) const
+	{
+		__m128 lightR, lightG, lightB;
+		computeLight(quad.normalX, quad.normalY, quad.normalZ, quad.worldX, quad.worldY, quad.worldZ, draw,
+		             lightR, lightG, lightB);
+		return modulate(texColor, lightR, lightG, lightB);
+	}
+
+	// ambient plus the diffuse light of the lights listed in the draw at four world-space points,
+	// also used by the renderer to light vertices for per-vertex lit pipelines
+	void computeLight(const __m128 normalX, const __m128 normalY, const __m128 normalZ,
+	                  const __m128 worldX, const __m128 worldY, const __m128 worldZ, const DrawState& draw,
+	                  __m128& lightR, __m128& lightG, __m128& lightB) const
+	{
+		lightR = mAmbientIntensity;
+		lightG = mAmbientIntensity;
+		lightB = mAmbientIntensity;
+
+		for (int i = 0; i < draw.lightCount; ++i)
+		{
+			const ShadingLight& light = draw.lights[draw.lightIndices[i]];
+
+			__m128 toLightX, toLightY, toLightZ;
+			__m128 attenuation = Rasterizer::ONE;
+			if (light.type == LightType::Directional)
+			{
+				toLightX = _mm_set1_ps(light.toLight.x);
+				toLightY = _mm_set1_ps(light.toLight.y);
+				toLightZ = _mm_set1_ps(light.toLight.z);
+			}
+			else
+			{
+				toLightX = _mm_sub_ps(_mm_set1_ps(light.position.x), worldX);
+				toLightY = _mm_sub_ps(_mm_set1_ps(light.position.y), worldY);
+				toLightZ = _mm_sub_ps(_mm_set1_ps(light.position.z), worldZ);
+
+				const __m128 distanceSquared = _mm_fmadd_ps(toLightX, toLightX,
+				                                            _mm_fmadd_ps(toLightY, toLightY,
+				                                                         _mm_mul_ps(toLightZ, toLightZ)));
+				const __m128 invDistance = _mm_rsqrt_ps(_mm_max_ps(distanceSquared, MIN_DISTANCE_SQUARED));
+				toLightX = _mm_mul_ps(toLightX, invDistance);
+				toLightY = _mm_mul_ps(toLightY, invDistance);
+				toLightZ = _mm_mul_ps(toLightZ, invDistance);
+
+				// (1 - d^2 / range^2)^2 reaches zero at the range
+				const __m128 window = _mm_max_ps(
+					_mm_fnmadd_ps(distanceSquared, _mm_set1_ps(light.invRangeSquared), Rasterizer::ONE),
+					Rasterizer::ZERO);
+				attenuation = _mm_mul_ps(window, window);
+
+				if (light.type == LightType::Spot)
+				{
+					const __m128 cosAngle = _mm_fmadd_ps(toLightX, _mm_set1_ps(light.toLight.x),
+					                                     _mm_fmadd_ps(toLightY, _mm_set1_ps(light.toLight.y),
+					                                                  _mm_mul_ps(toLightZ, _mm_set1_ps(light.toLight.z))));
+					const __m128 cone = _mm_fmadd_ps(cosAngle, _mm_set1_ps(light.coneScale),
+					                                 _mm_set1_ps(light.coneOffset));
+					attenuation = _mm_mul_ps(attenuation,
+					                         _mm_min_ps(_mm_max_ps(cone, Rasterizer::ZERO), Rasterizer::ONE));
+				}
+			}
+
+			// lambert term
+			const __m128 dot = _mm_fmadd_ps(normalX, toLightX,
+			                                _mm_fmadd_ps(normalY, toLightY, _mm_mul_ps(normalZ, toLightZ)));
+			__m128 diffuse = _mm_mul_ps(_mm_max_ps(dot, Rasterizer::ZERO), attenuation);
+
+			if (light.shadowMap)
+			{
+				diffuse = _mm_mul_ps(diffuse, light.shadowMap->sample(worldX, worldY, worldZ));
+			}
+
+			lightR = _mm_fmadd_ps(diffuse, _mm_set1_ps(light.radiance.x), lightR);
+			lightG = _mm_fmadd_ps(diffuse, _mm_set1_ps(light.radiance.y), lightG);
+			lightB = _mm_fmadd_ps(diffuse, _mm_set1_ps(light.radiance.z), lightB);
+		}
+	}
+
+	// scales four packed colors by the light, clamped to [0,1], in 16-bit fixed point; alpha is kept
+	static __m128i modulate(const __m128i texColor, const __m128 lightR, const __m128 lightG, const __m128 lightB)
+	{
+		// 8.8 light factors, 256 is full intensity
+		const __m128i factorR = toFactor(lightR);
+		const __m128i factorG = toFactor(lightG);
+		const __m128i factorB = toFactor(lightB);
+
+		// per pixel the words R G B A, alpha at full intensity
+		const __m128i factorRG = _mm_or_si128(factorR, _mm_slli_epi32(factorG, 16));
+		const __m128i factorBA = _mm_or_si128(factorB, FULL_ALPHA_FACTOR);
+		const __m128i factorsLo = _mm_unpacklo_epi32(factorRG, factorBA);
+		const __m128i factorsHi = _mm_unpackhi_epi32(factorRG, factorBA);
+
+		// bytes widened to c * 257, so the high half of the product is c * factor / 256 and 256 keeps c exactly
+		const __m128i lo = _mm_mulhi_epu16(_mm_unpacklo_epi8(texColor, texColor), factorsLo);
+		const __m128i hi = _mm_mulhi_epu16(_mm_unpackhi_epi8(texColor, texColor), factorsHi);
+
+		return _mm_packus_epi16(lo, hi);
+	}
+
+private:
+	__m128 mAmbientIntensity = _mm_set1_ps(0.2f);
+
+	// SIMD constants
+	static inline const __m128 FACTOR_SCALE = _mm_set1_ps(256.0f);
+	static inline const __m128i FULL_ALPHA_FACTOR = _mm_set1_epi32(256 << 16);
+	static inline const __m128 MIN_DISTANCE_SQUARED = _mm_set1_ps(1e-8f);
+
+	static __m128i toFactor(const __m128 light)
+	{
+		const __m128 clamped = _mm_min_ps(_mm_max_ps(light, Rasterizer::ZERO), Rasterizer::ONE);
+		return _mm_cvtps_epi32(_mm_mul_ps(clamped, FACTOR_SCALE));
+	}
+};
+
+// geometry pass of deferred shading: stores albedo, normal and material id instead of a color
+class GBufferShader : public Shader<GBufferShader>
+{
+public:
+	static constexpr bool WRITES_GBUFFER = true;
+
+	// set by the renderer before each draw
+	void bind(GBuffer* target, const uint8_t materialId)
+	{
+		mTarget = target;
+		mMaterialId = materialId;
+	}
+
+	template <uint32_t Pipeline>
+	int writeGBuffer(const FragmentQuad& quad, const DrawState& draw) const
+	{
+		const __m128i albedo = sampleBaseColor<Pipeline>(quad, draw);
+
+		int mask = quad.mask;
+		if constexpr ((Pipeline & PIPELINE_ALPHA_TEST) != 0)
+			mask &= Rasterizer::alphaTestMask(albedo, draw);
+
+		mTarget->store(quad.x, quad.y, quad.normalX, quad.normalY, quad.normalZ, albedo, mMaterialId, mask);
+		return mask;
+	}
+
+private:
+	GBuffer* mTarget = nullptr;
+	uint8_t mMaterialId = 0;
+};
@@ -0,0 +1,95 @@
+#include "ShadowMap.h"
+
+ShadowMap::ShadowMap(const int size, const DepthFormat depthFormat)
+	: mDepth(size, size, depthFormat, false)
+{
+}
+
+__m128 ShadowMap::compare(const __m128i x, const __m128i y, const __m128 depth) const
+{
+	const __m128 stored = mDepth.gatherDepth(x, y);
+	const __m128 lit = mDepth.isReverseZ() ? _mm_cmpge_ps(depth, stored) : _mm_cmple_ps(depth, stored);
+	return _mm_and_ps(lit, _mm_set1_ps(1.0f));
+}
+
+__m128 ShadowMap::sample(const __m128 worldX, const __m128 worldY, const __m128 worldZ) const
+{
+	const glm::mat4& m = mViewProjection;
+	auto transform = [&](const int row)
+	{
+		return _mm_fmadd_ps(_mm_set1_ps(m[0][row]), worldX,
+		                    _mm_fmadd_ps(_mm_set1_ps(m[1][row]), worldY,
+		                                 _mm_fmadd_ps(_mm_set1_ps(m[2][row]), worldZ, _mm_set1_ps(m[3][row]))));
+	};
+
+	const __m128 clipX = transform(0);
+	const __m128 clipY = transform(1);
+	const __m128 clipZ = transform(2);
+	const __m128 clipW = transform(3);
+
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 invW = _mm_div_ps(_mm_set1_ps(1.0f), clipW);
+	const __m128 ndcX = _mm_mul_ps(clipX, invW);
+	const __m128 ndcY = _mm_mul_ps(clipY, invW);
+	const __m128 ndcZ = _mm_mul_ps(clipZ, invW);
+
+	// same window depth as the light pass, biased towards the light
+	const bool reverseZ = mDepth.isReverseZ();
+	const __m128 windowZ = reverseZ ? ndcZ : _mm_fmadd_ps(ndcZ, half, half);
+	const __m128 depth = reverseZ
+		                     ? _mm_add_ps(windowZ, _mm_set1_ps(mBias))
+		                     : _mm_sub_ps(windowZ, _mm_set1_ps(mBias));
+
+	const __m128 width = _mm_set1_ps(static_cast<float>(mDepth.getWidth()));
+	const __m128 height = _mm_set1_ps(static_cast<float>(mDepth.getHeight()));
+	const __m128 texX = _mm_mul_ps(_mm_fmadd_ps(ndcX, half, half), width);
+	const __m128 texY = _mm_mul_ps(_mm_fnmadd_ps(ndcY, half, half), height);
+
+	// points behind the light or off the map are lit; the negated compare also catches NaN
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 outside = _mm_or_ps(
+		_mm_or_ps(_mm_cmple_ps(clipW, zero), _mm_or_ps(_mm_cmplt_ps(texX, zero), _mm_cmplt_ps(texY, zero))),
+		_mm_or_ps(_mm_cmpnlt_ps(texX, width), _mm_cmpnlt_ps(texY, height)));
+
+	const __m128i maxX = _mm_set1_epi32(mDepth.getWidth() - 1);
+	const __m128i maxY = _mm_set1_epi32(mDepth.getHeight() - 1);
+	const __m128i zeroI = _mm_setzero_si128();
+	auto clampX = [&](const __m128i x) { return _mm_min_epi32(_mm_max_epi32(x, zeroI), maxX); };
+	auto clampY = [&](const __m128i y) { return _mm_min_epi32(_mm_max_epi32(y, zeroI), maxY); };
+
+	__m128 visibility;
+	if (!mPcf)
+	{
+		const __m128i x = clampX(_mm_cvttps_epi32(_mm_floor_ps(texX)));
+		const __m128i y = clampY(_mm_cvttps_epi32(_mm_floor_ps(texY)));
+		visibility = compare(x, y, depth);
+	}
+	else
+	{
+		// four nearest texel centres, weighted like a bilinear fetch
+		const __m128 fx = _mm_sub_ps(texX, half);
+		const __m128 fy = _mm_sub_ps(texY, half);
+		const __m128 floorX = _mm_floor_ps(fx);
+		const __m128 floorY = _mm_floor_ps(fy);
+		const __m128 weightX = _mm_sub_ps(fx, floorX);
+		const __m128 weightY = _mm_sub_ps(fy, floorY);
+
+		const __m128i x0I = _mm_cvttps_epi32(floorX);
+		const __m128i y0I = _mm_cvttps_epi32(floorY);
+		const __m128i x0 = clampX(x0I);
+		const __m128i y0 = clampY(y0I);
+		const __m128i x1 = clampX(_mm_add_epi32(x0I, _mm_set1_epi32(1)));
+		const __m128i y1 = clampY(_mm_add_epi32(y0I, _mm_set1_epi32(1)));
+
+		const __m128 lit00 = compare(x0, y0, depth);
+		const __m128 lit10 = compare(x1, y0, depth);
+		const __m128 lit01 = compare(x0, y1, depth);
+		const __m128 lit11 = compare(x1, y1, depth);
+
+		const __m128 top = _mm_fmadd_ps(_mm_sub_ps(lit10, lit00), weightX, lit00);
+		const __m128 bottom = _mm_fmadd_ps(_mm_sub_ps(lit11, lit01), weightX, lit01);
+		visibility = _mm_fmadd_ps(_mm_sub_ps(bottom, top), weightY, top);
+	}
+
+	return _mm_blendv_ps(visibility, _mm_set1_ps(1.0f), outside);
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <immintrin.h>
+#include <glm/glm.hpp>
+#include "Framebuffer.h"
+
+// depth rendered from a light by Renderer::renderShadowMap, looked up while shading that light
+class ShadowMap
+{
+public:
+	explicit ShadowMap(int size, DepthFormat depthFormat = DepthFormat::Float32);
+
+	Framebuffer& getDepthBuffer() { return mDepth; }
+	const Framebuffer& getDepthBuffer() const { return mDepth; }
+
+	// world to light clip space, set when the map is rendered
+	void setViewProjection(const glm::mat4& viewProjection) { mViewProjection = viewProjection; }
+	const glm::mat4& getViewProjection() const { return mViewProjection; }
+
+	// window-space depth offset against self-shadowing
+	void setBias(const float bias) { mBias = bias; }
+	float getBias() const { return mBias; }
+
+	// 2x2 percentage-closer filtering with bilinear weights instead of a single comparison
+	void setPcf(const bool pcf) { mPcf = pcf; }
+	bool isPcfEnabled() const { return mPcf; }
+
+	// lit fraction of four world-space points, 1 outside the map
+	__m128 sample(__m128 worldX, __m128 worldY, __m128 worldZ) const;
+
+private:
+	Framebuffer mDepth;
+	glm::mat4 mViewProjection = glm::mat4(1.0f);
+	float mBias = 0.002f;
+	bool mPcf = true;
+
+	// 1 where the stored depth does not occlude the given depth
+	__m128 compare(__m128i x, __m128i y, __m128 depth) const;
+};
@@ -3,33 +3,51 @@
 #include "stb_image.h"
 #include <iostream>
 #include <filesystem>
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <atomic>
+#include <cctype>
 
-Texture::Texture(const std::string& path) : mWidth(0), mHeight(0), mData(nullptr), mIsLoaded(false)
+// 0 never names a texture, so empty cache entries cannot match
+static std::atomic<uint64_t> sNextTextureId{1};
+
+// direct mapped, large enough for the blocks a 16x16 tile touches in one texture
+struct DecodedBlock
 {
-	if (!path.empty())
-	{
-		load(path);
-	}
-}
+	uint64_t textureId = 0;
+	size_t offset = 0;
+	alignas(64) uint32_t texels[16];
+};
 
-Texture::~Texture()
+struct BlockCache
 {
-	if (mData)
+	static constexpr size_t ENTRY_COUNT = 256;
+
+	DecodedBlock entries[ENTRY_COUNT];
+	BlockCacheStats stats;
+};
+
+static thread_local BlockCache tBlockCache;
+
+Texture::Texture(const std::string& path) : mWidth(0), mHeight(0), mIsLoaded(false)
+{
+	if (!path.empty())
 	{
-		stbi_image_free(mData);
-		mData = nullptr;
+		load(path);
 	}
 }
 
 bool Texture::load(const std::string& path)
 {
 	// free existing data if any
-	if (mData)
-	{
-		stbi_image_free(mData);
-		mData = nullptr;
-	}
+	mTexels.clear();
+	mBlocks.clear();
+	mLevels.clear();
+	mFormat = TextureFormat::RGBA8;
+	mWidth = 0;
+	mHeight = 0;
+	mIsLoaded = false;
 
 	// path must be specified by caller
 	if (path.empty())
@@ -38,85 +56,703 @@ bool Texture::load(const std::string& path)
 	if (!std::filesystem::exists(path))
 	{
 		std::cerr << "Texture file does not exist: " << path << '\n';
-		mIsLoaded = false;
 		return false;
 	}
 
-	// load image using stb_image (forces RGB format)
+	// block compressed containers keep their blocks as they are
+	std::string extension = std::filesystem::path(path).extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(),
+	               [](const unsigned char c) { return static_cast<char>(std::tolower(c)); });
+	if (extension == ".dds" || extension == ".ktx2")
+		return loadCompressed(path, extension == ".ktx2");
+
+	// load image using stb_image (forces RGBA format, opaque when the file has no alpha)
 	int width, height, channels;
-	mData = stbi_load(path.c_str(), &width, &height, &channels, STBI_rgb);
-	if (!mData)
+	stbi_uc* data = stbi_load(path.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+	if (!data)
 	{
 		std::cerr << "Failed to load texture: " << path << " - " << stbi_failure_reason() << '\n';
-		mIsLoaded = false;
 		return false;
 	}
 
 	if (width <= 0 || height <= 0)
 	{
-		stbi_image_free(mData);
-		mData = nullptr;
+		stbi_image_free(data);
 		throw std::runtime_error(
 			"Invalid texture dimensions: " + std::to_string(width) + "x" + std::to_string(height) + " for: " + path);
 	}
 
+	create(width, height, data, 4);
+	stbi_image_free(data);
+	return true;
+}
+
+void Texture::create(const int width, const int height, const uint8_t* pixels, const int channels)
+{
+	if (width <= 0 || height <= 0)
+		throw std::invalid_argument(
+			"Invalid texture dimensions: " + std::to_string(width) + "x" + std::to_string(height));
+
+	if (!pixels)
+		throw std::invalid_argument("Texture pixels cannot be null");
+
+	if (channels != 3 && channels != 4)
+		throw std::invalid_argument("Textures are created from RGB or RGBA pixels");
+
+	mBlocks.clear();
+	mFormat = TextureFormat::RGBA8;
 	mWidth = width;
 	mHeight = height;
+	buildMipChain(pixels, channels);
+	mId = sNextTextureId.fetch_add(1);
+	mIsLoaded = true;
+}
+
+bool Texture::loadCompressed(const std::string& path, const bool ktx2)
+{
+	CompressedImage image;
+	if (!(ktx2 ? loadKTX2(path, image) : loadDDS(path, image)))
+		return false;
+
+	mFormat = image.format == BlockFormat::BC1 ? TextureFormat::BC1 : TextureFormat::BC3;
+	mWidth = image.width;
+	mHeight = image.height;
+
+	// blocks already follow the 4x4 tiled order, only the level table is needed
+	mLevels.clear();
+	for (size_t level = 0; level < image.levelOffsets.size(); ++level)
+	{
+		const int levelWidth = std::max(1, mWidth >> level);
+		const int levelHeight = std::max(1, mHeight >> level);
+		mLevels.push_back({levelWidth, levelHeight, (levelWidth + BLOCK_SIZE - 1) >> BLOCK_SHIFT,
+		                   image.levelOffsets[level]});
+	}
+	mBlocks = std::move(image.data);
+
+	mId = sNextTextureId.fetch_add(1);
 	mIsLoaded = true;
 	return true;
 }
 
-__m128i Texture::sample(__m128 u, __m128 v) const
+// source texels and integer weights of one axis of the box filter. Even sizes average pairs, odd
+// sizes spread each destination texel over three source texels so the last one is not dropped
+struct BoxFilterTaps
 {
-	// fallback color if texture not loaded
-	if (!mIsLoaded || !mData)
+	int index[3];
+	uint32_t weight[3];
+	int count;
+	uint32_t total;
+};
+
+static BoxFilterTaps boxFilterTaps(const int x, const int sourceSize, const int size)
+{
+	if (sourceSize == 1)
+		return {{0, 0, 0}, {1, 0, 0}, 1, 1};
+	if (sourceSize % 2 == 0)
+		return {{x * 2, x * 2 + 1, 0}, {1, 1, 0}, 2, 2};
+
+	// sourceSize = 2 * size + 1, destination texel x covers [x, x + 1) * sourceSize / size
+	const uint32_t n = static_cast<uint32_t>(size);
+	const uint32_t i = static_cast<uint32_t>(x);
+	return {{x * 2, x * 2 + 1, x * 2 + 2}, {n - i, n, i + 1}, 3, 2 * n + 1};
+}
+
+// per channel weighted average of up to 3x3 RGBA8 texels
+static uint32_t filterTexels(const uint32_t* linear, const int width, const BoxFilterTaps& tapsX,
+                             const BoxFilterTaps& tapsY)
+{
+	uint64_t sums[4] = {};
+	for (int ty = 0; ty < tapsY.count; ++ty)
 	{
-		return _mm_set1_epi32(0x00FFFF);
+		const uint32_t* row = linear + static_cast<size_t>(tapsY.index[ty]) * width;
+		for (int tx = 0; tx < tapsX.count; ++tx)
+		{
+			const uint64_t weight = static_cast<uint64_t>(tapsX.weight[tx]) * tapsY.weight[ty];
+			const uint32_t texel = row[tapsX.index[tx]];
+			for (int channel = 0; channel < 4; ++channel)
+				sums[channel] += ((texel >> channel * 8) & 0xFF) * weight;
+		}
 	}
 
-	assert(mWidth > 0 && mHeight > 0 && "Texture dimensions should be positive after successful load");
+	const uint64_t total = static_cast<uint64_t>(tapsX.total) * tapsY.total;
+	uint32_t result = 0;
+	for (int channel = 0; channel < 4; ++channel)
+		result |= static_cast<uint32_t>((sums[channel] + total / 2) / total) << channel * 8;
+	return result;
+}
+
+void Texture::buildMipChain(const uint8_t* pixels, const int channels)
+{
+	// level sizes and offsets first so the storage is allocated once
+	mLevels.clear();
+	size_t totalTexels = 0;
+	int levelWidth = mWidth;
+	int levelHeight = mHeight;
+	while (true)
+	{
+		const int blocksPerRow = (levelWidth + BLOCK_SIZE - 1) >> BLOCK_SHIFT;
+		const int blockRows = (levelHeight + BLOCK_SIZE - 1) >> BLOCK_SHIFT;
+		mLevels.push_back({levelWidth, levelHeight, blocksPerRow, totalTexels});
+		totalTexels += static_cast<size_t>(blocksPerRow) * blockRows * BLOCK_TEXELS;
+		if (levelWidth == 1 && levelHeight == 1) break;
+		levelWidth = std::max(1, levelWidth / 2);
+		levelHeight = std::max(1, levelHeight / 2);
+	}
+	mTexels.assign(totalTexels, 0);
+
+	// expand to RGBA8, opaque for RGB, rows stay linear until each level is tiled
+	std::vector<uint32_t> linear(static_cast<size_t>(mWidth) * mHeight);
+	for (size_t i = 0; i < linear.size(); ++i)
+	{
+		const uint8_t* texel = pixels + i * channels;
+		const uint32_t alpha = channels == 4 ? texel[3] : 0xFFu;
+		linear[i] = texel[0] | texel[1] << 8 | texel[2] << 16 | alpha << 24;
+	}
+
+	std::vector<uint32_t> next;
+	for (size_t level = 0; level < mLevels.size(); ++level)
+	{
+		const MipLevel& mip = mLevels[level];
+		for (int y = 0; y < mip.height; ++y)
+			for (int x = 0; x < mip.width; ++x)
+				mTexels[tiledIndex(mip, x, y)] = linear[static_cast<size_t>(y) * mip.width + x];
 
-	__m128 zero = _mm_setzero_ps();
-	__m128 one = _mm_set1_ps(1.0f);
+		if (level + 1 == mLevels.size()) break;
 
-	// clamp uv  to [0,1]
-	u = _mm_max_ps(zero, _mm_min_ps(u, one));
-	v = _mm_max_ps(zero, _mm_min_ps(v, one));
+		// box filter into the next level, weighted over three texels along odd axes
+		const MipLevel& dst = mLevels[level + 1];
+		next.resize(static_cast<size_t>(dst.width) * dst.height);
+		for (int y = 0; y < dst.height; ++y)
+		{
+			const BoxFilterTaps tapsY = boxFilterTaps(y, mip.height, dst.height);
+			for (int x = 0; x < dst.width; ++x)
+				next[static_cast<size_t>(y) * dst.width + x] =
+					filterTexels(linear.data(), mip.width, boxFilterTaps(x, mip.width, dst.width), tapsY);
+		}
+		linear.swap(next);
+	}
+}
 
-	// convert from uv space to pixel space 
-	__m128 wMinus1 = _mm_set1_ps(static_cast<float>(mWidth - 1));
-	__m128 hMinus1 = _mm_set1_ps(static_cast<float>(mHeight - 1));
-	__m128 uScaled = _mm_mul_ps(u, wMinus1);
-	__m128 vScaled = _mm_mul_ps(v, hMinus1);
+uint32_t Texture::getTexel(const int level, const int x, const int y) const
+{
+	assert(mIsLoaded && level >= 0 && level < getMipLevelCount() && "Mip level out of range");
+	const MipLevel& mip = mLevels[level];
+	assert(x >= 0 && x < mip.width && y >= 0 && y < mip.height && "Texel coordinates out of bounds");
+
+	if (isCompressed())
+	{
+		const size_t index = tiledIndex(mip, x, y) - mip.offset;
+		return decodeBlock(mip, index / BLOCK_TEXELS)[index % BLOCK_TEXELS];
+	}
+	return mTexels[tiledIndex(mip, x, y)];
+}
+
+BlockCacheStats Texture::getBlockCacheStats()
+{
+	return tBlockCache.stats;
+}
+
+void Texture::resetBlockCache()
+{
+	for (DecodedBlock& entry : tBlockCache.entries)
+		entry.textureId = 0;
+	tBlockCache.stats = {};
+}
 
-	// convert float coords to int pixel indices 
-	__m128i xi = _mm_cvttps_epi32(uScaled);
-	__m128i yi = _mm_cvttps_epi32(vScaled);
+const uint32_t* Texture::decodeBlock(const MipLevel& mip, const size_t block) const
+{
+	const size_t blockBytes = getBlockBytes(mFormat == TextureFormat::BC1 ? BlockFormat::BC1 : BlockFormat::BC3);
+	const size_t offset = mip.offset + block * blockBytes;
+	assert(offset + blockBytes <= mBlocks.size() && "Compressed block out of bounds");
 
-	// calculate pixel indices (y * width + x)
-	__m128i widthVec = _mm_set1_epi32(mWidth);
-	__m128i yMulW = _mm_mullo_epi32(yi, widthVec);
-	__m128i idx = _mm_add_epi32(yMulW, xi);
+	// neighbouring blocks land in neighbouring entries, the id spreads textures apart
+	const size_t slot = (offset / blockBytes + mId * 0x9E3779B1u) & (BlockCache::ENTRY_COUNT - 1);
+	DecodedBlock& entry = tBlockCache.entries[slot];
+	if (entry.textureId == mId && entry.offset == offset)
+	{
+		++tBlockCache.stats.hits;
+		return entry.texels;
+	}
 
-	// multiply by 3 for RGB pixel data
-	__m128i idx2 = _mm_mullo_epi32(idx, _mm_set1_epi32(3));
+	++tBlockCache.stats.misses;
+	if (mFormat == TextureFormat::BC1)
+		decodeBC1Block(mBlocks.data() + offset, entry.texels);
+	else
+		decodeBC3Block(mBlocks.data() + offset, entry.texels);
+	entry.textureId = mId;
+	entry.offset = offset;
+	return entry.texels;
+}
 
-	alignas(16) int indices[4];
-	_mm_store_si128(reinterpret_cast<__m128i*>(indices), idx2);
+__m128i Texture::fetchCompressed(const MipLevel& mip, const __m128i indices) const
+{
+	alignas(16) int lanes[4];
+	_mm_store_si128(reinterpret_cast<__m128i*>(lanes), indices);
+
+	// quads usually stay in one block, so only look it up again when it changes
+	alignas(16) uint32_t colors[4];
+	int currentBlock = -1;
+	const uint32_t* decoded = nullptr;
+	for (int i = 0; i < 4; ++i)
+	{
+		const int block = lanes[i] / BLOCK_TEXELS;
+		if (block != currentBlock)
+		{
+			decoded = decodeBlock(mip, block);
+			currentBlock = block;
+		}
+		colors[i] = decoded[lanes[i] % BLOCK_TEXELS];
+	}
+
+	return _mm_load_si128(reinterpret_cast<const __m128i*>(colors));
+}
+
+float Texture::computeLod(const __m128 dudx, const __m128 dvdx, const __m128 dudy, const __m128 dvdy,
+                          const int mask) const
+{
+	if (!mIsLoaded || mask == 0) return 0.0f;
+
+	// footprint in texels along screen x and y
+	const __m128 width = _mm_set1_ps(static_cast<float>(mWidth));
+	const __m128 height = _mm_set1_ps(static_cast<float>(mHeight));
+	const __m128 texelDxU = _mm_mul_ps(dudx, width);
+	const __m128 texelDxV = _mm_mul_ps(dvdx, height);
+	const __m128 texelDyU = _mm_mul_ps(dudy, width);
+	const __m128 texelDyV = _mm_mul_ps(dvdy, height);
+
+	const __m128 lengthX = _mm_fmadd_ps(texelDxU, texelDxU, _mm_mul_ps(texelDxV, texelDxV));
+	const __m128 lengthY = _mm_fmadd_ps(texelDyU, texelDyU, _mm_mul_ps(texelDyV, texelDyV));
+
+	alignas(16) float footprint[4];
+	_mm_store_ps(footprint, _mm_max_ps(lengthX, lengthY));
+
+	float maxFootprint = 0.0f;
+	for (int i = 0; i < 4; ++i)
+		if (mask & (1 << i))
+			maxFootprint = std::max(maxFootprint, footprint[i]);
+
+	// squared footprint, so halve the log
+	if (!(maxFootprint > 1.0f)) return 0.0f;
+	return 0.5f * std::log2(maxFootprint);
+}
+
+// per lane a + (b - a) * weight / 256 on packed 8-bit channels, weight in [0,256]
+static __m128i lerpColors(const __m128i a, const __m128i b, const __m128i weights)
+{
+	const __m128i zero = _mm_setzero_si128();
+
+	// spread each lane's weight over its four 16-bit channels
+	const __m128i weights16 = _mm_or_si128(weights, _mm_slli_epi32(weights, 16));
+	const __m128i weightsLo = _mm_unpacklo_epi32(weights16, weights16);
+	const __m128i weightsHi = _mm_unpackhi_epi32(weights16, weights16);
+	const __m128i full = _mm_set1_epi16(256);
+	const __m128i round = _mm_set1_epi16(128);
+
+	// a * (256 - w) + b * w never exceeds 16 bits unsigned
+	__m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), _mm_sub_epi16(full, weightsLo)),
+	                           _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), weightsLo));
+	__m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), _mm_sub_epi16(full, weightsHi)),
+	                           _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), weightsHi));
+	lo = _mm_srli_epi16(_mm_add_epi16(lo, round), 8);
+	hi = _mm_srli_epi16(_mm_add_epi16(hi, round), 8);
+
+	return _mm_packus_epi16(lo, hi);
+}
+
+int Texture::getNearestLevel(const float lod) const
+{
+	return std::clamp(static_cast<int>(lod + 0.5f), 0, getMipLevelCount() - 1);
+}
+
+// one load per lane
+static __m128i fetchScalar(const uint32_t* texels, const __m128i indices)
+{
+	alignas(16) int lanes[4];
+	_mm_store_si128(reinterpret_cast<__m128i*>(lanes), indices);
 
-	// load and pack RGB 
 	alignas(16) uint32_t colors[4];
 	for (int i = 0; i < 4; i++)
+		colors[i] = texels[lanes[i]];
+
+	return _mm_load_si128(reinterpret_cast<const __m128i*>(colors));
+}
+
+#ifdef __AVX2__
+static __m128i fetchGather(const uint32_t* texels, const __m128i indices)
+{
+	return _mm_i32gather_epi32(reinterpret_cast<const int*>(texels), indices, 4);
+}
+#endif
+
+// when all lanes share a 4x4 block the block is loaded whole and permuted in registers
+static __m128i fetchPermute(const uint32_t* texels, const __m128i indices)
+{
+	const __m128i block = _mm_srli_epi32(indices, 4);
+	if (_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(block, _mm_shuffle_epi32(block, 0)))) != 0xF)
+		return fetchScalar(texels, indices);
+
+	const uint32_t* blockTexels = texels + (_mm_cvtsi128_si32(indices) & ~15);
+	const __m128i inner = _mm_and_si128(indices, _mm_set1_epi32(15));
+
+#ifdef __AVX2__
+	const __m256i low = _mm256_load_si256(reinterpret_cast<const __m256i*>(blockTexels));
+	const __m256i high = _mm256_load_si256(reinterpret_cast<const __m256i*>(blockTexels + 8));
+	const __m256i lanes = _mm256_castsi128_si256(inner);
+	const __m256i fromLow = _mm256_permutevar8x32_epi32(low, lanes);
+	const __m256i fromHigh = _mm256_permutevar8x32_epi32(high, lanes);
+	const __m256i useHigh = _mm256_castsi128_si256(_mm_slli_epi32(inner, 28));
+	return _mm256_castsi256_si128(_mm256_castps_si256(
+		_mm256_blendv_ps(_mm256_castsi256_ps(fromLow), _mm256_castsi256_ps(fromHigh), _mm256_castsi256_ps(useHigh))));
+#else
+	// byte shuffle picks the texel within each block row, the row is selected afterwards
+	const __m128i column = _mm_and_si128(inner, _mm_set1_epi32(3));
+	const __m128i control = _mm_add_epi32(_mm_mullo_epi32(column, _mm_set1_epi32(0x04040404)),
+	                                      _mm_set1_epi32(0x03020100));
+	const __m128i row = _mm_srli_epi32(inner, 2);
+
+	__m128i result = _mm_setzero_si128();
+	for (int r = 0; r < 4; ++r)
+	{
+		const __m128i rowTexels = _mm_load_si128(reinterpret_cast<const __m128i*>(blockTexels + r * 4));
+		const __m128i select = _mm_cmpeq_epi32(row, _mm_set1_epi32(r));
+		result = _mm_blendv_epi8(result, _mm_shuffle_epi8(rowTexels, control), select);
+	}
+	return result;
+#endif
+}
+
+// the tiled index is a column part plus a row part, so a footprint combines them instead of
+// recomputing the index per texel
+__m128i Texture::columnOffsets(const __m128i x)
+{
+	return _mm_add_epi32(_mm_slli_epi32(_mm_srli_epi32(x, BLOCK_SHIFT), 2 * BLOCK_SHIFT),
+	                     _mm_and_si128(x, _mm_set1_epi32(BLOCK_SIZE - 1)));
+}
+
+__m128i Texture::rowOffsets(const MipLevel& mip, const __m128i y)
+{
+	const __m128i blockRow = _mm_mullo_epi32(_mm_srli_epi32(y, BLOCK_SHIFT),
+	                                         _mm_set1_epi32(mip.blocksPerRow * BLOCK_TEXELS));
+	return _mm_add_epi32(blockRow, _mm_slli_epi32(_mm_and_si128(y, _mm_set1_epi32(BLOCK_SIZE - 1)), BLOCK_SHIFT));
+}
+
+__m128i Texture::texelIndices(const MipLevel& mip, const __m128i x, const __m128i y)
+{
+	return _mm_add_epi32(rowOffsets(mip, y), columnOffsets(x));
+}
+
+__m128i Texture::fetchTexels(const MipLevel& mip, const __m128i x, const __m128i y) const
+{
+	const __m128i indices = texelIndices(mip, x, y);
+	if (isCompressed()) return fetchCompressed(mip, indices);
+	const uint32_t* texels = mTexels.data() + mip.offset;
+
+#ifndef NDEBUG
+	alignas(16) int lanes[4];
+	_mm_store_si128(reinterpret_cast<__m128i*>(lanes), indices);
+	for (const int index : lanes)
+		assert(index >= 0 && mip.offset + index < mTexels.size() && "Texture index out of bounds");
+#endif
+
+#ifdef __AVX2__
+	return fetchGather(texels, indices);
+#else
+	return fetchScalar(texels, indices);
+#endif
+}
+
+__m128i Texture::fetch(const int level, const __m128i x, const __m128i y, const TexelFetch method) const
+{
+	if (!mIsLoaded) return _mm_set1_epi32(0x00FFFF);
+
+	assert(level >= 0 && level < getMipLevelCount() && "Mip level out of range");
+	const MipLevel& mip = mLevels[level];
+	const __m128i indices = texelIndices(mip, x, y);
+	if (isCompressed()) return fetchCompressed(mip, indices);
+	const uint32_t* texels = mTexels.data() + mip.offset;
+
+	switch (method)
 	{
-		int index = indices[i];
+	case TexelFetch::Gather:
+#ifdef __AVX2__
+		return fetchGather(texels, indices);
+#else
+		return fetchScalar(texels, indices);
+#endif
 
-		assert(index >= 0 && index + 2 < mWidth * mHeight * 3 && "Texture index out of bounds");
+	case TexelFetch::Permute:
+		return fetchPermute(texels, indices);
 
-		uint8_t r = mData[index];
-		uint8_t g = mData[index + 1];
-		uint8_t b = mData[index + 2];
-		colors[i] = (b << 16) | (g << 8) | r;
+	case TexelFetch::Scalar:
+	default:
+		return fetchScalar(texels, indices);
 	}
+}
 
-	return _mm_load_si128(reinterpret_cast<const __m128i*>(colors));
+// c mod size for any size, rounding in the float quotient is corrected afterwards
+static __m128i moduloCoordinate(const __m128i c, const int size)
+{
+	const __m128i sizeVec = _mm_set1_epi32(size);
+	const __m128 quotient = _mm_floor_ps(_mm_mul_ps(_mm_cvtepi32_ps(c), _mm_set1_ps(1.0f / static_cast<float>(size))));
+	__m128i remainder = _mm_sub_epi32(c, _mm_mullo_epi32(_mm_cvtps_epi32(quotient), sizeVec));
+
+	remainder = _mm_sub_epi32(remainder, _mm_and_si128(_mm_cmpgt_epi32(remainder, _mm_set1_epi32(size - 1)), sizeVec));
+	remainder = _mm_add_epi32(remainder, _mm_and_si128(_mm_cmplt_epi32(remainder, _mm_setzero_si128()), sizeVec));
+	return remainder;
+}
+
+// maps integer texel coordinates into [0, size), power of two sizes wrap with a mask
+static inline __m128i wrapCoordinate(const __m128i c, const int size, const TextureWrap wrap)
+{
+	const bool powerOfTwo = (size & (size - 1)) == 0;
+
+	switch (wrap)
+	{
+	case TextureWrap::Repeat:
+		return powerOfTwo ? _mm_and_si128(c, _mm_set1_epi32(size - 1)) : moduloCoordinate(c, size);
+
+	case TextureWrap::MirroredRepeat:
+		{
+			// two tiles per period, the second one reflected
+			const int period = size * 2;
+			const __m128i t = powerOfTwo ? _mm_and_si128(c, _mm_set1_epi32(period - 1)) : moduloCoordinate(c, period);
+			return _mm_min_epi32(t, _mm_sub_epi32(_mm_set1_epi32(period - 1), t));
+		}
+
+	case TextureWrap::ClampToEdge:
+	default:
+		return _mm_max_epi32(_mm_setzero_si128(), _mm_min_epi32(c, _mm_set1_epi32(size - 1)));
+	}
+}
+
+// texel space coordinate, limited so the integer conversion cannot overflow. Repeating modes drop whole
+// periods first, so heavily tiled UVs keep their fraction instead of clamping once scaled
+static __m128 toTexelSpace(__m128 coordinate, const int size, const float offset, const TextureWrap wrap)
+{
+	if (wrap == TextureWrap::Repeat)
+	{
+		coordinate = _mm_sub_ps(coordinate, _mm_floor_ps(coordinate));
+	}
+	else if (wrap == TextureWrap::MirroredRepeat)
+	{
+		// the mirrored period spans two tiles
+		const __m128 periods = _mm_floor_ps(_mm_mul_ps(coordinate, _mm_set1_ps(0.5f)));
+		coordinate = _mm_fnmadd_ps(periods, _mm_set1_ps(2.0f), coordinate);
+	}
+
+	const __m128 limit = _mm_set1_ps(8388608.0f);
+	const __m128 scaled = _mm_fmsub_ps(coordinate, _mm_set1_ps(static_cast<float>(size)), _mm_set1_ps(offset));
+	return _mm_max_ps(_mm_min_ps(scaled, limit), _mm_sub_ps(_mm_setzero_ps(), limit));
+}
+
+__m128i Texture::sampleNearest(const MipLevel& mip, const __m128 u, const __m128 v, const TextureWrap wrapU,
+                               const TextureWrap wrapV) const
+{
+	// texel containing the sample
+	const __m128i x = _mm_cvtps_epi32(_mm_floor_ps(toTexelSpace(u, mip.width, 0.0f, wrapU)));
+	const __m128i y = _mm_cvtps_epi32(_mm_floor_ps(toTexelSpace(v, mip.height, 0.0f, wrapV)));
+
+	return fetchTexels(mip, wrapCoordinate(x, mip.width, wrapU), wrapCoordinate(y, mip.height, wrapV));
+}
+
+// wraps both columns (or rows) of a bilinear footprint, c and c + 1, reducing the position only once
+static inline void wrapFootprint(const __m128i c, const int size, const TextureWrap wrap, __m128i& c0, __m128i& c1)
+{
+	const __m128i one = _mm_set1_epi32(1);
+	const bool powerOfTwo = (size & (size - 1)) == 0;
+
+	switch (wrap)
+	{
+	case TextureWrap::Repeat:
+		{
+			// the column after the last one is the first
+			const __m128i sizeVec = _mm_set1_epi32(size);
+			c0 = powerOfTwo ? _mm_and_si128(c, _mm_set1_epi32(size - 1)) : moduloCoordinate(c, size);
+			const __m128i next = _mm_add_epi32(c0, one);
+			c1 = _mm_andnot_si128(_mm_cmpeq_epi32(next, sizeVec), next);
+			return;
+		}
+
+	case TextureWrap::MirroredRepeat:
+		{
+			// both positions within the mirrored period, then reflected like wrapCoordinate
+			const int period = size * 2;
+			const __m128i last = _mm_set1_epi32(period - 1);
+			const __m128i t = powerOfTwo ? _mm_and_si128(c, last) : moduloCoordinate(c, period);
+			__m128i next = _mm_add_epi32(t, one);
+			next = _mm_andnot_si128(_mm_cmpeq_epi32(next, _mm_set1_epi32(period)), next);
+			c0 = _mm_min_epi32(t, _mm_sub_epi32(last, t));
+			c1 = _mm_min_epi32(next, _mm_sub_epi32(last, next));
+			return;
+		}
+
+	case TextureWrap::ClampToEdge:
+	default:
+		{
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i maximum = _mm_set1_epi32(size - 1);
+			c0 = _mm_max_epi32(zero, _mm_min_epi32(c, maximum));
+			c1 = _mm_max_epi32(zero, _mm_min_epi32(_mm_add_epi32(c, one), maximum));
+		}
+	}
+}
+
+// horizontal weight bytes (64 - w, w) for every channel of lanes 0-1 and 2-3
+static void expandWeightsX(const __m128i weightX, __m128i& weights01, __m128i& weights23)
+{
+	const __m128i weightBytes = _mm_or_si128(_mm_sub_epi32(_mm_set1_epi32(64), weightX), _mm_slli_epi32(weightX, 8));
+	const __m128i weightPairs = _mm_or_si128(weightBytes, _mm_slli_epi32(weightBytes, 16));
+	weights01 = _mm_unpacklo_epi32(weightPairs, weightPairs);
+	weights23 = _mm_unpackhi_epi32(weightPairs, weightPairs);
+}
+
+// 16-bit vertical weight for every channel of lanes 0-1 and 2-3
+static void expandWeightsY(const __m128i weightY, __m128i& weights01, __m128i& weights23)
+{
+	const __m128i weightPairs = _mm_or_si128(weightY, _mm_slli_epi32(weightY, 16));
+	weights01 = _mm_unpacklo_epi32(weightPairs, weightPairs);
+	weights23 = _mm_unpackhi_epi32(weightPairs, weightPairs);
+}
+
+// blends the texels of two lanes horizontally, weights hold (64 - w) | w << 8 per 16-bit slot
+static __m128i blendPairs(const __m128i left, const __m128i right, const __m128i weights)
+{
+	// interleaved bytes make each 16-bit slot one channel of the pair
+	const __m128i blended = _mm_maddubs_epi16(_mm_unpacklo_epi8(left, right), weights);
+	return _mm_srli_epi16(_mm_add_epi16(blended, _mm_set1_epi16(32)), 6);
+}
+
+// bilinear blend of the four footprint texels of each lane with 6-bit weights
+static __m128i blendFootprint(const __m128i topLeft, const __m128i topRight, const __m128i bottomLeft,
+                              const __m128i bottomRight, const __m128i weightX, const __m128i weightY)
+{
+	__m128i weightsX01, weightsX23, weightsY01, weightsY23;
+	expandWeightsX(weightX, weightsX01, weightsX23);
+	expandWeightsY(weightY, weightsY01, weightsY23);
+
+	const __m128i top01 = blendPairs(topLeft, topRight, weightsX01);
+	const __m128i top23 = blendPairs(_mm_unpackhi_epi64(topLeft, topLeft), _mm_unpackhi_epi64(topRight, topRight),
+	                                 weightsX23);
+	const __m128i bottom01 = blendPairs(bottomLeft, bottomRight, weightsX01);
+	const __m128i bottom23 = blendPairs(_mm_unpackhi_epi64(bottomLeft, bottomLeft),
+	                                    _mm_unpackhi_epi64(bottomRight, bottomRight), weightsX23);
+
+	// vertical blend in 16-bit, 255 * 64 still fits
+	const __m128i full = _mm_set1_epi16(64);
+	const __m128i round = _mm_set1_epi16(32);
+	__m128i lanes01 = _mm_add_epi16(_mm_mullo_epi16(top01, _mm_sub_epi16(full, weightsY01)),
+	                                _mm_mullo_epi16(bottom01, weightsY01));
+	__m128i lanes23 = _mm_add_epi16(_mm_mullo_epi16(top23, _mm_sub_epi16(full, weightsY23)),
+	                                _mm_mullo_epi16(bottom23, weightsY23));
+	lanes01 = _mm_srli_epi16(_mm_add_epi16(lanes01, round), 6);
+	lanes23 = _mm_srli_epi16(_mm_add_epi16(lanes23, round), 6);
+
+	return _mm_packus_epi16(lanes01, lanes23);
+}
+
+__m128i Texture::sampleBilinearCompressed(const MipLevel& mip, const __m128i row0, const __m128i row1,
+                                          const __m128i column0, const __m128i column1, const __m128i weightX,
+                                          const __m128i weightY) const
+{
+	return blendFootprint(fetchCompressed(mip, _mm_add_epi32(row0, column0)),
+	                      fetchCompressed(mip, _mm_add_epi32(row0, column1)),
+	                      fetchCompressed(mip, _mm_add_epi32(row1, column0)),
+	                      fetchCompressed(mip, _mm_add_epi32(row1, column1)), weightX, weightY);
+}
+
+__m128i Texture::sampleBilinear(const MipLevel& mip, const __m128 u, const __m128 v, const TextureWrap wrapU,
+                                const TextureWrap wrapV) const
+{
+	// texel space with 6 fractional bits, texel centres sit at half integers. Rounding once splits
+	// into the footprint's first texel and a 6-bit weight
+	const __m128i x = _mm_cvtps_epi32(toTexelSpace(u, mip.width * 64, 32.0f, wrapU));
+	const __m128i y = _mm_cvtps_epi32(toTexelSpace(v, mip.height * 64, 32.0f, wrapV));
+	const __m128i fraction = _mm_set1_epi32(63);
+	const __m128i weightX = _mm_and_si128(x, fraction);
+	const __m128i weightY = _mm_and_si128(y, fraction);
+
+	// both footprint columns and rows go through the addressing mode once, then the tiled index
+	// splits into column and row offsets; inside a block the second ones are just +1 and +4
+	__m128i x0, x1, y0, y1;
+	wrapFootprint(_mm_srai_epi32(x, 6), mip.width, wrapU, x0, x1);
+	wrapFootprint(_mm_srai_epi32(y, 6), mip.height, wrapV, y0, y1);
+	const __m128i column0 = columnOffsets(x0);
+	const __m128i column1 = columnOffsets(x1);
+	const __m128i row0 = rowOffsets(mip, y0);
+	const __m128i row1 = rowOffsets(mip, y1);
+
+	if (isCompressed())
+		return sampleBilinearCompressed(mip, row0, row1, column0, column1, weightX, weightY);
+
+	const uint32_t* texels = mTexels.data() + mip.offset;
+
+#ifdef __AVX2__
+	// left and right columns of both rows in two gathers from one base, top row in the low half
+	const __m256i rows = _mm256_set_m128i(row1, row0);
+	const __m256i left = _mm256_i32gather_epi32(reinterpret_cast<const int*>(texels),
+	                                            _mm256_add_epi32(rows, _mm256_set_m128i(column0, column0)), 4);
+	const __m256i right = _mm256_i32gather_epi32(reinterpret_cast<const int*>(texels),
+	                                             _mm256_add_epi32(rows, _mm256_set_m128i(column1, column1)), 4);
+
+	// both rows blend horizontally at once
+	__m128i weightsX01, weightsX23, weightsY01, weightsY23;
+	expandWeightsX(weightX, weightsX01, weightsX23);
+	expandWeightsY(weightY, weightsY01, weightsY23);
+	const __m256i round = _mm256_set1_epi16(32);
+	const __m256i pairs01 = _mm256_maddubs_epi16(_mm256_unpacklo_epi8(left, right),
+	                                             _mm256_set_m128i(weightsX01, weightsX01));
+	const __m256i pairs23 = _mm256_maddubs_epi16(_mm256_unpackhi_epi8(left, right),
+	                                             _mm256_set_m128i(weightsX23, weightsX23));
+	const __m256i blended01 = _mm256_srli_epi16(_mm256_add_epi16(pairs01, round), 6);
+	const __m256i blended23 = _mm256_srli_epi16(_mm256_add_epi16(pairs23, round), 6);
+
+	// vertical blend in 16-bit, 255 * 64 still fits
+	const __m256i top = _mm256_permute2x128_si256(blended01, blended23, 0x20);
+	const __m256i bottom = _mm256_permute2x128_si256(blended01, blended23, 0x31);
+	const __m256i weightsY = _mm256_set_m128i(weightsY23, weightsY01);
+	const __m256i lanes = _mm256_add_epi16(_mm256_mullo_epi16(top, _mm256_sub_epi16(_mm256_set1_epi16(64), weightsY)),
+	                                       _mm256_mullo_epi16(bottom, weightsY));
+	const __m256i result = _mm256_srli_epi16(_mm256_add_epi16(lanes, round), 6);
+	return _mm_packus_epi16(_mm256_castsi256_si128(result), _mm256_extracti128_si256(result, 1));
+#else
+	return blendFootprint(fetchScalar(texels, _mm_add_epi32(row0, column0)),
+	                      fetchScalar(texels, _mm_add_epi32(row0, column1)),
+	                      fetchScalar(texels, _mm_add_epi32(row1, column0)),
+	                      fetchScalar(texels, _mm_add_epi32(row1, column1)), weightX, weightY);
+#endif
+}
+
+__m128i Texture::sample(const __m128 u, const __m128 v, const float lod, const TextureFilter filter,
+                        const TextureWrap wrapU, const TextureWrap wrapV) const
+{
+	// fallback color if texture not loaded
+	if (!mIsLoaded)
+	{
+		return _mm_set1_epi32(0x00FFFF);
+	}
+
+	assert(mWidth > 0 && mHeight > 0 && "Texture dimensions should be positive after successful load");
+
+	switch (filter)
+	{
+	case TextureFilter::Bilinear:
+		return sampleBilinear(mLevels[getNearestLevel(lod)], u, v, wrapU, wrapV);
+
+	case TextureFilter::Trilinear:
+		{
+			const float clampedLod = std::clamp(lod, 0.0f, static_cast<float>(getMipLevelCount() - 1));
+			const int level = static_cast<int>(clampedLod);
+			const int weight = static_cast<int>((clampedLod - static_cast<float>(level)) * 256.0f + 0.5f);
+
+			const __m128i fine = sampleBilinear(mLevels[level], u, v, wrapU, wrapV);
+			if (weight == 0) return fine;
+
+			const __m128i coarse = sampleBilinear(mLevels[level + 1], u, v, wrapU, wrapV);
+			return lerpColors(fine, coarse, _mm_set1_epi32(weight));
+		}
+
+	case TextureFilter::Nearest:
+	default:
+		return sampleNearest(mLevels[getNearestLevel(lod)], u, v, wrapU, wrapV);
+	}
 }
@@ -1,28 +1,154 @@
 #pragma once
 #include <string>
+#include <vector>
 #include <cstdint>
 #include <immintrin.h>
+#include "AlignedAllocator.h"
+#include "BlockCompression.h"
+
+enum class TextureFilter
+{
+	Nearest,
+	Bilinear, // nearest mip level
+	Trilinear // blends the two closest mip levels
+};
+
+enum class TextureWrap
+{
+	Repeat,
+	MirroredRepeat,
+	ClampToEdge
+};
+
+enum class TexelFetch
+{
+	Scalar,
+	Gather, // AVX2 builds, scalar otherwise
+	Permute // in-register permute when a quad stays inside one 4x4 block
+};
+
+enum class TextureFormat
+{
+	RGBA8, // tiled in 4x4 blocks
+	BC1,
+	BC3
+};
+
+// hits and misses of the calling thread's decoded block cache
+struct BlockCacheStats
+{
+	size_t hits = 0;
+	size_t misses = 0;
+};
 
 class Texture
 {
 public:
 	explicit Texture(const std::string& path);
-	~Texture();
 
 	bool load(const std::string& path);
 
-	__m128i sample(__m128 u, __m128 v) const;
+	// builds the texture from tightly packed RGB (3 channels) or RGBA (4 channels) pixels
+	void create(int width, int height, const uint8_t* pixels, int channels = 3);
+
+	// lod is the mip level to sample, usually from computeLod. The texture's own filter and wrap modes are
+	// defaults, materials pass their own so a shared texture needs no per-user state
+	__m128i sample(__m128 u, __m128 v, float lod = 0.0f) const { return sample(u, v, lod, mFilter); }
+	__m128i sample(__m128 u, __m128 v, float lod, TextureFilter filter) const
+	{
+		return sample(u, v, lod, filter, mWrapU, mWrapV);
+	}
+	__m128i sample(__m128 u, __m128 v, float lod, TextureFilter filter, TextureWrap wrapU, TextureWrap wrapV) const;
+
+	// level of detail from screen-space UV derivatives, using the largest footprint of the lanes in mask
+	float computeLod(__m128 dudx, __m128 dvdx, __m128 dudy, __m128 dvdy, int mask) const;
+
+	void setFilter(const TextureFilter filter) { mFilter = filter; }
+	TextureFilter getFilter() const { return mFilter; }
+
+	void setWrap(const TextureWrap wrapU, const TextureWrap wrapV)
+	{
+		mWrapU = wrapU;
+		mWrapV = wrapV;
+	}
+	TextureWrap getWrapU() const { return mWrapU; }
+	TextureWrap getWrapV() const { return mWrapV; }
 
 	bool isLoaded() const { return mIsLoaded; }
 	int getWidth() const { return mWidth; }
 	int getHeight() const { return mHeight; }
-	const uint8_t* getData() const { return mData; }
+	int getMipLevelCount() const { return static_cast<int>(mLevels.size()); }
+	int getMipWidth(const int level) const { return mLevels[level].width; }
+	int getMipHeight(const int level) const { return mLevels[level].height; }
+	TextureFormat getFormat() const { return mFormat; }
+	bool isCompressed() const { return mFormat != TextureFormat::RGBA8; }
+	// uncompressed texels, null for block compressed textures
+	const uint32_t* getData() const { return mIsLoaded && !isCompressed() ? mTexels.data() : nullptr; }
+	// bytes of texel or block storage over all mip levels
+	size_t getMemoryUsage() const { return mTexels.size() * sizeof(uint32_t) + mBlocks.size(); }
+
+	// compressed textures decode each 4x4 block into a small per-thread cache on first use
+	static BlockCacheStats getBlockCacheStats();
+	static void resetBlockCache();
+
+	// RGBA8 texel as r | g << 8 | b << 16 | a << 24
+	uint32_t getTexel(int level, int x, int y) const;
+
+	// unfiltered texels at integer coordinates of a mip level, sampling picks the best method for the build
+	__m128i fetch(int level, __m128i x, __m128i y, TexelFetch method) const;
 
 private:
+	struct MipLevel
+	{
+		int width;
+		int height;
+		int blocksPerRow;
+		size_t offset; // texel offset into mTexels, or byte offset into mBlocks when compressed
+	};
+
+	// texels are stored in 4x4 blocks, one 64 byte cache line each
+	static constexpr int BLOCK_SHIFT = 2;
+	static constexpr int BLOCK_SIZE = 1 << BLOCK_SHIFT;
+	static constexpr int BLOCK_TEXELS = BLOCK_SIZE * BLOCK_SIZE;
+	static constexpr size_t TEXEL_ALIGNMENT = 64;
+
 	int mWidth;
 	int mHeight;
-	uint8_t* mData;
 	bool mIsLoaded;
+	TextureFormat mFormat = TextureFormat::RGBA8;
+	TextureFilter mFilter = TextureFilter::Nearest;
+	TextureWrap mWrapU = TextureWrap::ClampToEdge;
+	TextureWrap mWrapV = TextureWrap::ClampToEdge;
+
+	// tiled RGBA8 texels of every mip level, base level first
+	std::vector<uint32_t, AlignedAllocator<uint32_t, TEXEL_ALIGNMENT>> mTexels;
+	std::vector<uint8_t, AlignedAllocator<uint8_t, TEXEL_ALIGNMENT>> mBlocks;
+	std::vector<MipLevel> mLevels;
+
+	// identifies this texture's contents in the decoded block caches, renewed on every load
+	uint64_t mId = 0;
+
+	bool loadCompressed(const std::string& path, bool ktx2);
+	const uint32_t* decodeBlock(const MipLevel& mip, size_t block) const;
+	__m128i fetchCompressed(const MipLevel& mip, __m128i indices) const;
+
+	void buildMipChain(const uint8_t* pixels, int channels);
+
+	static size_t tiledIndex(const MipLevel& mip, const int x, const int y)
+	{
+		const size_t block = static_cast<size_t>(y >> BLOCK_SHIFT) * mip.blocksPerRow + (x >> BLOCK_SHIFT);
+		return mip.offset + block * BLOCK_TEXELS + ((y & (BLOCK_SIZE - 1)) << BLOCK_SHIFT) + (x & (BLOCK_SIZE - 1));
+	}
+
+	int getNearestLevel(float lod) const;
+	static __m128i columnOffsets(__m128i x);
+	static __m128i rowOffsets(const MipLevel& mip, __m128i y);
+	static __m128i texelIndices(const MipLevel& mip, __m128i x, __m128i y);
+	__m128i fetchTexels(const MipLevel& mip, __m128i x, __m128i y) const;
+	__m128i sampleNearest(const MipLevel& mip, __m128 u, __m128 v, TextureWrap wrapU, TextureWrap wrapV) const;
+	__m128i sampleBilinear(const MipLevel& mip, __m128 u, __m128 v, TextureWrap wrapU, TextureWrap wrapV) const;
+	__m128i sampleBilinearCompressed(const MipLevel& mip, __m128i row0, __m128i row1, __m128i column0,
+	                                 __m128i column1, __m128i weightX, __m128i weightY) const;
 
 	bool isInBounds(const int x, const int y) const
 	{
@@ -0,0 +1,166 @@
+#include "TextureCache.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+// FNV-1a over the file bytes plus the size, empty when the file cannot be read
+static std::string hashFileContents(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file) return {};
+
+	uint64_t hash = 14695981039346656037ull;
+	uint64_t size = 0;
+	char buffer[1 << 16];
+	while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0)
+	{
+		const std::streamsize count = file.gcount();
+		for (std::streamsize i = 0; i < count; ++i)
+		{
+			hash ^= static_cast<uint8_t>(buffer[i]);
+			hash *= 1099511628211ull;
+		}
+		size += static_cast<uint64_t>(count);
+	}
+
+	return std::to_string(hash) + ":" + std::to_string(size);
+}
+
+TextureCache::TextureCache(const size_t memoryBudget) : mMemoryBudget(memoryBudget)
+{
+}
+
+TextureCache& TextureCache::instance()
+{
+	static TextureCache cache;
+	return cache;
+}
+
+std::shared_ptr<const Texture> TextureCache::load(const std::string& path)
+{
+	if (path.empty())
+		throw std::invalid_argument("Texture path cannot be empty");
+
+	std::error_code error;
+	if (!std::filesystem::exists(path, error))
+	{
+		std::cerr << "Texture file does not exist: " << path << '\n';
+		return nullptr;
+	}
+
+	const std::string pathKey = std::filesystem::weakly_canonical(path, error).string();
+
+	{
+		std::lock_guard lock(mMutex);
+		if (const auto found = mByPath.find(pathKey); found != mByPath.end())
+		{
+			++mStats.hits;
+			touch(found->second);
+			return found->second->texture;
+		}
+	}
+
+	// same bytes under another name share the texture too; only a path not seen before gets here, so each
+	// new path is read once for its hash before decoding
+	const std::string contentKey = hashFileContents(path);
+	{
+		std::lock_guard lock(mMutex);
+		if (const auto found = mByContent.find(contentKey); found != mByContent.end())
+		{
+			++mStats.hits;
+			addPath(found->second, pathKey);
+			return found->second->texture;
+		}
+	}
+
+	// decode outside the lock so other threads can keep hitting the cache
+	auto texture = std::make_shared<Texture>(path);
+	if (!texture->isLoaded())
+		return nullptr;
+
+	std::lock_guard lock(mMutex);
+
+	// another thread may have finished the same file, or the same contents under another name, first;
+	// the winner's texture is shared and this decoded copy is dropped
+	if (const auto found = mByPath.find(pathKey); found != mByPath.end())
+	{
+		++mStats.hits;
+		touch(found->second);
+		return found->second->texture;
+	}
+	if (const auto found = mByContent.find(contentKey); found != mByContent.end())
+	{
+		++mStats.hits;
+		addPath(found->second, pathKey);
+		return found->second->texture;
+	}
+
+	++mStats.misses;
+	mEntries.push_front({texture, contentKey, {pathKey}, texture->getMemoryUsage()});
+	mByPath.emplace(pathKey, mEntries.begin());
+	mByContent.emplace(contentKey, mEntries.begin());
+	mStats.residentBytes += mEntries.front().bytes;
+	++mStats.textureCount;
+
+	evictOverBudget(mEntries.begin());
+	return texture;
+}
+
+void TextureCache::setMemoryBudget(const size_t bytes)
+{
+	std::lock_guard lock(mMutex);
+	mMemoryBudget = bytes;
+	evictOverBudget(mEntries.end());
+}
+
+size_t TextureCache::getMemoryBudget() const
+{
+	std::lock_guard lock(mMutex);
+	return mMemoryBudget;
+}
+
+TextureCacheStats TextureCache::getStats() const
+{
+	std::lock_guard lock(mMutex);
+	return mStats;
+}
+
+void TextureCache::clear()
+{
+	std::lock_guard lock(mMutex);
+	mEntries.clear();
+	mByPath.clear();
+	mByContent.clear();
+	mStats = {};
+}
+
+void TextureCache::touch(const EntryList::iterator entry)
+{
+	mEntries.splice(mEntries.begin(), mEntries, entry);
+}
+
+void TextureCache::addPath(const EntryList::iterator entry, const std::string& pathKey)
+{
+	entry->pathKeys.push_back(pathKey);
+	mByPath.emplace(pathKey, entry);
+	touch(entry);
+}
+
+void TextureCache::evictOverBudget(const EntryList::iterator keep)
+{
+	// the texture just loaded stays even if it alone exceeds the budget
+	while (mStats.residentBytes > mMemoryBudget && !mEntries.empty())
+	{
+		auto victim = std::prev(mEntries.end());
+		if (victim == keep) break;
+
+		for (const std::string& key : victim->pathKeys)
+			mByPath.erase(key);
+		mByContent.erase(victim->contentKey);
+		mStats.residentBytes -= victim->bytes;
+		--mStats.textureCount;
+		++mStats.evictions;
+		mEntries.erase(victim);
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Texture.h"
+
+struct TextureCacheStats
+{
+	size_t hits = 0;
+	size_t misses = 0; // loads that added a decoded texture, a decode that lost a race counts as a hit
+	size_t evictions = 0;
+	size_t residentBytes = 0;
+	size_t textureCount = 0;
+};
+
+// shares decoded textures between materials and models, keyed by canonical path and by file contents;
+// least recently used textures are dropped once the budget is exceeded, materials still holding one keep it alive
+class TextureCache
+{
+public:
+	static constexpr size_t DEFAULT_MEMORY_BUDGET = size_t(512) << 20;
+
+	explicit TextureCache(size_t memoryBudget = DEFAULT_MEMORY_BUDGET);
+
+	// process-wide cache used by model loading
+	static TextureCache& instance();
+
+	// null when the file is missing or cannot be decoded. The texture is shared and read-only, sampler state
+	// such as wrap modes and filtering belongs to the material
+	std::shared_ptr<const Texture> load(const std::string& path);
+
+	void setMemoryBudget(size_t bytes);
+	size_t getMemoryBudget() const;
+	TextureCacheStats getStats() const;
+	void clear();
+
+private:
+	struct Entry
+	{
+		std::shared_ptr<const Texture> texture;
+		std::string contentKey;
+		std::vector<std::string> pathKeys;
+		size_t bytes;
+	};
+
+	using EntryList = std::list<Entry>;
+
+	mutable std::mutex mMutex;
+	size_t mMemoryBudget;
+	TextureCacheStats mStats;
+
+	// most recently used first
+	EntryList mEntries;
+	std::unordered_map<std::string, EntryList::iterator> mByPath;
+	std::unordered_map<std::string, EntryList::iterator> mByContent;
+
+	void touch(EntryList::iterator entry);
+	void addPath(EntryList::iterator entry, const std::string& pathKey);
+	void evictOverBudget(EntryList::iterator keep);
+};
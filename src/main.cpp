@@ -9,6 +9,7 @@
 #include "Camera.h"
 #include "Window.h"
 #include "Renderer.h"
+#include "AssetLoader.h"
 
 
 int main()
@@ -18,12 +19,19 @@ int main()
 		constexpr int WIDTH = 1920;
 		constexpr int HEIGHT = 1080;
 		constexpr float ASPECT_RATIO = static_cast<float>(WIDTH) / HEIGHT;
+		constexpr int SAMPLE_COUNT = 4; // 1 disables MSAA
+		constexpr float FRAME_TIME_BUDGET_MS = 1000.0f / 60.0f; // 0 disables dynamic resolution
 		const std::string TITLE = "Software Renderer";
 
 		Window window(WIDTH, HEIGHT, TITLE);
 
 		Renderer renderer;
-		Model cube("../assets/sammax.obj");
+		renderer.setFrameTimeBudget(FRAME_TIME_BUDGET_MS);
+		AssetLoader loader;
+
+		// textures keep decoding after the geometry is ready
+		const std::shared_ptr<Model> model = loader.loadModel("../assets/sammax.obj").get();
+		Model& cube = *model;
 		cube.setScale(glm::vec3(2.0f, 2.0f, 2.0f));
 		cube.setPosition(glm::vec3(0.0f, 0.0f, 0.0f));
 		cube.setRotation(glm::vec3(0.0f, 0.0f, 0.0f));
@@ -61,8 +69,8 @@ int main()
 				lastFpsUpdateTime = currentTime;
 
 				std::string titleWithFps =
-					std::format("{} - FPS: {:.1f} - Frame Time: {:.2f} ms",
-					            TITLE, fps, frameTime * 1000.0f);
+					std::format("{} - FPS: {:.1f} - Frame Time: {:.2f} ms - Render Scale: {:.0f}%",
+					            TITLE, fps, frameTime * 1000.0f, renderer.getRenderScale() * 100.0f);
 				window.setTitle(titleWithFps);
 			}
 
@@ -71,15 +79,26 @@ int main()
 			Framebuffer* backBuffer = window.getBackBuffer();
 			assert(backBuffer && "Back buffer should not be null");
 
-			backBuffer->clear();
-			backBuffer->clearDepth();
+			// drawn at the dynamic resolution, then scaled into the back buffer
+			Framebuffer& target = renderer.beginFrame(*backBuffer);
+
+			// whichever framebuffer is drawn into gets multisampled the first time it is used
+			if (target.getSampleCount() != SAMPLE_COUNT)
+				target.setSampleCount(SAMPLE_COUNT);
+			target.clear();
+			target.clearDepth();
+
+			cube.resolvePendingTextures();
 
 			// rotate model
 			glm::vec3 rotation = cube.getRotation();
 			rotation.y += rotationSpeed * frameTime;
 			cube.setRotation(rotation);
 
-			renderer.renderModel(*backBuffer, camera, cube);
+			renderer.renderModel(target, camera, cube);
+			renderer.renderTransparent(target, camera);
+			target.resolve();
+			renderer.endFrame(*backBuffer);
 
 			window.swapBuffers();
 		}
@@ -0,0 +1,44 @@
+#include <gtest/gtest.h>
+#include "../src/AlignedAllocator.h"
+#include <cstdint>
+#include <vector>
+
+class AlignedAllocatorTest : public testing::Test
+{
+protected:
+	using AlignedVector = std::vector<uint32_t, AlignedAllocator<uint32_t, 64>>;
+
+	static bool isAligned(const void* pointer, const uintptr_t alignment)
+	{
+		return reinterpret_cast<uintptr_t>(pointer) % alignment == 0;
+	}
+};
+
+TEST_F(AlignedAllocatorTest, AllocationsAreAligned)
+{
+	for (size_t count = 1; count < 100; count += 7)
+	{
+		AlignedVector values(count);
+		EXPECT_TRUE(isAligned(values.data(), 64));
+	}
+
+	std::vector<float, AlignedAllocator<float, 32>> floats(3);
+	EXPECT_TRUE(isAligned(floats.data(), 32));
+}
+
+TEST_F(AlignedAllocatorTest, GrowthKeepsContentsAndAlignment)
+{
+	AlignedVector values;
+	for (uint32_t i = 0; i < 1000; ++i)
+	{
+		values.push_back(i);
+		ASSERT_TRUE(isAligned(values.data(), 64));
+	}
+
+	for (uint32_t i = 0; i < 1000; ++i)
+		EXPECT_EQ(values[i], i);
+
+	AlignedVector copy = values;
+	EXPECT_TRUE(isAligned(copy.data(), 64));
+	EXPECT_EQ(copy, values);
+}
@@ -0,0 +1,188 @@
+#include <gtest/gtest.h>
+#include "../src/AssetLoader.h"
+#include "../src/Model.h"
+#include "../src/TextureCache.h"
+#include "TestBitmap.h"
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <set>
+
+class AssetLoaderTest : public testing::Test
+{
+protected:
+	void TearDown() override
+	{
+		for (const std::string& path : paths)
+			std::remove(path.c_str());
+	}
+
+	// solid gray 1x1 BMP
+	void createBMP(const std::string& path, const uint8_t value)
+	{
+		writeTestBMP(path, 1, 1, value * 0x010101u);
+		paths.push_back(path);
+	}
+
+	void createFile(const std::string& path, const std::string& contents)
+	{
+		std::ofstream(path) << contents;
+		paths.push_back(path);
+	}
+
+	std::vector<std::string> paths;
+};
+
+TEST_F(AssetLoaderTest, SubmitRunsOnWorkers)
+{
+	AssetLoader loader(4);
+	EXPECT_EQ(loader.getThreadCount(), 4u);
+
+	std::atomic<int> sum = 0;
+	std::vector<std::future<int>> results;
+	for (int i = 0; i < 64; ++i)
+	{
+		results.push_back(loader.submit([i, &sum] { sum += i; return i * 2; }));
+	}
+
+	for (int i = 0; i < 64; ++i)
+	{
+		EXPECT_EQ(results[i].get(), i * 2);
+	}
+	EXPECT_EQ(sum, 64 * 63 / 2);
+
+	auto failing = loader.submit([]() -> int { throw std::runtime_error("load failed"); });
+	EXPECT_THROW(failing.get(), std::runtime_error);
+}
+
+TEST_F(AssetLoaderTest, DestructorFinishesQueuedWork)
+{
+	std::atomic<int> completed = 0;
+	{
+		AssetLoader loader(1);
+		for (int i = 0; i < 16; ++i)
+		{
+			loader.submit([&completed] { ++completed; });
+		}
+	}
+	EXPECT_EQ(completed, 16);
+}
+
+TEST_F(AssetLoaderTest, LoadTexture)
+{
+	createBMP("test_async_texture.bmp", 0x40);
+	createBMP("test_async_copy.bmp", 0x40);
+
+	AssetLoader loader(2);
+	TextureFuture first = loader.loadTexture("test_async_texture.bmp");
+	TextureFuture again = loader.loadTexture("test_async_texture.bmp");
+	TextureFuture copy = loader.loadTexture("test_async_copy.bmp");
+	TextureFuture missing = loader.loadTexture("non_existent_texture.png");
+
+	ASSERT_NE(first.get(), nullptr);
+	EXPECT_TRUE(first.get()->isLoaded());
+	EXPECT_EQ(again.get(), first.get());
+	EXPECT_EQ(copy.get(), first.get());
+	EXPECT_EQ(missing.get(), nullptr);
+
+	// finished requests are answered by the texture cache
+	EXPECT_EQ(loader.loadTexture("test_async_texture.bmp").get(), first.get());
+	EXPECT_THROW(loader.loadTexture(""), std::invalid_argument);
+
+	TextureCache::instance().clear();
+}
+
+TEST_F(AssetLoaderTest, FailedTextureLoadIsRetried)
+{
+	// 4x4 DXT1 with a single solid block, first written with a zero width the decoder rejects
+	const auto writeDDS = [](const std::string& path, const uint32_t width)
+	{
+		std::vector<uint8_t> bytes(128, 0);
+		std::memcpy(bytes.data(), "DDS ", 4);
+		const uint32_t header[] = {124, 0, 4, width, 0, 0, 1};
+		std::memcpy(bytes.data() + 4, header, sizeof(header));
+		std::memcpy(bytes.data() + 84, "DXT1", 4);
+		bytes.resize(bytes.size() + 8, 0);
+		std::ofstream file(path, std::ios::binary);
+		file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+	};
+	const std::string path = "test_async_malformed.dds";
+	paths.push_back(path);
+	writeDDS(path, 0);
+
+	AssetLoader loader(2);
+	EXPECT_THROW(loader.loadTexture(path).get(), std::runtime_error);
+	EXPECT_THROW(loader.loadTexture(path).get(), std::runtime_error);
+
+	// the failure is not remembered, so a repaired file loads
+	writeDDS(path, 4);
+	const std::shared_ptr<const Texture> texture = loader.loadTexture(path).get();
+	ASSERT_NE(texture, nullptr);
+	EXPECT_EQ(texture->getWidth(), 4);
+
+	TextureCache::instance().clear();
+}
+
+TEST_F(AssetLoaderTest, PlaceholderTexture)
+{
+	const auto& placeholder = AssetLoader::getPlaceholderTexture();
+	ASSERT_NE(placeholder, nullptr);
+	EXPECT_TRUE(placeholder->isLoaded());
+	EXPECT_EQ(placeholder, AssetLoader::getPlaceholderTexture());
+	EXPECT_NE(placeholder->getTexel(0, 0, 0), placeholder->getTexel(0, 4, 0));
+}
+
+TEST_F(AssetLoaderTest, LoadModels)
+{
+	createBMP("test_async_a.bmp", 0x20);
+	createBMP("test_async_b.bmp", 0x80);
+	createFile("test_async.mtl", "newmtl a\nmap_Kd test_async_a.bmp\nnewmtl b\nmap_Kd test_async_b.bmp\nnewmtl missing\nmap_Kd test_async_missing.bmp\n");
+	paths.push_back("test_async.obj.meshcache");
+	createFile("test_async.obj",
+		"mtllib test_async.mtl\nv 0 0 0\nv 1 0 0\nv 0 1 0\n"
+		"o a\nusemtl a\nf 1 2 3\no b\nusemtl b\nf 1 2 3\no missing\nusemtl missing\nf 1 2 3\n");
+
+	AssetLoader loader(4);
+	std::vector<std::future<std::shared_ptr<Model>>> pending;
+	for (int i = 0; i < 4; ++i)
+	{
+		pending.push_back(loader.loadModel("./test_async.obj"));
+	}
+	auto failing = loader.loadModel("non_existent_model.obj");
+
+	std::set<const Texture*> textures;
+	for (auto& future : pending)
+	{
+		const std::shared_ptr<Model> model = future.get();
+		ASSERT_NE(model, nullptr);
+		ASSERT_EQ(model->getMeshes().size(), 3u);
+
+		// textures are either done or still showing the placeholder
+		for (const Mesh& mesh : model->getMeshes())
+		{
+			const Texture* texture = mesh.getMaterial()->getDiffuseTexture();
+			EXPECT_TRUE(texture == nullptr || texture->isLoaded());
+		}
+
+		model->waitForTextures();
+		EXPECT_TRUE(model->resolvePendingTextures());
+
+		const Texture* a = model->getMeshes()[0].getMaterial()->getDiffuseTexture();
+		const Texture* b = model->getMeshes()[1].getMaterial()->getDiffuseTexture();
+		ASSERT_NE(a, nullptr);
+		ASSERT_NE(b, nullptr);
+		EXPECT_NE(a, AssetLoader::getPlaceholderTexture().get());
+		EXPECT_EQ(a->getTexel(0, 0, 0) & 0xFF, 0x20u);
+		EXPECT_EQ(b->getTexel(0, 0, 0) & 0xFF, 0x80u);
+		EXPECT_EQ(model->getMeshes()[2].getMaterial()->getDiffuseTexture(), nullptr);
+		textures.insert(a);
+		textures.insert(b);
+	}
+
+	// every model shares the same two decoded textures
+	EXPECT_EQ(textures.size(), 2u);
+	EXPECT_THROW(failing.get(), std::runtime_error);
+
+	TextureCache::instance().clear();
+}
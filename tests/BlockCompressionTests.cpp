@@ -0,0 +1,247 @@
+#include <gtest/gtest.h>
+#include "../src/BlockCompression.h"
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+class BlockCompressionTest : public testing::Test
+{
+protected:
+	void TearDown() override
+	{
+		std::remove(testPath.c_str());
+	}
+
+	// red and blue endpoints, texel i uses palette entry i % 4
+	static std::vector<uint8_t> makeBC1Block(const uint16_t color0, const uint16_t color1)
+	{
+		std::vector<uint8_t> block(8);
+		std::memcpy(block.data(), &color0, 2);
+		std::memcpy(block.data() + 2, &color1, 2);
+		constexpr uint32_t indices = 0xE4E4E4E4; // 0, 1, 2, 3 repeated
+		std::memcpy(block.data() + 4, &indices, 4);
+		return block;
+	}
+
+	static void writeFile(const std::string& path, const std::vector<uint8_t>& bytes)
+	{
+		std::ofstream file(path, std::ios::binary);
+		file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+	}
+
+	static void writeValue(std::vector<uint8_t>& bytes, const size_t offset, const uint32_t value)
+	{
+		std::memcpy(bytes.data() + offset, &value, 4);
+	}
+
+	// DDS header for a DXT1 texture followed by its blocks
+	static std::vector<uint8_t> makeDDS(const int width, const int height, const int levels,
+	                                    const std::vector<uint8_t>& blocks, const char* fourCC = "DXT1")
+	{
+		std::vector<uint8_t> bytes(128, 0);
+		std::memcpy(bytes.data(), "DDS ", 4);
+		writeValue(bytes, 4, 124);
+		writeValue(bytes, 12, height);
+		writeValue(bytes, 16, width);
+		writeValue(bytes, 28, levels);
+		writeValue(bytes, 76, 32);
+		writeValue(bytes, 80, 0x4); // DDPF_FOURCC
+		std::memcpy(bytes.data() + 84, fourCC, 4);
+		bytes.insert(bytes.end(), blocks.begin(), blocks.end());
+		return bytes;
+	}
+
+	std::string testPath = "test_compressed_texture.bin";
+};
+
+TEST_F(BlockCompressionTest, DecodeBC1FourColors)
+{
+	const std::vector<uint8_t> block = makeBC1Block(0xF800, 0x001F);
+	uint32_t texels[16];
+	decodeBC1Block(block.data(), texels);
+
+	EXPECT_EQ(texels[0], 0xFF0000FFu);
+	EXPECT_EQ(texels[1], 0xFFFF0000u);
+	EXPECT_EQ(texels[2], 0xFF5500AAu);
+	EXPECT_EQ(texels[3], 0xFFAA0055u);
+	for (int i = 4; i < 16; ++i)
+		EXPECT_EQ(texels[i], texels[i % 4]);
+}
+
+TEST_F(BlockCompressionTest, DecodeBC1PunchThroughAlpha)
+{
+	// color0 <= color1 selects three colors and transparent black
+	const std::vector<uint8_t> block = makeBC1Block(0x001F, 0xF800);
+	uint32_t texels[16];
+	decodeBC1Block(block.data(), texels);
+
+	EXPECT_EQ(texels[0], 0xFFFF0000u);
+	EXPECT_EQ(texels[1], 0xFF0000FFu);
+	EXPECT_EQ(texels[2], 0xFF800080u);
+	EXPECT_EQ(texels[3], 0x00000000u);
+}
+
+TEST_F(BlockCompressionTest, DecodeBC3Alpha)
+{
+	std::vector<uint8_t> block(16, 0);
+	block[0] = 255;
+	block[1] = 0;
+	// texel i uses alpha index i % 8
+	uint64_t indices = 0;
+	for (int i = 0; i < 16; ++i)
+		indices |= static_cast<uint64_t>(i % 8) << (i * 3);
+	std::memcpy(block.data() + 2, &indices, 6);
+
+	// white color half, BC3 never uses punch-through even when color0 <= color1
+	const std::vector<uint8_t> color = makeBC1Block(0xFFFF, 0xFFFF);
+	std::memcpy(block.data() + 8, color.data(), 8);
+
+	uint32_t texels[16];
+	decodeBC3Block(block.data(), texels);
+
+	const uint32_t expected[8] = {255, 0, 219, 182, 146, 109, 73, 36};
+	for (int i = 0; i < 16; ++i)
+	{
+		EXPECT_EQ(texels[i] >> 24, expected[i % 8]) << "texel " << i;
+		EXPECT_EQ(texels[i] & 0xFFFFFF, 0xFFFFFFu);
+	}
+
+	// six interpolated values plus 0 and 255 when alpha0 <= alpha1
+	block[0] = 0;
+	block[1] = 255;
+	decodeBC3Block(block.data(), texels);
+	const uint32_t expectedSix[8] = {0, 255, 51, 102, 153, 204, 0, 255};
+	for (int i = 0; i < 8; ++i)
+		EXPECT_EQ(texels[i] >> 24, expectedSix[i]) << "texel " << i;
+}
+
+TEST_F(BlockCompressionTest, LoadDDSWithMipLevels)
+{
+	// 8x8 has four blocks, then 4x4, 2x2 and 1x1 take one each
+	std::vector<uint8_t> blocks;
+	for (int i = 0; i < 7; ++i)
+	{
+		const std::vector<uint8_t> block = makeBC1Block(static_cast<uint16_t>(0xF800 - i), 0x001F);
+		blocks.insert(blocks.end(), block.begin(), block.end());
+	}
+	writeFile(testPath, makeDDS(8, 8, 4, blocks));
+
+	CompressedImage image;
+	ASSERT_TRUE(loadDDS(testPath, image));
+	EXPECT_EQ(image.format, BlockFormat::BC1);
+	EXPECT_EQ(image.width, 8);
+	EXPECT_EQ(image.height, 8);
+	ASSERT_EQ(image.levelOffsets.size(), 4u);
+	EXPECT_EQ(image.levelOffsets[1], 32u);
+	EXPECT_EQ(image.levelOffsets[3], 48u);
+	EXPECT_EQ(image.data.size(), blocks.size());
+	EXPECT_EQ(std::memcmp(image.data.data(), blocks.data(), blocks.size()), 0);
+}
+
+TEST_F(BlockCompressionTest, LoadDDSRejectsBadFiles)
+{
+	CompressedImage image;
+
+	// missing level data
+	writeFile(testPath, makeDDS(8, 8, 1, makeBC1Block(0, 0)));
+	EXPECT_FALSE(loadDDS(testPath, image));
+
+	// uncompressed pixel format
+	writeFile(testPath, makeDDS(4, 4, 1, makeBC1Block(0, 0), "RGBA"));
+	EXPECT_FALSE(loadDDS(testPath, image));
+
+	writeFile(testPath, {'B', 'M', 0, 0});
+	EXPECT_FALSE(loadDDS(testPath, image));
+
+	writeFile(testPath, makeDDS(0, 4, 1, makeBC1Block(0, 0)));
+	EXPECT_THROW(loadDDS(testPath, image), std::runtime_error);
+}
+
+TEST_F(BlockCompressionTest, LoadDDSWithDX10Header)
+{
+	std::vector<uint8_t> bytes = makeDDS(4, 4, 1, {}, "DX10");
+	std::vector<uint8_t> dx10(20, 0);
+	const uint32_t dxgiFormat = 77; // BC3_UNORM
+	std::memcpy(dx10.data(), &dxgiFormat, 4);
+	bytes.insert(bytes.end(), dx10.begin(), dx10.end());
+	bytes.insert(bytes.end(), 16, 0xAB);
+	writeFile(testPath, bytes);
+
+	CompressedImage image;
+	ASSERT_TRUE(loadDDS(testPath, image));
+	EXPECT_EQ(image.format, BlockFormat::BC3);
+	ASSERT_EQ(image.data.size(), 16u);
+	EXPECT_EQ(image.data[0], 0xAB);
+}
+
+TEST_F(BlockCompressionTest, LoadKTX2)
+{
+	// 4x4 BC1 with two levels, the smaller level stored first as libktx does
+	const std::vector<uint8_t> level0 = makeBC1Block(0xF800, 0x001F);
+	const std::vector<uint8_t> level1 = makeBC1Block(0x07E0, 0x001F);
+
+	std::vector<uint8_t> bytes(80 + 2 * 24, 0);
+	const uint8_t identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+	std::memcpy(bytes.data(), identifier, 12);
+	writeValue(bytes, 12, 131); // VK_FORMAT_BC1_RGB_UNORM_BLOCK
+	writeValue(bytes, 16, 1);
+	writeValue(bytes, 20, 4);
+	writeValue(bytes, 24, 4);
+	writeValue(bytes, 36, 1);
+	writeValue(bytes, 40, 2);
+
+	const uint64_t level1Offset = bytes.size();
+	const uint64_t level0Offset = level1Offset + 8;
+	const uint64_t length = 8;
+	std::memcpy(bytes.data() + 80, &level0Offset, 8);
+	std::memcpy(bytes.data() + 88, &length, 8);
+	std::memcpy(bytes.data() + 104, &level1Offset, 8);
+	std::memcpy(bytes.data() + 112, &length, 8);
+	bytes.insert(bytes.end(), level1.begin(), level1.end());
+	bytes.insert(bytes.end(), level0.begin(), level0.end());
+	writeFile(testPath, bytes);
+
+	CompressedImage image;
+	ASSERT_TRUE(loadKTX2(testPath, image));
+	EXPECT_EQ(image.format, BlockFormat::BC1);
+	ASSERT_EQ(image.levelOffsets.size(), 2u);
+	EXPECT_EQ(std::memcmp(image.data.data(), level0.data(), 8), 0);
+	EXPECT_EQ(std::memcmp(image.data.data() + image.levelOffsets[1], level1.data(), 8), 0);
+
+	// supercompressed payloads are rejected
+	writeValue(bytes, 44, 1);
+	writeFile(testPath, bytes);
+	EXPECT_FALSE(loadKTX2(testPath, image));
+}
+
+TEST_F(BlockCompressionTest, LoadKTX2RejectsLevelsOutsideTheFile)
+{
+	std::vector<uint8_t> bytes(80 + 24, 0);
+	const uint8_t identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+	std::memcpy(bytes.data(), identifier, 12);
+	writeValue(bytes, 12, 131); // VK_FORMAT_BC1_RGB_UNORM_BLOCK
+	writeValue(bytes, 20, 4);
+	writeValue(bytes, 24, 4);
+	writeValue(bytes, 40, 1);
+	const std::vector<uint8_t> block = makeBC1Block(0xF800, 0x001F);
+	bytes.insert(bytes.end(), block.begin(), block.end());
+
+	// an offset that wraps past zero when the level size is added to it
+	const uint64_t wrappingOffset = UINT64_MAX - 4;
+	const uint64_t length = 8;
+	std::memcpy(bytes.data() + 80, &wrappingOffset, 8);
+	std::memcpy(bytes.data() + 88, &length, 8);
+	writeFile(testPath, bytes);
+	CompressedImage image;
+	EXPECT_FALSE(loadKTX2(testPath, image));
+
+	// dimensions whose level size does not fit in 32 bits
+	const uint64_t offset = 80 + 24;
+	const uint64_t hugeLength = UINT64_MAX;
+	writeValue(bytes, 20, 0x7FFFFFFF);
+	writeValue(bytes, 24, 0x7FFFFFFF);
+	std::memcpy(bytes.data() + 80, &offset, 8);
+	std::memcpy(bytes.data() + 88, &hugeLength, 8);
+	writeFile(testPath, bytes);
+	EXPECT_FALSE(loadKTX2(testPath, image));
+}
@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+#include "../src/Bounds.h"
+#include <glm/gtc/matrix_transform.hpp>
+
+class BoundsTest : public testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		// looking down -z from the origin, near 0.1, far 100
+		const glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 100.0f);
+		frustum = Frustum::fromMatrix(projection, false);
+	}
+
+	Frustum frustum;
+};
+
+TEST_F(BoundsTest, BoxCenterAndExtents)
+{
+	const BoundingBox box{glm::vec3(-1.0f, 0.0f, 2.0f), glm::vec3(3.0f, 2.0f, 4.0f)};
+
+	EXPECT_EQ(box.getCenter(), glm::vec3(1.0f, 1.0f, 3.0f));
+	EXPECT_EQ(box.getExtents(), glm::vec3(2.0f, 1.0f, 1.0f));
+}
+
+TEST_F(BoundsTest, BoxTransform)
+{
+	const BoundingBox box{glm::vec3(-1.0f), glm::vec3(1.0f)};
+
+	const glm::mat4 translation = glm::translate(glm::mat4(1.0f), glm::vec3(5.0f, 0.0f, 0.0f));
+	const BoundingBox moved = box.transformed(glm::scale(translation, glm::vec3(2.0f)));
+	EXPECT_FLOAT_EQ(moved.min.x, 3.0f);
+	EXPECT_FLOAT_EQ(moved.max.x, 7.0f);
+
+	// rotating by 45 degrees grows the enclosing box
+	const BoundingBox rotated = box.transformed(glm::rotate(glm::mat4(1.0f), glm::radians(45.0f),
+	                                                        glm::vec3(0.0f, 0.0f, 1.0f)));
+	EXPECT_NEAR(rotated.max.x, std::sqrt(2.0f), 1e-5f);
+	EXPECT_FLOAT_EQ(rotated.max.z, 1.0f);
+}
+
+TEST_F(BoundsTest, SphereTransform)
+{
+	const BoundingSphere sphere{glm::vec3(1.0f, 0.0f, 0.0f), 2.0f};
+
+	const BoundingSphere scaled = sphere.transformed(glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 3.0f, 1.0f)));
+	EXPECT_FLOAT_EQ(scaled.center.x, 1.0f);
+	EXPECT_FLOAT_EQ(scaled.radius, 6.0f);
+}
+
+TEST_F(BoundsTest, FrustumPlanesNormalized)
+{
+	for (const glm::vec4& plane : frustum.planes)
+	{
+		EXPECT_NEAR(glm::length(glm::vec3(plane.x, plane.y, plane.z)), 1.0f, 1e-5f);
+	}
+
+	// near plane sits at z = -0.1 facing -z
+	EXPECT_NEAR(frustum.planes[4].z, -1.0f, 1e-5f);
+	EXPECT_NEAR(frustum.planes[4].w, -0.1f, 1e-4f);
+}
+
+TEST_F(BoundsTest, FrustumSphereTests)
+{
+	EXPECT_TRUE(frustum.intersects(BoundingSphere{glm::vec3(0.0f, 0.0f, -10.0f), 1.0f}));
+	EXPECT_FALSE(frustum.intersects(BoundingSphere{glm::vec3(0.0f, 0.0f, 10.0f), 1.0f}));
+	EXPECT_FALSE(frustum.intersects(BoundingSphere{glm::vec3(0.0f, 0.0f, -200.0f), 1.0f}));
+	EXPECT_FALSE(frustum.intersects(BoundingSphere{glm::vec3(50.0f, 0.0f, -10.0f), 1.0f}));
+
+	// straddling the left plane
+	EXPECT_TRUE(frustum.intersects(BoundingSphere{glm::vec3(-10.5f, 0.0f, -10.0f), 1.0f}));
+}
+
+TEST_F(BoundsTest, FrustumBoxTests)
+{
+	EXPECT_TRUE(frustum.intersects(BoundingBox{glm::vec3(-1.0f, -1.0f, -11.0f), glm::vec3(1.0f, 1.0f, -9.0f)}));
+	EXPECT_FALSE(frustum.intersects(BoundingBox{glm::vec3(-1.0f, -1.0f, 1.0f), glm::vec3(1.0f, 1.0f, 3.0f)}));
+	EXPECT_FALSE(frustum.intersects(BoundingBox{glm::vec3(20.0f, -1.0f, -11.0f), glm::vec3(22.0f, 1.0f, -9.0f)}));
+
+	// box around the camera crosses the near plane
+	EXPECT_TRUE(frustum.intersects(BoundingBox{glm::vec3(-1.0f), glm::vec3(1.0f)}));
+}
+
+TEST_F(BoundsTest, ReverseZFrustumMatchesStandard)
+{
+	glm::mat4 reversed = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 100.0f);
+	reversed[2][2] = 0.1f / (100.0f - 0.1f);
+	reversed[3][2] = 100.0f * 0.1f / (100.0f - 0.1f);
+	const Frustum reverseFrustum = Frustum::fromMatrix(reversed, true);
+
+	for (size_t i = 0; i < frustum.planes.size(); ++i)
+	{
+		EXPECT_NEAR(reverseFrustum.planes[i].x, frustum.planes[i].x, 1e-4f);
+		EXPECT_NEAR(reverseFrustum.planes[i].y, frustum.planes[i].y, 1e-4f);
+		EXPECT_NEAR(reverseFrustum.planes[i].z, frustum.planes[i].z, 1e-4f);
+		EXPECT_NEAR(reverseFrustum.planes[i].w, frustum.planes[i].w, 1e-3f);
+	}
+}
+
+TEST_F(BoundsTest, TileFrustumBoundsRectangleAndDepth)
+{
+	const glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 100.0f);
+
+	// right half of the screen, view depth 5 to 10
+	const Frustum tile = Frustum::fromTile(projection, glm::vec2(0.0f, -1.0f), glm::vec2(1.0f, 1.0f), 5.0f, 10.0f);
+
+	EXPECT_TRUE(tile.intersects(BoundingSphere{glm::vec3(3.0f, 0.0f, -7.0f), 0.5f}));
+	EXPECT_FALSE(tile.intersects(BoundingSphere{glm::vec3(-3.0f, 0.0f, -7.0f), 0.5f}));
+	EXPECT_FALSE(tile.intersects(BoundingSphere{glm::vec3(3.0f, 0.0f, -2.0f), 0.5f}));
+	EXPECT_FALSE(tile.intersects(BoundingSphere{glm::vec3(3.0f, 0.0f, -20.0f), 0.5f}));
+
+	// reaching across the depth bound
+	EXPECT_TRUE(tile.intersects(BoundingSphere{glm::vec3(3.0f, 0.0f, -11.0f), 2.0f}));
+}
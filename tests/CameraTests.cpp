@@ -361,3 +361,37 @@ TEST_F(CameraTest, SetDirectionPitchWarnings)
 	EXPECT_NO_THROW(camera->setDirection(0.0f, 180.0f));
 	EXPECT_NO_THROW(camera->setDirection(0.0f, -180.0f));
 }
+
+TEST_F(CameraTest, ReverseZProjection)
+{
+	camera->setProjectionParams(16.0f / 9.0f, 0.5f, 50.0f);
+	camera->setReverseZ(true);
+	EXPECT_TRUE(camera->isReverseZ());
+
+	const glm::mat4& proj = camera->getProjectionMatrix();
+	const glm::vec4 nearPoint = proj * glm::vec4(0.0f, 0.0f, -0.5f, 1.0f);
+	const glm::vec4 farPoint = proj * glm::vec4(0.0f, 0.0f, -50.0f, 1.0f);
+
+	EXPECT_NEAR(nearPoint.z / nearPoint.w, 1.0f, 1e-5f);
+	EXPECT_NEAR(farPoint.z / farPoint.w, 0.0f, 1e-5f);
+
+	camera->setReverseZ(false);
+	const glm::vec4 standardNear = camera->getProjectionMatrix() * glm::vec4(0.0f, 0.0f, -0.5f, 1.0f);
+	EXPECT_NEAR(standardNear.z / standardNear.w, -1.0f, 1e-5f);
+}
+
+TEST_F(CameraTest, FrustumFollowsCamera)
+{
+	const BoundingSphere ahead{glm::vec3(0.0f, 0.0f, -10.0f), 1.0f};
+	EXPECT_TRUE(camera->getFrustum().intersects(ahead));
+
+	// turn around to face +z
+	camera->setDirection(90.0f, 0.0f);
+	EXPECT_FALSE(camera->getFrustum().intersects(ahead));
+
+	camera->setPosition(glm::vec3(0.0f, 0.0f, -20.0f));
+	EXPECT_TRUE(camera->getFrustum().intersects(ahead));
+
+	camera->setReverseZ(true);
+	EXPECT_TRUE(camera->getFrustum().intersects(ahead));
+}
@@ -276,3 +276,195 @@ TEST_F(FramebufferTest, EdgeCaseCoordinates)
 	EXPECT_NO_THROW(framebuffer->setPixel(xBoundary, yBoundary, color, 0xF));
 	EXPECT_NO_THROW(framebuffer->depthTest(xBoundary, yBoundary, depth));
 }
+
+TEST_F(FramebufferTest, ReverseZClearAndCompare)
+{
+	framebuffer->setReverseZ(true);
+	EXPECT_TRUE(framebuffer->isReverseZ());
+	EXPECT_FLOAT_EQ(framebuffer->getDepth(0, 0), 0.0f);
+
+	const __m128i x = _mm_set_epi32(3, 2, 1, 0);
+	const __m128i y = _mm_set1_epi32(0);
+	framebuffer->setDepth(x, y, _mm_set1_ps(0.5f), 0xF);
+
+	// greater depth is closer with reverse-Z
+	EXPECT_EQ(framebuffer->depthTest(x, y, _mm_set_ps(0.4f, 0.6f, 0.4f, 0.6f)), 0x5);
+
+	framebuffer->clearDepth();
+	EXPECT_FLOAT_EQ(framebuffer->getDepth(3, 0), 0.0f);
+}
+
+TEST_F(FramebufferTest, Unorm16DepthFormat)
+{
+	Framebuffer depth16(64, 64, DepthFormat::Unorm16);
+	EXPECT_EQ(depth16.getDepthFormat(), DepthFormat::Unorm16);
+	EXPECT_NE(depth16.getDepthBuffer16(), nullptr);
+	EXPECT_FLOAT_EQ(depth16.getDepth(0, 0), 1.0f);
+
+	const __m128i x = _mm_set_epi32(3, 2, 1, 0);
+	const __m128i y = _mm_set1_epi32(5);
+	depth16.setDepth(x, y, _mm_set1_ps(0.5f), 0xF);
+	EXPECT_NEAR(depth16.getDepth(2, 5), 0.5f, 1.0f / 65535.0f);
+
+	EXPECT_EQ(depth16.depthTest(x, y, _mm_set_ps(0.6f, 0.4f, 0.6f, 0.4f)), 0x5);
+
+	depth16.setDepth(x, y, _mm_set_ps(0.1f, 0.2f, 0.3f, 0.4f), 0x2);
+	EXPECT_NEAR(depth16.getDepth(1, 5), 0.3f, 1.0f / 65535.0f);
+	EXPECT_NEAR(depth16.getDepth(0, 5), 0.5f, 1.0f / 65535.0f);
+
+	depth16.setReverseZ(true);
+	EXPECT_FLOAT_EQ(depth16.getDepth(1, 5), 0.0f);
+	EXPECT_EQ(depth16.depthTest(x, y, _mm_set1_ps(0.25f)), 0xF);
+}
+
+TEST_F(FramebufferTest, DepthOnlyGather)
+{
+	Framebuffer depthOnly(64, 64, DepthFormat::Float32, false);
+	EXPECT_FALSE(depthOnly.hasColor());
+	EXPECT_TRUE(framebuffer->hasColor());
+
+	depthOnly.setDepth(_mm_set_epi32(3, 2, 1, 0), _mm_set1_epi32(7), _mm_set_ps(0.4f, 0.3f, 0.2f, 0.1f), 0xF);
+
+	// scattered lookups, including untouched texels
+	alignas(16) float gathered[4];
+	_mm_store_ps(gathered, depthOnly.gatherDepth(_mm_set_epi32(0, 3, 9, 1), _mm_set_epi32(7, 7, 7, 7)));
+	EXPECT_FLOAT_EQ(gathered[0], 0.2f);
+	EXPECT_FLOAT_EQ(gathered[1], 1.0f);
+	EXPECT_FLOAT_EQ(gathered[2], 0.4f);
+	EXPECT_FLOAT_EQ(gathered[3], 0.1f);
+
+	Framebuffer depth16(64, 64, DepthFormat::Unorm16, false);
+	depth16.setDepth(_mm_set1_epi32(5), _mm_set1_epi32(5), _mm_set1_ps(0.5f), 0x1);
+	_mm_store_ps(gathered, depth16.gatherDepth(_mm_set1_epi32(5), _mm_set_epi32(0, 0, 0, 5)));
+	EXPECT_NEAR(gathered[0], 0.5f, 1.0f / 65535.0f);
+	EXPECT_FLOAT_EQ(gathered[1], 1.0f);
+}
+
+TEST_F(FramebufferTest, BlendPixel)
+{
+	const __m128i x = _mm_setr_epi32(0, 1, 2, 3);
+	const __m128i y = _mm_setzero_si128();
+	framebuffer->setPixel(x, y, _mm_setr_epi32(0x0000FF, 0x00FF00, 0xFFFFFF, 0x102030), 0xF);
+
+	// half-transparent red, opaque red, a masked lane, half-transparent white
+	framebuffer->blendPixel(x, y, _mm_setr_epi32(0x800000FF, 0xFF0000FF, 0x00000000, 0x80FFFFFF), 0b1011);
+
+	const uint8_t* pixels = framebuffer->getColorBuffer();
+	EXPECT_EQ(pixels[0], 255);
+	EXPECT_EQ(pixels[3], 255);
+	EXPECT_EQ(pixels[4], 0);
+	EXPECT_EQ(pixels[6], 255);
+	EXPECT_EQ(pixels[7], 255);
+
+	// (255 * 128 + dst * 127) / 255, rounded
+	EXPECT_EQ(pixels[9], 152);
+	EXPECT_EQ(pixels[10], 144);
+	EXPECT_EQ(pixels[11], 136);
+}
+
+TEST_F(FramebufferTest, MultisampleResolve)
+{
+	EXPECT_THROW(framebuffer->setSampleCount(2), std::invalid_argument);
+	framebuffer->setSampleCount(4);
+	EXPECT_EQ(framebuffer->getSampleCount(), 4);
+
+	const __m128i x = _mm_setr_epi32(0, 1, 2, 3);
+	const __m128i y = _mm_setzero_si128();
+	for (int sample = 0; sample < 4; ++sample)
+	{
+		framebuffer->setPixel(x, y, _mm_set1_epi32(0xFF000000 | (sample * 80) << 8 | 0xFF), 0b0001, sample);
+		framebuffer->setPixel(x, y, _mm_set1_epi32(0xFFFFFFFF), sample < 2 ? 0b0010 : 0, sample);
+	}
+
+	// each sample keeps its own depth, single-sample queries read the first
+	framebuffer->setDepth(x, y, _mm_set1_ps(0.25f), 0b0001, 1);
+	EXPECT_FLOAT_EQ(framebuffer->getDepth(0, 0), 1.0f);
+	EXPECT_EQ(framebuffer->depthTest(x, y, _mm_set1_ps(0.5f), 0) & 1, 1);
+	EXPECT_EQ(framebuffer->depthTest(x, y, _mm_set1_ps(0.5f), 1) & 1, 0);
+
+	framebuffer->resolve();
+	const uint8_t* pixels = framebuffer->getColorBuffer();
+	EXPECT_EQ(pixels[0], 255);
+	EXPECT_EQ(pixels[1], 120); // (0 + 80 + 160 + 240) / 4
+	EXPECT_EQ(pixels[2], 0);
+	EXPECT_EQ(pixels[3], 128); // half the samples are white
+	EXPECT_EQ(pixels[6], 0);
+
+	framebuffer->setSampleCount(1);
+	EXPECT_EQ(framebuffer->getSampleCount(), 1);
+	EXPECT_EQ(framebuffer->getColorBuffer()[3], 0);
+}
+
+TEST_F(FramebufferTest, ViewportBounds)
+{
+	EXPECT_TRUE(framebuffer->isViewportFull());
+	EXPECT_THROW(framebuffer->setViewport({0, 0, 0, 10}), std::invalid_argument);
+	EXPECT_THROW(framebuffer->setViewport({700, 0, 200, 10}), std::invalid_argument);
+	EXPECT_THROW(framebuffer->setViewport({-1, 0, 10, 10}), std::invalid_argument);
+
+	framebuffer->setViewport({100, 50, 400, 300});
+	EXPECT_FALSE(framebuffer->isViewportFull());
+	EXPECT_EQ(framebuffer->getViewport().x, 100);
+	EXPECT_EQ(framebuffer->getViewport().height, 300);
+
+	framebuffer->resetViewport();
+	EXPECT_TRUE(framebuffer->isViewportFull());
+}
+
+TEST_F(FramebufferTest, ViewportClearAndResolve)
+{
+	framebuffer->setSampleCount(4);
+	const __m128i x = _mm_setr_epi32(8, 9, 10, 11);
+	const __m128i y = _mm_set1_epi32(5);
+	for (int sample = 0; sample < 4; ++sample)
+	{
+		framebuffer->setPixel(x, y, _mm_set1_epi32(0xFF0000FF), 0xF, sample);
+		framebuffer->setDepth(x, y, _mm_set1_ps(0.5f), 0xF, sample);
+	}
+
+	// only pixels 9 and 10 of each row lie inside the viewport
+	framebuffer->setViewport({9, 4, 2, 2});
+	framebuffer->resolve();
+	const uint8_t* pixels = framebuffer->getColorBuffer();
+	const size_t row = static_cast<size_t>(5) * width;
+	EXPECT_EQ(pixels[(row + 8) * 3], 0);
+	EXPECT_EQ(pixels[(row + 9) * 3], 255);
+	EXPECT_EQ(pixels[(row + 10) * 3], 255);
+	EXPECT_EQ(pixels[(row + 11) * 3], 0);
+
+	// clears leave every sample outside the viewport alone
+	framebuffer->clear();
+	framebuffer->clearDepth();
+	EXPECT_FLOAT_EQ(framebuffer->getDepth(8, 5), 0.5f);
+	EXPECT_FLOAT_EQ(framebuffer->getDepth(9, 5), 1.0f);
+	EXPECT_EQ(framebuffer->depthTest(x, y, _mm_set1_ps(0.75f), 3), 0b0110);
+
+	framebuffer->resetViewport();
+	framebuffer->resolve();
+	EXPECT_EQ(pixels[(row + 8) * 3], 255);
+	EXPECT_EQ(pixels[(row + 9) * 3], 0);
+	EXPECT_EQ(pixels[(row + 11) * 3], 255);
+}
+
+TEST_F(FramebufferTest, BilinearUpscale)
+{
+	// a 2x2 viewport at (4, 2) with a black and a red column, scaled up to 6x3
+	const __m128i y = _mm_setr_epi32(2, 2, 3, 3);
+	framebuffer->setPixel(_mm_setr_epi32(4, 5, 4, 5), y, _mm_setr_epi32(0, 0xFF, 0, 0xFF), 0xF);
+	framebuffer->setViewport({4, 2, 2, 2});
+
+	Framebuffer target(6, 3);
+	framebuffer->upscale(target);
+
+	// source x = (x + 0.5) / 3 - 0.5, clamped to the viewport
+	const uint8_t* pixels = target.getColorBuffer();
+	const int expected[6] = {0, 0, 85, 170, 255, 255};
+	for (int row = 0; row < 3; ++row)
+	{
+		for (int x = 0; x < 6; ++x)
+		{
+			EXPECT_NEAR(pixels[(row * 6 + x) * 3], expected[x], 1) << "x=" << x << " y=" << row;
+			EXPECT_EQ(pixels[(row * 6 + x) * 3 + 1], 0);
+		}
+	}
+}
@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+#include "../src/GBuffer.h"
+#include "../src/Material.h"
+#include <cmath>
+#include <stdexcept>
+
+TEST(GBufferTest, InvalidDimensions)
+{
+	EXPECT_THROW(GBuffer(0, 16), std::invalid_argument);
+	EXPECT_THROW(GBuffer(16, -1), std::invalid_argument);
+}
+
+TEST(GBufferTest, OctahedralNormalRoundTrip)
+{
+	const float normals[][3] = {
+		{0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, -1.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, -1.0f, 0.0f},
+		{0.6f, -0.48f, 0.64f}, {-0.36f, 0.48f, -0.8f}, {0.577f, 0.577f, -0.577f}, {-0.8f, -0.6f, 0.0f}
+	};
+
+	for (int i = 0; i < 8; i += 4)
+	{
+		const __m128 x = _mm_setr_ps(normals[i][0], normals[i + 1][0], normals[i + 2][0], normals[i + 3][0]);
+		const __m128 y = _mm_setr_ps(normals[i][1], normals[i + 1][1], normals[i + 2][1], normals[i + 3][1]);
+		const __m128 z = _mm_setr_ps(normals[i][2], normals[i + 1][2], normals[i + 2][2], normals[i + 3][2]);
+
+		__m128 decodedX, decodedY, decodedZ;
+		GBuffer::decodeNormal(GBuffer::encodeNormal(x, y, z), decodedX, decodedY, decodedZ);
+
+		alignas(16) float dx[4], dy[4], dz[4];
+		_mm_store_ps(dx, decodedX);
+		_mm_store_ps(dy, decodedY);
+		_mm_store_ps(dz, decodedZ);
+		for (int lane = 0; lane < 4; ++lane)
+		{
+			const float* expected = normals[i + lane];
+			const float length = std::sqrt(expected[0] * expected[0] + expected[1] * expected[1] +
+				expected[2] * expected[2]);
+			EXPECT_NEAR(dx[lane], expected[0] / length, 1e-3f);
+			EXPECT_NEAR(dy[lane], expected[1] / length, 1e-3f);
+			EXPECT_NEAR(dz[lane], expected[2] / length, 1e-3f);
+		}
+	}
+}
+
+TEST(GBufferTest, StoreIsTileLocal)
+{
+	GBuffer gbuffer(40, 20);
+	Material material;
+	const uint8_t id = gbuffer.addMaterial(&material);
+	EXPECT_EQ(id, 1);
+	EXPECT_EQ(gbuffer.addMaterial(&material), id);
+	EXPECT_EQ(gbuffer.getMaterial(id), &material);
+
+	// pixels of one tile row are consecutive, the next tile starts after a whole tile
+	EXPECT_EQ(gbuffer.getIndex(1, 0), gbuffer.getIndex(0, 0) + 1);
+	EXPECT_EQ(gbuffer.getIndex(0, 1), gbuffer.getIndex(0, 0) + GBuffer::TILE_SIZE);
+	EXPECT_EQ(gbuffer.getIndex(GBuffer::TILE_SIZE, 0), GBuffer::TILE_SIZE * GBuffer::TILE_SIZE);
+
+	// partial quad at the right edge of the buffer
+	const __m128 zero = _mm_setzero_ps();
+	gbuffer.store(_mm_setr_epi32(36, 37, 38, 39), _mm_set1_epi32(18), zero, zero, _mm_set1_ps(1.0f),
+	              _mm_set1_epi32(0x123456), id, 0b0101);
+
+	EXPECT_EQ(gbuffer.getMaterialIds()[gbuffer.getIndex(36, 18)], id);
+	EXPECT_EQ(gbuffer.getMaterialIds()[gbuffer.getIndex(37, 18)], 0);
+	EXPECT_EQ(gbuffer.getAlbedo()[gbuffer.getIndex(38, 18)], 0x123456u);
+
+	gbuffer.clear();
+	EXPECT_EQ(gbuffer.getMaterialIds()[gbuffer.getIndex(36, 18)], 0);
+	EXPECT_EQ(gbuffer.getMaterialCount(), 0);
+}
@@ -0,0 +1,37 @@
+#include <gtest/gtest.h>
+#include "../src/MappedFile.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+TEST(MappedFileTest, MapsWholeFile)
+{
+	const char* path = "test_mapped_file.bin";
+	const std::string contents = "mapped\nfile\0contents";
+	std::ofstream(path, std::ios::binary).write(contents.data(), static_cast<std::streamsize>(contents.size()));
+
+	{
+		const MappedFile file(path);
+		ASSERT_NE(file.data(), nullptr);
+		ASSERT_EQ(file.size(), contents.size());
+		EXPECT_EQ(std::memcmp(file.data(), contents.data(), contents.size()), 0);
+	}
+
+	std::remove(path);
+}
+
+TEST(MappedFileTest, MissingAndEmptyFiles)
+{
+	const MappedFile missing("non_existent_file.bin");
+	EXPECT_EQ(missing.data(), nullptr);
+	EXPECT_EQ(missing.size(), 0u);
+
+	const char* path = "test_mapped_empty.bin";
+	std::ofstream(path, std::ios::binary).close();
+	{
+		const MappedFile empty(path);
+		EXPECT_EQ(empty.data(), nullptr);
+		EXPECT_EQ(empty.size(), 0u);
+	}
+	std::remove(path);
+}
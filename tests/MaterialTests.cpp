@@ -95,3 +95,76 @@ TEST_F(MaterialTest, SharedTextureOwnership)
 		EXPECT_THROW(material2.setDiffuseTexture(sharedTexture), std::invalid_argument);
 	}
 }
+
+TEST_F(MaterialTest, TextureFilterOverride)
+{
+	EXPECT_FALSE(material->getTextureFilter().has_value());
+
+	material->setTextureFilter(TextureFilter::Trilinear);
+	ASSERT_TRUE(material->getTextureFilter().has_value());
+	EXPECT_EQ(*material->getTextureFilter(), TextureFilter::Trilinear);
+
+	material->setTextureFilter(std::nullopt);
+	EXPECT_FALSE(material->getTextureFilter().has_value());
+
+	EXPECT_FALSE(material->getTextureWrap().has_value());
+	material->setTextureWrap(std::pair{TextureWrap::Repeat, TextureWrap::ClampToEdge});
+	ASSERT_TRUE(material->getTextureWrap().has_value());
+	EXPECT_EQ(material->getTextureWrap()->first, TextureWrap::Repeat);
+	EXPECT_EQ(material->getTextureWrap()->second, TextureWrap::ClampToEdge);
+}
+
+TEST_F(MaterialTest, LightingAndDepthWriteFlags)
+{
+	EXPECT_TRUE(material->isLit());
+	EXPECT_TRUE(material->getDepthWrite());
+	EXPECT_FALSE(material->isVertexLighting());
+
+	material->setLit(false);
+	material->setDepthWrite(false);
+	material->setVertexLighting(true);
+	EXPECT_FALSE(material->isLit());
+	EXPECT_FALSE(material->getDepthWrite());
+	EXPECT_TRUE(material->isVertexLighting());
+}
+
+TEST_F(MaterialTest, AlphaMode)
+{
+	EXPECT_EQ(material->getAlphaMode(), AlphaMode::Opaque);
+	EXPECT_FLOAT_EQ(material->getAlphaCutoff(), 0.5f);
+
+	material->setAlphaMode(AlphaMode::Mask);
+	material->setAlphaCutoff(0.25f);
+	EXPECT_EQ(material->getAlphaMode(), AlphaMode::Mask);
+	EXPECT_FLOAT_EQ(material->getAlphaCutoff(), 0.25f);
+}
+
+TEST_F(MaterialTest, PendingTextureShowsPlaceholder)
+{
+	uint8_t grey[3] = { 0x80, 0x80, 0x80 };
+	const auto placeholder = std::make_shared<Texture>("");
+	placeholder->create(1, 1, grey);
+	const auto texture = std::make_shared<Texture>("");
+	texture->create(1, 1, grey);
+
+	std::promise<std::shared_ptr<const Texture>> promise;
+	material->setDiffuseTexture(promise.get_future().share(), placeholder);
+	EXPECT_TRUE(material->isDiffuseTexturePending());
+	EXPECT_EQ(material->getDiffuseTexture(), placeholder.get());
+	EXPECT_FALSE(material->resolveDiffuseTexture());
+	EXPECT_EQ(material->getDiffuseTexture(), placeholder.get());
+
+	promise.set_value(texture);
+	EXPECT_TRUE(material->resolveDiffuseTexture());
+	EXPECT_FALSE(material->isDiffuseTexturePending());
+	EXPECT_EQ(material->getDiffuseTexture(), texture.get());
+
+	// a failed load leaves the material untextured
+	std::promise<std::shared_ptr<const Texture>> failed;
+	material->setDiffuseTexture(failed.get_future().share(), placeholder);
+	failed.set_value(nullptr);
+	EXPECT_TRUE(material->resolveDiffuseTexture(true));
+	EXPECT_EQ(material->getDiffuseTexture(), nullptr);
+
+	EXPECT_THROW(material->setDiffuseTexture(std::shared_future<std::shared_ptr<const Texture>>(), placeholder), std::invalid_argument);
+}
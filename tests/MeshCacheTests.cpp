@@ -0,0 +1,194 @@
+#include <gtest/gtest.h>
+#include "../src/MeshCache.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+class MeshCacheTest : public testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		material = std::make_shared<Material>();
+
+		// two triangles, the second mesh spans two meshlets
+		VertexArray quad;
+		quad.positionsX = {0.0f, 1.0f, 0.0f, 1.0f, 1.0f, 0.0f};
+		quad.positionsY = {0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 1.0f};
+		quad.positionsZ = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+		quad.uvsU = {0.0f, 1.0f, 0.0f, 1.0f, 1.0f, 0.0f};
+		quad.uvsV = {1.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f};
+		quad.normalsX = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+		quad.normalsY = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+		quad.normalsZ = {1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f};
+		meshes.emplace_back(quad, material);
+
+		VertexArray strip;
+		const size_t count = (Mesh::MESHLET_MAX_TRIANGLES + 5) * 3;
+		strip.resize(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			strip.positionsX[i] = static_cast<float>(i / 3) + static_cast<float>(i % 3 == 1);
+			strip.positionsY[i] = static_cast<float>(i % 3 == 2);
+			strip.positionsZ[i] = -static_cast<float>(i) * 0.01f;
+			strip.uvsU[i] = static_cast<float>(i) * 0.5f;
+			strip.uvsV[i] = static_cast<float>(i) * 0.25f;
+			strip.normalsZ[i] = 1.0f;
+		}
+		meshes.emplace_back(strip, material);
+
+		materials = {{"textures/diffuse.png", false}, {"clamped.bmp", true}, {"", false}};
+	}
+
+	void TearDown() override
+	{
+		std::remove(cachePath);
+	}
+
+	static void expectSameStreams(const VertexArray& a, const VertexArray& b)
+	{
+		EXPECT_EQ(a.positionsX, b.positionsX);
+		EXPECT_EQ(a.positionsY, b.positionsY);
+		EXPECT_EQ(a.positionsZ, b.positionsZ);
+		EXPECT_EQ(a.uvsU, b.uvsU);
+		EXPECT_EQ(a.uvsV, b.uvsV);
+		EXPECT_EQ(a.normalsX, b.normalsX);
+		EXPECT_EQ(a.normalsY, b.normalsY);
+		EXPECT_EQ(a.normalsZ, b.normalsZ);
+	}
+
+	static constexpr const char* cachePath = "test_mesh.meshcache";
+
+	std::shared_ptr<Material> material;
+	std::vector<Mesh> meshes;
+	std::vector<MeshCacheMaterial> materials;
+};
+
+TEST_F(MeshCacheTest, RoundTrip)
+{
+	ASSERT_TRUE(writeMeshCache(cachePath, 42, materials, meshes, {1, -1}));
+
+	MeshCacheContents contents;
+	ASSERT_TRUE(readMeshCache(cachePath, 42, contents));
+
+	ASSERT_EQ(contents.materials.size(), 3u);
+	EXPECT_EQ(contents.materials[0].diffuseTexture, "textures/diffuse.png");
+	EXPECT_FALSE(contents.materials[0].clampTexture);
+	EXPECT_EQ(contents.materials[1].diffuseTexture, "clamped.bmp");
+	EXPECT_TRUE(contents.materials[1].clampTexture);
+	EXPECT_TRUE(contents.materials[2].diffuseTexture.empty());
+
+	ASSERT_EQ(contents.meshes.size(), 2u);
+	EXPECT_EQ(contents.meshes[0].material, 1);
+	EXPECT_EQ(contents.meshes[1].material, -1);
+
+	for (size_t i = 0; i < meshes.size(); ++i)
+	{
+		const MeshCacheEntry& entry = contents.meshes[i];
+		expectSameStreams(entry.vertices, meshes[i].getVertexArray());
+		EXPECT_EQ(entry.boundingBox.min, meshes[i].getBoundingBox().min);
+		EXPECT_EQ(entry.boundingBox.max, meshes[i].getBoundingBox().max);
+		EXPECT_EQ(entry.boundingSphere.center, meshes[i].getBoundingSphere().center);
+		EXPECT_EQ(entry.boundingSphere.radius, meshes[i].getBoundingSphere().radius);
+
+		ASSERT_EQ(entry.meshlets.size(), meshes[i].getMeshlets().size());
+		for (size_t m = 0; m < entry.meshlets.size(); ++m)
+		{
+			const Meshlet& expected = meshes[i].getMeshlets()[m];
+			EXPECT_EQ(entry.meshlets[m].firstTriangle, expected.firstTriangle);
+			EXPECT_EQ(entry.meshlets[m].triangleCount, expected.triangleCount);
+			EXPECT_EQ(entry.meshlets[m].bounds.center, expected.bounds.center);
+			EXPECT_EQ(entry.meshlets[m].coneAxis, expected.coneAxis);
+			EXPECT_EQ(entry.meshlets[m].coneCutoff, expected.coneCutoff);
+		}
+
+		// the entry rebuilds an identical mesh
+		const Mesh rebuilt(entry.vertices, material, entry.boundingBox, entry.boundingSphere, entry.meshlets);
+		EXPECT_EQ(rebuilt.getMeshlets().size(), meshes[i].getMeshlets().size());
+	}
+	EXPECT_EQ(contents.meshes[1].meshlets.size(), 2u);
+}
+
+TEST_F(MeshCacheTest, RejectsStaleAndMalformedFiles)
+{
+	MeshCacheContents contents;
+	EXPECT_FALSE(readMeshCache("non_existent.meshcache", 42, contents));
+
+	ASSERT_TRUE(writeMeshCache(cachePath, 42, materials, meshes, {0, 0}));
+	EXPECT_FALSE(readMeshCache(cachePath, 43, contents));
+	EXPECT_TRUE(contents.meshes.empty());
+
+	std::vector<char> bytes;
+	{
+		std::ifstream file(cachePath, std::ios::binary);
+		bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+
+	// truncated
+	{
+		std::ofstream file(cachePath, std::ios::binary | std::ios::trunc);
+		file.write(bytes.data(), static_cast<std::streamsize>(bytes.size() / 2));
+	}
+	EXPECT_FALSE(readMeshCache(cachePath, 42, contents));
+
+	// a material count larger than the file could hold is rejected before anything is allocated
+	std::vector<char> hugeCount = bytes;
+	constexpr uint32_t materialCount = 0xFFFFFFFF;
+	std::memcpy(hugeCount.data() + 24, &materialCount, 4);
+	{
+		std::ofstream file(cachePath, std::ios::binary | std::ios::trunc);
+		file.write(hugeCount.data(), static_cast<std::streamsize>(hugeCount.size()));
+	}
+	EXPECT_FALSE(readMeshCache(cachePath, 42, contents));
+
+	// wrong version
+	bytes[4] = static_cast<char>(MESH_CACHE_VERSION + 1);
+	{
+		std::ofstream file(cachePath, std::ios::binary | std::ios::trunc);
+		file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+	}
+	EXPECT_FALSE(readMeshCache(cachePath, 42, contents));
+
+	EXPECT_THROW(writeMeshCache(cachePath, 42, materials, meshes, {0}), std::invalid_argument);
+}
+
+TEST_F(MeshCacheTest, SourceHash)
+{
+	const char* sourcePath = "test_mesh_source.obj";
+	std::ofstream(sourcePath) << "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n";
+	const uint64_t original = hashMeshSource(sourcePath, "./");
+	EXPECT_NE(original, 0u);
+	EXPECT_EQ(hashMeshSource(sourcePath, "./"), original);
+
+	std::ofstream(sourcePath) << "v 0 0 0\nv 1 0 0\nv 0 2 0\nf 1 2 3\n";
+	EXPECT_NE(hashMeshSource(sourcePath, "./"), original);
+
+	// same bytes plus a trailing zero
+	std::ofstream(sourcePath, std::ios::binary) << "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n" << '\0';
+	EXPECT_NE(hashMeshSource(sourcePath, "./"), original);
+
+	std::remove(sourcePath);
+	EXPECT_EQ(hashMeshSource(sourcePath, "./"), 0u);
+}
+
+TEST_F(MeshCacheTest, SourceHashCoversMaterialLibraries)
+{
+	const char* sourcePath = "test_mesh_source.obj";
+	const char* libraryPath = "test_mesh_source.mtl";
+	std::ofstream(sourcePath) << "mtllib test_mesh_source.mtl\nv 0 0 0\nv 1 0 0\nv 0 1 0\nusemtl a\nf 1 2 3\n";
+
+	// creating the library, then editing it, both change the hash
+	const uint64_t missing = hashMeshSource(sourcePath, "./");
+	std::ofstream(libraryPath) << "newmtl a\nmap_Kd a.bmp\n";
+	const uint64_t original = hashMeshSource(sourcePath, "./");
+	EXPECT_NE(original, missing);
+	EXPECT_EQ(hashMeshSource(sourcePath, "./"), original);
+
+	std::ofstream(libraryPath) << "newmtl a\nmap_Kd -clamp on a.bmp\n";
+	EXPECT_NE(hashMeshSource(sourcePath, "./"), original);
+
+	std::remove(libraryPath);
+	EXPECT_EQ(hashMeshSource(sourcePath, "./"), missing);
+	std::remove(sourcePath);
+}
@@ -237,3 +237,98 @@ TEST_F(MeshTest, ComprehensiveValidation)
 	EXPECT_FLOAT_EQ(retrievedArray.positionsX[100], 100.0f);
 	EXPECT_FLOAT_EQ(retrievedArray.uvsU[200], 0.0f);
 }
+
+TEST_F(MeshTest, BoundsComputedAtConstruction)
+{
+	const Mesh mesh(vertexArray);
+
+	const BoundingBox& box = mesh.getBoundingBox();
+	EXPECT_EQ(box.min, glm::vec3(0.0f, 0.0f, 0.0f));
+	EXPECT_EQ(box.max, glm::vec3(1.0f, 1.0f, 0.0f));
+
+	const BoundingSphere& sphere = mesh.getBoundingSphere();
+	EXPECT_EQ(sphere.center, glm::vec3(0.5f, 0.5f, 0.0f));
+	EXPECT_NEAR(sphere.radius, std::sqrt(0.5f), 1e-6f);
+}
+
+TEST_F(MeshTest, MeshletPartitioning)
+{
+	// 150 copies of the fixture triangle
+	VertexArray strip;
+	for (int t = 0; t < 150; ++t)
+	{
+		for (int i = 0; i < 3; ++i)
+		{
+			strip.positionsX.push_back(vertexArray.positionsX[i] + static_cast<float>(t));
+			strip.positionsY.push_back(vertexArray.positionsY[i]);
+			strip.positionsZ.push_back(vertexArray.positionsZ[i]);
+			strip.uvsU.push_back(0.0f);
+			strip.uvsV.push_back(0.0f);
+			strip.normalsX.push_back(0.0f);
+			strip.normalsY.push_back(0.0f);
+			strip.normalsZ.push_back(1.0f);
+		}
+	}
+
+	const Mesh mesh(strip);
+	const auto& meshlets = mesh.getMeshlets();
+	ASSERT_EQ(meshlets.size(), 3);
+
+	uint32_t nextTriangle = 0;
+	for (const Meshlet& meshlet : meshlets)
+	{
+		EXPECT_EQ(meshlet.firstTriangle, nextTriangle);
+		EXPECT_LE(meshlet.triangleCount, Mesh::MESHLET_MAX_TRIANGLES);
+		nextTriangle += meshlet.triangleCount;
+
+		// flat cluster facing +z has a zero-width cone
+		EXPECT_NEAR(meshlet.coneAxis.z, 1.0f, 1e-5f);
+		EXPECT_NEAR(meshlet.coneCutoff, 0.0f, 1e-3f);
+	}
+	EXPECT_EQ(nextTriangle, 150);
+
+	// first cluster spans x in [0, 64]
+	EXPECT_NEAR(meshlets[0].bounds.center.x, 32.0f, 1e-4f);
+	EXPECT_GE(meshlets[0].bounds.radius, 32.0f);
+}
+
+TEST_F(MeshTest, MeshletConeDisabledForOpposingFaces)
+{
+	// the fixture triangle plus a copy with reversed winding
+	VertexArray twoSided = vertexArray;
+	twoSided.positionsX.insert(twoSided.positionsX.end(), {0.0f, 0.5f, 1.0f});
+	twoSided.positionsY.insert(twoSided.positionsY.end(), {0.0f, 1.0f, 0.0f});
+	twoSided.positionsZ.insert(twoSided.positionsZ.end(), {0.0f, 0.0f, 0.0f});
+	twoSided.uvsU.insert(twoSided.uvsU.end(), 3, 0.0f);
+	twoSided.uvsV.insert(twoSided.uvsV.end(), 3, 0.0f);
+	twoSided.normalsX.insert(twoSided.normalsX.end(), 3, 0.0f);
+	twoSided.normalsY.insert(twoSided.normalsY.end(), 3, 0.0f);
+	twoSided.normalsZ.insert(twoSided.normalsZ.end(), 3, 1.0f);
+
+	const Mesh mesh(twoSided);
+	ASSERT_EQ(mesh.getMeshlets().size(), 1);
+	EXPECT_GT(mesh.getMeshlets()[0].coneCutoff, 1.0f);
+}
+
+TEST_F(MeshTest, PrecomputedBoundsAndMeshlets)
+{
+	const BoundingBox box{glm::vec3(-5.0f), glm::vec3(5.0f)};
+	const BoundingSphere sphere{glm::vec3(0.0f), 9.0f};
+	Meshlet meshlet{};
+	meshlet.firstTriangle = 0;
+	meshlet.triangleCount = 1;
+	meshlet.coneCutoff = 2.0f;
+
+	// stored values are taken as given, not recomputed
+	const Mesh mesh(vertexArray, material, box, sphere, {meshlet});
+	EXPECT_EQ(mesh.getBoundingBox().max, box.max);
+	EXPECT_FLOAT_EQ(mesh.getBoundingSphere().radius, 9.0f);
+	ASSERT_EQ(mesh.getMeshlets().size(), 1u);
+	EXPECT_FLOAT_EQ(mesh.getMeshlets()[0].coneCutoff, 2.0f);
+
+	EXPECT_THROW(Mesh(vertexArray, material, box, sphere, {}), std::invalid_argument);
+	meshlet.firstTriangle = 1;
+	EXPECT_THROW(Mesh(vertexArray, material, box, sphere, {meshlet}), std::invalid_argument);
+	meshlet.firstTriangle = 0;
+	EXPECT_THROW(Mesh(vertexArray, nullptr, box, sphere, {meshlet}), std::invalid_argument);
+}
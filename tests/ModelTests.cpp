@@ -1,7 +1,11 @@
 #include <gtest/gtest.h>
 #include "../src/Model.h"
 #include "../src/Mesh.h"
+#include "TestBitmap.h"
 #include <glm/gtc/matrix_transform.hpp>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
 
 class ModelTest : public testing::Test
 {
@@ -254,3 +258,78 @@ TEST_F(ModelTest, NumericalStability)
 		EXPECT_FALSE(hasNaN);
 	}
 }
+
+TEST_F(ModelTest, MaterialsShareCachedTextures)
+{
+	writeTestBMP("test_shared_texture.bmp", 1, 1, 0x102030u);
+	{
+		std::ofstream mtl("test_shared.mtl");
+		mtl << "newmtl first\nmap_Kd test_shared_texture.bmp\n";
+		mtl << "newmtl second\nmap_Kd -clamp on test_shared_texture.bmp\n";
+	}
+	{
+		std::ofstream obj("test_shared.obj");
+		obj << "mtllib test_shared.mtl\n";
+		obj << "v 0 0 0\nv 1 0 0\nv 0 1 0\nv 1 1 0\n";
+		obj << "o first\nusemtl first\nf 1 2 3\n";
+		obj << "o second\nusemtl second\nf 2 4 3\n";
+	}
+
+	const Model model("./test_shared.obj");
+	const Model again("./test_shared.obj");
+
+	std::remove("test_shared_texture.bmp");
+	std::remove("test_shared.mtl");
+	std::remove("test_shared.obj");
+	std::remove("test_shared.obj.meshcache");
+
+	ASSERT_EQ(model.getMeshes().size(), 2u);
+	const Texture* texture = model.getMeshes()[0].getMaterial()->getDiffuseTexture();
+	ASSERT_NE(texture, nullptr);
+	EXPECT_EQ(model.getMeshes()[1].getMaterial()->getDiffuseTexture(), texture);
+	EXPECT_EQ(again.getMeshes()[0].getMaterial()->getDiffuseTexture(), texture);
+
+	// clamping and repeating materials share the one decoded image, each keeps its own wrap
+	EXPECT_EQ(model.getMeshes()[0].getMaterial()->getTextureWrap()->first, TextureWrap::Repeat);
+	EXPECT_EQ(model.getMeshes()[1].getMaterial()->getTextureWrap()->first, TextureWrap::ClampToEdge);
+}
+
+TEST_F(ModelTest, BinaryMeshCache)
+{
+	const char* objPath = "./test_cached.obj";
+	const char* cachePath = "./test_cached.obj.meshcache";
+	std::ofstream(objPath) << "v 0 0 0\nv 1 0 0\nv 0 1 0\nv 1 1 0\nvn 0 0 1\nvt 0 0\nvt 1 1\n"
+		"o a\nf 1/1/1 2/2/1 3/1/1\no b\nf 2/1/1 4/2/1 3/2/1\n";
+
+	const Model parsed(objPath);
+	ASSERT_TRUE(std::filesystem::exists(cachePath));
+
+	// the second load comes from the cache with identical geometry
+	const Model cached(objPath);
+	ASSERT_EQ(cached.getMeshes().size(), parsed.getMeshes().size());
+	for (size_t i = 0; i < parsed.getMeshes().size(); ++i)
+	{
+		const VertexArray& expected = parsed.getMeshes()[i].getVertexArray();
+		const VertexArray& actual = cached.getMeshes()[i].getVertexArray();
+		EXPECT_EQ(actual.positionsX, expected.positionsX);
+		EXPECT_EQ(actual.positionsY, expected.positionsY);
+		EXPECT_EQ(actual.uvsV, expected.uvsV);
+		EXPECT_EQ(actual.normalsZ, expected.normalsZ);
+		EXPECT_EQ(cached.getMeshes()[i].getMeshlets().size(), parsed.getMeshes()[i].getMeshlets().size());
+		EXPECT_EQ(cached.getMeshes()[i].getBoundingBox().max, parsed.getMeshes()[i].getBoundingBox().max);
+		EXPECT_NE(cached.getMeshes()[i].getMaterial(), nullptr);
+	}
+
+	// editing the obj invalidates the cache
+	std::ofstream(objPath) << "v 0 0 0\nv 2 0 0\nv 0 2 0\nf 1 2 3\n";
+	const Model edited(objPath);
+	ASSERT_EQ(edited.getMeshes().size(), 1u);
+	EXPECT_FLOAT_EQ(edited.getMeshes()[0].getBoundingBox().max.x, 2.0f);
+
+	const Model editedCached(objPath);
+	ASSERT_EQ(editedCached.getMeshes().size(), 1u);
+	EXPECT_FLOAT_EQ(editedCached.getMeshes()[0].getBoundingBox().max.x, 2.0f);
+
+	std::remove(objPath);
+	std::remove(cachePath);
+}
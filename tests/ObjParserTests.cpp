@@ -0,0 +1,144 @@
+#include <gtest/gtest.h>
+#include "../src/ObjParser.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+class ObjParserTest : public testing::Test
+{
+protected:
+	void TearDown() override
+	{
+		for (const std::string& path : paths)
+			std::remove(path.c_str());
+	}
+
+	void createFile(const std::string& path, const std::string& contents)
+	{
+		std::ofstream(path, std::ios::binary) << contents;
+		paths.push_back(path);
+	}
+
+	// grid of quads split over several objects and materials, with a mix of face formats
+	static std::string createGrid(const int size)
+	{
+		std::ostringstream obj;
+		obj << "# generated\nmtllib test_parser.mtl\n";
+		for (int y = 0; y <= size; ++y)
+		{
+			for (int x = 0; x <= size; ++x)
+			{
+				obj << "v " << x * 0.5f << ' ' << y * -0.25f << ' ' << (x ^ y) * 1e-3f << '\n';
+				obj << "vt " << x / static_cast<float>(size) << ' ' << y / static_cast<float>(size) << '\n';
+			}
+		}
+		obj << "vn 0 0 1\nvn 0 1 0\n";
+
+		for (int y = 0; y < size; ++y)
+		{
+			if (y % 3 == 0) obj << "o row" << y << '\n';
+			if (y % 2 == 0) obj << "usemtl " << (y % 4 == 0 ? "red" : "blue") << '\n';
+
+			for (int x = 0; x < size; ++x)
+			{
+				const int a = y * (size + 1) + x + 1;
+				const int b = a + 1;
+				const int c = a + size + 2;
+				const int d = a + size + 1;
+				switch ((x + y) % 3)
+				{
+				case 0: obj << "f " << a << '/' << a << "/1 " << b << '/' << b << "/1 " << c << '/' << c << "/2 " << d << '/' << d << "/1\n"; break;
+				case 1: obj << "f " << a << "//2 " << b << "//2 " << c << "//1\n\tf " << a << ' ' << c << ' ' << d << "\r\n"; break;
+				default: obj << "f " << a << '/' << a << ' ' << b << '/' << b << ' ' << c << '/' << c << ' ' << d << '/' << d << '\n'; break;
+				}
+			}
+		}
+		return obj.str();
+	}
+
+	std::vector<std::string> paths;
+};
+
+TEST_F(ObjParserTest, MatchesTinyObjAcrossChunkCounts)
+{
+	createFile("test_parser.mtl", "newmtl red\nKd 1 0 0\nmap_Kd red.png\nnewmtl blue\nKd 0 0 1\n");
+	createFile("test_parser.obj", createGrid(24));
+
+	tinyobj::attrib_t attrib;
+	std::vector<tinyobj::shape_t> shapes;
+	std::vector<tinyobj::material_t> materials;
+	std::string error;
+	ASSERT_TRUE(tinyobj::LoadObj(&attrib, &shapes, &materials, &error, "test_parser.obj", "./", true));
+
+	for (const size_t chunkCount : {1, 2, 7, 64})
+	{
+		SCOPED_TRACE(chunkCount);
+		const ObjData data = parseObj("test_parser.obj", "./", chunkCount);
+
+		EXPECT_EQ(data.positions, attrib.vertices);
+		EXPECT_EQ(data.texcoords, attrib.texcoords);
+		EXPECT_EQ(data.normals, attrib.normals);
+
+		ASSERT_EQ(data.materials.size(), materials.size());
+		EXPECT_EQ(data.materials[0].name, "red");
+		EXPECT_EQ(data.materials[0].diffuse_texname, "red.png");
+
+		ASSERT_EQ(data.shapes.size(), shapes.size());
+		for (size_t s = 0; s < shapes.size(); ++s)
+		{
+			const ObjShape& shape = data.shapes[s];
+			EXPECT_EQ(shape.name, shapes[s].name);
+			EXPECT_EQ(shape.materialId, shapes[s].mesh.material_ids[0]);
+			ASSERT_EQ(shape.corners.size(), shapes[s].mesh.indices.size());
+			for (size_t i = 0; i < shape.corners.size(); ++i)
+			{
+				EXPECT_EQ(shape.corners[i].position, shapes[s].mesh.indices[i].vertex_index);
+				EXPECT_EQ(shape.corners[i].texcoord, shapes[s].mesh.indices[i].texcoord_index);
+				EXPECT_EQ(shape.corners[i].normal, shapes[s].mesh.indices[i].normal_index);
+			}
+		}
+	}
+}
+
+TEST_F(ObjParserTest, RelativeIndicesAcrossChunks)
+{
+	// every face refers back with negative indices, chunks split between the vertices and their faces
+	std::ostringstream obj;
+	for (int i = 0; i < 40; ++i)
+	{
+		obj << "v " << i << " 0 0\nv " << i << " 1 0\nv " << i + 1 << " 0 0\nvn 0 0 1\n";
+		obj << "f -3//-1 -2//-1 -1//-1\n";
+	}
+	createFile("test_parser_relative.obj", obj.str());
+
+	for (const size_t chunkCount : {1, 3, 16})
+	{
+		const ObjData data = parseObj("test_parser_relative.obj", "./", chunkCount);
+		ASSERT_EQ(data.shapes.size(), 1u);
+		const ObjShape& shape = data.shapes[0];
+		ASSERT_EQ(shape.corners.size(), 120u);
+		for (int i = 0; i < 40; ++i)
+		{
+			EXPECT_EQ(shape.corners[i * 3 + 0].position, i * 3 + 0);
+			EXPECT_EQ(shape.corners[i * 3 + 2].position, i * 3 + 2);
+			EXPECT_EQ(shape.corners[i * 3 + 1].normal, i);
+			EXPECT_EQ(shape.corners[i * 3 + 1].texcoord, -1);
+		}
+	}
+}
+
+TEST_F(ObjParserTest, MalformedInput)
+{
+	createFile("test_parser_bad.obj", "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2\nf x y z\nf 1 2 3\nusemtl missing\nf 3 2 1");
+
+	const ObjData data = parseObj("test_parser_bad.obj", "./");
+	ASSERT_EQ(data.shapes.size(), 1u);
+	EXPECT_EQ(data.shapes[0].corners.size(), 6u);
+	EXPECT_EQ(data.shapes[0].materialId, -1);
+	EXPECT_NE(data.warnings.find("malformed"), std::string::npos);
+
+	createFile("test_parser_empty.obj", "");
+	EXPECT_TRUE(parseObj("test_parser_empty.obj", "./").shapes.empty());
+
+	EXPECT_THROW(parseObj("non_existent_file.obj", "./"), std::runtime_error);
+}
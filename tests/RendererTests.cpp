@@ -3,6 +3,7 @@
 #include "../src/Camera.h"
 #include "../src/Model.h"
 #include "../src/Framebuffer.h"
+#include <limits>
 
 class RendererTest : public testing::Test
 {
@@ -42,6 +43,15 @@ protected:
 		model = std::make_unique<Model>(meshes);
 	}
 
+	// colour of the pixel a world-space point projects to
+	const uint8_t* pixelAt(const glm::vec3& world) const
+	{
+		const glm::vec4 clip = camera->getViewProjectionMatrix() * glm::vec4(world, 1.0f);
+		const int x = static_cast<int>((clip.x / clip.w + 1.0f) * 0.5f * framebuffer->getWidth());
+		const int y = static_cast<int>((1.0f - clip.y / clip.w) * 0.5f * framebuffer->getHeight());
+		return framebuffer->getColorBuffer() + (y * framebuffer->getWidth() + x) * 3;
+	}
+
 	std::unique_ptr<Renderer> renderer;
 	std::unique_ptr<Framebuffer> framebuffer;
 	std::unique_ptr<Camera> camera;
@@ -269,3 +279,577 @@ TEST_F(RendererTest, RenderWithCorruptedData)
 	Model extremeModel(extremeMeshes);
 	EXPECT_NO_THROW(renderer->renderModel(*framebuffer, *camera, extremeModel));
 }
+
+TEST_F(RendererTest, ReverseZRendering)
+{
+	camera->setPosition(glm::vec3(0.0f, 0.0f, 2.0f));
+	camera->setReverseZ(true);
+
+	EXPECT_THROW(renderer->renderModel(*framebuffer, *camera, *model), std::invalid_argument);
+
+	framebuffer->setReverseZ(true);
+	framebuffer->clear();
+	EXPECT_NO_THROW(renderer->renderModel(*framebuffer, *camera, *model));
+
+	// the triangle covers the centre and sits between the planes
+	const float depth = framebuffer->getDepth(320, 240);
+	EXPECT_GT(depth, 0.0f);
+	EXPECT_LT(depth, 1.0f);
+}
+
+TEST_F(RendererTest, Unorm16DepthRendering)
+{
+	Framebuffer depth16(640, 480, DepthFormat::Unorm16);
+	camera->setPosition(glm::vec3(0.0f, 0.0f, 2.0f));
+
+	EXPECT_NO_THROW(renderer->renderModel(depth16, *camera, *model));
+	EXPECT_LT(depth16.getDepth(320, 240), 1.0f);
+}
+
+TEST_F(RendererTest, NearPlaneClipping)
+{
+	// one vertex sits behind the camera, the rest of the triangle is in view
+	VertexArray vertexArray;
+	vertexArray.resize(3);
+	vertexArray.positionsX = {0.0f, -4.0f, 4.0f};
+	vertexArray.positionsY = {1.0f, -1.0f, -1.0f};
+	vertexArray.positionsZ = {2.0f, -4.0f, -4.0f};
+	vertexArray.normalsZ = {1.0f, 1.0f, 1.0f};
+
+	Model crossingModel(std::vector<Mesh>{Mesh(vertexArray)});
+	camera->setPosition(glm::vec3(0.0f, 0.0f, 0.0f));
+
+	framebuffer->clear();
+	framebuffer->clearDepth();
+	renderer->renderModel(*framebuffer, *camera, crossingModel);
+
+	const uint8_t* colorBuffer = framebuffer->getColorBuffer();
+	int coveredPixels = 0;
+	for (int i = 0; i < framebuffer->getWidth() * framebuffer->getHeight(); ++i)
+	{
+		if (colorBuffer[i * 3] || colorBuffer[i * 3 + 1] || colorBuffer[i * 3 + 2]) ++coveredPixels;
+	}
+	EXPECT_GT(coveredPixels, 0);
+
+	// the part near the camera projects up past the top edge of the screen
+	EXPECT_LT(framebuffer->getDepth(framebuffer->getWidth() / 2, 0), 1.0f);
+	EXPECT_NE(colorBuffer[framebuffer->getWidth() / 2 * 3 + 1], 0);
+}
+
+TEST_F(RendererTest, GuardBandClipping)
+{
+	// far larger than the guard band in every direction
+	camera->setPosition(glm::vec3(0.0f, 0.0f, 2.0f));
+	model->setScale(glm::vec3(1e5f, 1e5f, 1.0f));
+	model->setPosition(glm::vec3(0.0f, 1e5f * 0.5f, 0.0f));
+
+	framebuffer->clear();
+	framebuffer->clearDepth();
+	EXPECT_NO_THROW(renderer->renderModel(*framebuffer, *camera, *model));
+
+	EXPECT_LT(framebuffer->getDepth(0, 0), 1.0f);
+	EXPECT_LT(framebuffer->getDepth(639, 479), 1.0f);
+}
+
+TEST_F(RendererTest, FillRuleSharedEdge)
+{
+	// two triangles of a quad, the shared diagonal runs exactly through pixel centres
+	auto makeTriangle = [](const std::vector<float>& xs, const std::vector<float>& ys)
+	{
+		VertexArray vertexArray;
+		vertexArray.resize(3);
+		vertexArray.positionsX = xs;
+		vertexArray.positionsY = ys;
+		vertexArray.normalsZ = {1.0f, 1.0f, 1.0f};
+		return Model(std::vector<Mesh>{Mesh(vertexArray)});
+	};
+	const Model lower = makeTriangle({-1.0f, 1.0f, 1.0f}, {-1.0f, -1.0f, 1.0f});
+	const Model upper = makeTriangle({-1.0f, 1.0f, -1.0f}, {-1.0f, 1.0f, 1.0f});
+
+	Camera squareCamera(glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(0.0f, 1.0f, 0.0f), -90.0f, 0.0f, 45.0f, 1.0f);
+
+	auto coverage = [&](const std::vector<const Model*>& models)
+	{
+		Framebuffer target(33, 33);
+		for (const Model* m : models)
+			renderer->renderModel(target, squareCamera, *m);
+
+		int covered = 0;
+		for (int y = 0; y < 33; ++y)
+			for (int x = 0; x < 33; ++x)
+				if (target.getDepth(x, y) < 1.0f) ++covered;
+		return std::make_pair(covered, std::move(target));
+	};
+
+	const int lowerCount = coverage({&lower}).first;
+	const int upperCount = coverage({&upper}).first;
+	auto [bothCount, both] = coverage({&lower, &upper});
+
+	EXPECT_GT(lowerCount, 0);
+	EXPECT_GT(upperCount, 0);
+
+	// no pixel is shaded twice, and none on the diagonal is missed
+	EXPECT_EQ(lowerCount + upperCount, bothCount);
+	for (int x = 4; x <= 28; ++x)
+	{
+		EXPECT_LT(both.getDepth(x, 32 - x), 1.0f) << "crack at x=" << x;
+	}
+}
+
+TEST_F(RendererTest, OffscreenMeshesSkipped)
+{
+	VertexArray hidden;
+	hidden.resize(3);
+	hidden.positionsX = {0.0f, -1.0f, 1.0f};
+	hidden.positionsY = {1.0f, -1.0f, -1.0f};
+	hidden.positionsZ = {0.0f, 0.0f, 0.0f};
+	hidden.normalsZ = {1.0f, 1.0f, 1.0f};
+
+	Mesh visibleMesh = model->getMeshes()[0];
+	Mesh hiddenMesh(hidden);
+
+	// in front of the camera but far off to the side, so only the frustum test rejects it
+	hiddenMesh.setLocalMatrix(glm::translate(glm::mat4(1.0f), glm::vec3(10.0f, 0.0f, 0.0f)));
+
+	Model mixed(std::vector<Mesh>{hiddenMesh, visibleMesh});
+	camera->setPosition(glm::vec3(0.0f, 0.0f, 2.0f));
+
+	framebuffer->clear();
+	framebuffer->clearDepth();
+	renderer->resetStats();
+	renderer->renderModel(*framebuffer, *camera, mixed);
+
+	EXPECT_LT(framebuffer->getDepth(320, 240), 1.0f);
+	EXPECT_EQ(renderer->getStats().culledMeshes, 1);
+	EXPECT_EQ(renderer->getStats().rasterizedTriangles, 1);
+}
+
+TEST_F(RendererTest, BackfacingMeshletsCulled)
+{
+	camera->setPosition(glm::vec3(0.0f, 0.0f, 2.0f));
+
+	renderer->resetStats();
+	renderer->renderModel(*framebuffer, *camera, *model);
+	EXPECT_EQ(renderer->getStats().culledMeshlets, 0);
+	EXPECT_EQ(renderer->getStats().rasterizedTriangles, 1);
+
+	// seen from behind, the cluster is dropped before any vertex is transformed
+	model->setRotation(glm::vec3(0.0f, 180.0f, 0.0f));
+	renderer->resetStats();
+	renderer->renderModel(*framebuffer, *camera, *model);
+	EXPECT_EQ(renderer->getStats().culledMeshlets, 1);
+	EXPECT_EQ(renderer->getStats().rasterizedTriangles, 0);
+
+	// mirrored transforms flip the winding and skip cone culling
+	model->setModelMatrix(glm::scale(glm::mat4(1.0f), glm::vec3(-1.0f, 1.0f, 1.0f)));
+	renderer->resetStats();
+	renderer->renderModel(*framebuffer, *camera, *model);
+	EXPECT_EQ(renderer->getStats().culledMeshlets, 0);
+}
+
+TEST_F(RendererTest, PipelineStateFromMaterial)
+{
+	const DrawState untextured = Renderer::resolveDrawState(nullptr);
+	EXPECT_EQ(untextured.pipeline, PIPELINE_DEPTH_WRITE);
+	EXPECT_EQ(untextured.diffuseMap, nullptr);
+
+	Material material;
+	EXPECT_EQ(Renderer::resolveDrawState(&material).pipeline, PIPELINE_LIT | PIPELINE_DEPTH_WRITE);
+
+	const uint8_t texels[4 * 4 * 3] = {};
+	auto texture = std::make_shared<Texture>("");
+	texture->create(4, 4, texels);
+	material.setDiffuseTexture(texture);
+	material.setTextureFilter(TextureFilter::Bilinear);
+	material.setLit(false);
+	material.setDepthWrite(false);
+
+	const DrawState textured = Renderer::resolveDrawState(&material);
+	EXPECT_EQ(textured.pipeline, PIPELINE_TEXTURED | PIPELINE_MIPMAPPED);
+	EXPECT_EQ(textured.diffuseMap, texture.get());
+	EXPECT_EQ(textured.filter, TextureFilter::Bilinear);
+	EXPECT_EQ(textured.wrapU, TextureWrap::ClampToEdge);
+
+	// the material's wrap modes win over the texture's own
+	texture->setWrap(TextureWrap::MirroredRepeat, TextureWrap::MirroredRepeat);
+	EXPECT_EQ(Renderer::resolveDrawState(&material).wrapV, TextureWrap::MirroredRepeat);
+	material.setTextureWrap(std::pair{TextureWrap::Repeat, TextureWrap::ClampToEdge});
+	const DrawState wrapped = Renderer::resolveDrawState(&material);
+	EXPECT_EQ(wrapped.wrapU, TextureWrap::Repeat);
+	EXPECT_EQ(wrapped.wrapV, TextureWrap::ClampToEdge);
+}
+
+TEST_F(RendererTest, UnlitAndDepthWriteVariants)
+{
+	const uint8_t texel[3] = {200, 100, 50};
+	auto texture = std::make_shared<Texture>("");
+	texture->create(1, 1, texel);
+	auto material = std::make_shared<Material>();
+	material->setDiffuseTexture(texture);
+	material->setLit(false);
+
+	Mesh mesh = model->getMeshes()[0];
+	mesh.setMaterial(material);
+	const Model unlit(std::vector<Mesh>{mesh});
+	camera->setPosition(glm::vec3(0.0f, 0.0f, 2.0f));
+
+	// unlit output is the texel itself
+	renderer->renderModel(*framebuffer, *camera, unlit);
+	const uint8_t* pixel = framebuffer->getColorBuffer() + (240 * 640 + 320) * 3;
+	EXPECT_EQ(pixel[0], 200);
+	EXPECT_EQ(pixel[1], 100);
+	EXPECT_EQ(pixel[2], 50);
+	EXPECT_LT(framebuffer->getDepth(320, 240), 1.0f);
+
+	// without depth writes the colour lands but the depth buffer keeps its clear value
+	Framebuffer target(640, 480);
+	material->setDepthWrite(false);
+	renderer->renderModel(target, *camera, unlit);
+	EXPECT_EQ(target.getColorBuffer()[(240 * 640 + 320) * 3], 200);
+	EXPECT_EQ(target.getDepth(320, 240), 1.0f);
+}
+
+TEST_F(RendererTest, PointLightsOnlyReachTheirTiles)
+{
+	Mesh mesh = model->getMeshes()[0];
+	mesh.setMaterial(std::make_shared<Material>());
+	const Model lit(std::vector<Mesh>{mesh});
+
+	camera->setPosition(glm::vec3(0.0f, 0.0f, 2.0f));
+	renderer->clearLights();
+	renderer->getDefaultShader().setAmbientIntensity(0.0f);
+
+	// small red light just in front of the bottom left of the triangle
+	renderer->addLight(Light::point(glm::vec3(-0.5f, -0.5f, 0.2f), 0.5f, glm::vec3(1.0f, 0.0f, 0.0f), 4.0f));
+	renderer->renderModel(*framebuffer, *camera, lit);
+
+	const uint8_t* nearLight = pixelAt(glm::vec3(-0.5f, -0.5f, 0.0f));
+	EXPECT_GT(nearLight[0], 200);
+	EXPECT_EQ(nearLight[1], 0);
+
+	// out of range, and in tiles the light is culled from
+	EXPECT_EQ(pixelAt(glm::vec3(0.5f, -0.5f, 0.0f))[0], 0);
+	EXPECT_EQ(pixelAt(glm::vec3(0.0f, 0.6f, 0.0f))[0], 0);
+}
+
+TEST_F(RendererTest, EveryOverlappingLightIsShaded)
+{
+	Mesh mesh = model->getMeshes()[0];
+	mesh.setMaterial(std::make_shared<Material>());
+	const Model lit(std::vector<Mesh>{mesh});
+
+	camera->setPosition(glm::vec3(0.0f, 0.0f, 2.0f));
+	renderer->clearLights();
+	renderer->getDefaultShader().setAmbientIntensity(0.0f);
+
+	// a hundred black lights over the same tiles come before the one that adds color
+	for (int i = 0; i < 100; ++i)
+		renderer->addLight(Light::point(glm::vec3(-0.5f, -0.5f, 0.2f), 0.5f, glm::vec3(0.0f), 4.0f));
+	renderer->addLight(Light::point(glm::vec3(-0.5f, -0.5f, 0.2f), 0.5f, glm::vec3(1.0f, 0.0f, 0.0f), 4.0f));
+	renderer->renderModel(*framebuffer, *camera, lit);
+
+	EXPECT_GT(pixelAt(glm::vec3(-0.5f, -0.5f, 0.0f))[0], 200);
+}
+
+TEST_F(RendererTest, SpotLightCone)
+{
+	Mesh mesh = model->getMeshes()[0];
+	mesh.setMaterial(std::make_shared<Material>());
+	const Model lit(std::vector<Mesh>{mesh});
+
+	camera->setPosition(glm::vec3(0.0f, 0.0f, 2.0f));
+	renderer->setLights({Light::spot(glm::vec3(0.0f, -0.4f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f), 5.0f, 5.0f, 10.0f)});
+	renderer->getDefaultShader().setAmbientIntensity(0.0f);
+	renderer->renderModel(*framebuffer, *camera, lit);
+
+	// the cone reaches about 0.18 units around its axis on the triangle
+	EXPECT_GT(pixelAt(glm::vec3(0.0f, -0.4f, 0.0f))[0], 150);
+	EXPECT_EQ(pixelAt(glm::vec3(0.5f, -0.4f, 0.0f))[0], 0);
+}
+
+TEST_F(RendererTest, PerVertexLighting)
+{
+	auto material = std::make_shared<Material>();
+	material->setVertexLighting(true);
+	EXPECT_EQ(Renderer::resolveDrawState(material.get()).pipeline,
+	          PIPELINE_LIT | PIPELINE_VERTEX_LIT | PIPELINE_DEPTH_WRITE);
+
+	Mesh mesh = model->getMeshes()[0];
+	mesh.setMaterial(material);
+	const Model vertexLit(std::vector<Mesh>{mesh});
+
+	camera->setPosition(glm::vec3(0.0f, 0.0f, 2.0f));
+	renderer->setLights({Light::directional(glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(1.0f, 0.5f, 0.0f), 0.5f)});
+	renderer->renderModel(*framebuffer, *camera, vertexLit);
+
+	// flat normals under a directional light give the per-pixel result: (0.2 ambient + 0.5 * color) * 255
+	const uint8_t* pixel = pixelAt(glm::vec3(0.0f, -0.2f, 0.0f));
+	EXPECT_NEAR(pixel[0], 179, 1);
+	EXPECT_NEAR(pixel[1], 115, 1);
+	EXPECT_NEAR(pixel[2], 51, 1);
+}
+
+TEST_F(RendererTest, AlphaTestAndBlending)
+{
+	// unlit single-texel materials: opaque green, masked out, half-transparent red
+	auto makeMaterial = [](const uint32_t rgba, const AlphaMode alphaMode)
+	{
+		const uint8_t texel[4] = {
+			static_cast<uint8_t>(rgba), static_cast<uint8_t>(rgba >> 8), static_cast<uint8_t>(rgba >> 16),
+			static_cast<uint8_t>(rgba >> 24)
+		};
+		auto texture = std::make_shared<Texture>("");
+		texture->create(1, 1, texel, 4);
+		auto material = std::make_shared<Material>();
+		material->setDiffuseTexture(texture);
+		material->setLit(false);
+		material->setAlphaMode(alphaMode);
+		return material;
+	};
+	auto makeMesh = [&](const float z, const std::shared_ptr<Material>& material)
+	{
+		VertexArray vertices = model->getMeshes()[0].getVertexArray();
+		vertices.positionsZ = {z, z, z};
+		return Mesh(vertices, material);
+	};
+
+	const auto blended = makeMaterial(0x800000FF, AlphaMode::Blend);
+	const DrawState blendState = Renderer::resolveDrawState(blended.get());
+	EXPECT_EQ(blendState.pipeline, PIPELINE_TEXTURED | PIPELINE_BLEND);
+
+	const auto masked = makeMaterial(0x10FFFFFF, AlphaMode::Mask);
+	const DrawState maskState = Renderer::resolveDrawState(masked.get());
+	EXPECT_EQ(maskState.pipeline, PIPELINE_TEXTURED | PIPELINE_ALPHA_TEST | PIPELINE_DEPTH_WRITE);
+	EXPECT_EQ(maskState.alphaCutoff, 128);
+
+	// the blended mesh comes first but is drawn after the opaque one behind it,
+	// and the masked mesh in front neither colours nor occludes
+	const Model scene(std::vector<Mesh>{
+		makeMesh(0.5f, blended), makeMesh(0.0f, makeMaterial(0xFF00FF00, AlphaMode::Opaque)),
+		makeMesh(0.8f, masked)
+	});
+	camera->setPosition(glm::vec3(0.0f, 0.0f, 2.0f));
+	renderer->renderModel(*framebuffer, *camera, scene);
+
+	// the blended mesh waits for the end of the frame
+	const uint8_t* pixel = pixelAt(glm::vec3(0.0f, -0.2f, 0.0f));
+	EXPECT_EQ(pixel[0], 0);
+	renderer->renderTransparent(*framebuffer, *camera);
+
+	EXPECT_NEAR(pixel[0], 128, 1);
+	EXPECT_NEAR(pixel[1], 127, 1);
+	EXPECT_EQ(pixel[2], 0);
+}
+
+TEST_F(RendererTest, TransparentPassSortsAcrossModels)
+{
+	// unlit half-transparent red in front of half-transparent blue
+	auto makeModel = [&](const float z, const uint32_t rgba)
+	{
+		const uint8_t texel[4] = {
+			static_cast<uint8_t>(rgba), static_cast<uint8_t>(rgba >> 8), static_cast<uint8_t>(rgba >> 16),
+			static_cast<uint8_t>(rgba >> 24)
+		};
+		auto texture = std::make_shared<Texture>("");
+		texture->create(1, 1, texel, 4);
+		auto material = std::make_shared<Material>();
+		material->setDiffuseTexture(texture);
+		material->setLit(false);
+		material->setAlphaMode(AlphaMode::Blend);
+
+		VertexArray vertices = model->getMeshes()[0].getVertexArray();
+		vertices.positionsZ = {z, z, z};
+		return Model(std::vector<Mesh>{Mesh(vertices, material)});
+	};
+	const Model front = makeModel(0.5f, 0x800000FF);
+	const Model back = makeModel(0.0f, 0x80FF0000);
+
+	// submitted front first in separate models, blended back to front at the end of the frame
+	camera->setPosition(glm::vec3(0.0f, 0.0f, 2.0f));
+	renderer->renderModel(*framebuffer, *camera, front);
+	renderer->renderModel(*framebuffer, *camera, back);
+	renderer->renderTransparent(*framebuffer, *camera);
+
+	const uint8_t* pixel = pixelAt(glm::vec3(0.0f, -0.2f, 0.0f));
+	EXPECT_NEAR(pixel[0], 128, 1);
+	EXPECT_EQ(pixel[1], 0);
+	EXPECT_NEAR(pixel[2], 64, 1);
+
+	// the queue is empty once drawn
+	framebuffer->clear();
+	renderer->renderTransparent(*framebuffer, *camera);
+	EXPECT_EQ(pixel[0], 0);
+}
+
+TEST_F(RendererTest, DeferredMatchesForward)
+{
+	Mesh mesh = model->getMeshes()[0];
+	mesh.setMaterial(std::make_shared<Material>());
+	const Model lit(std::vector<Mesh>{mesh});
+
+	camera->setPosition(glm::vec3(0.0f, 0.0f, 2.0f));
+	renderer->setLights({
+		Light::directional(glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 0.0f, 1.0f), 0.5f),
+		Light::point(glm::vec3(-0.5f, -0.5f, 0.2f), 0.5f, glm::vec3(1.0f, 0.0f, 0.0f), 4.0f)
+	});
+	renderer->renderModel(*framebuffer, *camera, lit);
+
+	Framebuffer deferred(640, 480);
+	GBuffer gbuffer(640, 480);
+	renderer->renderModelDeferred(gbuffer, deferred, *camera, lit);
+	EXPECT_EQ(gbuffer.getMaterialCount(), 1);
+	renderer->resolveDeferred(gbuffer, deferred, *camera);
+
+	// normals lose a little precision in the G-buffer
+	for (const glm::vec3& point : {glm::vec3(-0.5f, -0.5f, 0.0f), glm::vec3(0.5f, -0.5f, 0.0f),
+	                               glm::vec3(0.0f, 0.6f, 0.0f)})
+	{
+		const uint8_t* forwardPixel = pixelAt(point);
+		const uint8_t* deferredPixel = deferred.getColorBuffer() + (forwardPixel - framebuffer->getColorBuffer());
+		for (int channel = 0; channel < 3; ++channel)
+		{
+			EXPECT_NEAR(forwardPixel[channel], deferredPixel[channel], 2);
+		}
+	}
+
+	// the background is left alone
+	EXPECT_EQ(deferred.getColorBuffer()[0], framebuffer->getColorBuffer()[0]);
+}
+
+TEST_F(RendererTest, DeferredRequiresMatchingSizes)
+{
+	GBuffer gbuffer(320, 240);
+	EXPECT_THROW(renderer->renderModelDeferred(gbuffer, *framebuffer, *camera, *model), std::invalid_argument);
+	EXPECT_THROW(renderer->resolveDeferred(gbuffer, *framebuffer, *camera), std::invalid_argument);
+}
+
+TEST_F(RendererTest, MultisampledEdges)
+{
+	renderer->renderModel(*framebuffer, *camera, *model);
+
+	Framebuffer multisampled(640, 480);
+	multisampled.setSampleCount(4);
+	renderer->renderModel(multisampled, *camera, *model);
+	multisampled.resolve();
+
+	// interiors are shaded exactly as before, edges get partial coverage
+	const uint8_t* aliased = framebuffer->getColorBuffer();
+	const uint8_t* smooth = multisampled.getColorBuffer();
+	const size_t centre = pixelAt(glm::vec3(0.0f, -0.2f, 0.0f)) - aliased;
+	EXPECT_EQ(smooth[centre], aliased[centre]);
+	EXPECT_GT(smooth[centre], 0);
+
+	int partial = 0;
+	int64_t aliasedSum = 0, smoothSum = 0;
+	for (size_t i = 0; i < 640 * 480 * 3; i += 3)
+	{
+		if (smooth[i] > 0 && smooth[i] < aliased[centre]) ++partial;
+		aliasedSum += aliased[i];
+		smoothSum += smooth[i];
+	}
+	EXPECT_GT(partial, 100);
+	EXPECT_NEAR(static_cast<double>(smoothSum), static_cast<double>(aliasedSum), aliasedSum * 0.02);
+}
+
+TEST_F(RendererTest, DeferredRejectsMultisampling)
+{
+	framebuffer->setSampleCount(4);
+	GBuffer gbuffer(640, 480);
+	EXPECT_THROW(renderer->renderModelDeferred(gbuffer, *framebuffer, *camera, *model), std::invalid_argument);
+	EXPECT_THROW(renderer->resolveDeferred(gbuffer, *framebuffer, *camera), std::invalid_argument);
+}
+
+TEST_F(RendererTest, ViewportConfinesRendering)
+{
+	renderer->renderModel(*framebuffer, *camera, *model);
+
+	// the same image at half size in the top-right quarter
+	Framebuffer quarter(640, 480);
+	quarter.setViewport({320, 0, 320, 240});
+	renderer->renderModel(quarter, *camera, *model);
+
+	int inside = 0;
+	for (int y = 0; y < 480; ++y)
+	{
+		for (int x = 0; x < 640; ++x)
+		{
+			const bool covered = quarter.getDepth(x, y) < 1.0f;
+			if (x < 320 || y >= 240)
+				EXPECT_FALSE(covered) << "outside the viewport at " << x << ", " << y;
+			else if (covered)
+				++inside;
+		}
+	}
+
+	int full = 0;
+	for (int i = 0; i < 640 * 480; ++i)
+		if (framebuffer->getDepthBuffer()[i] < 1.0f) ++full;
+	EXPECT_NEAR(inside * 4.0, full, full * 0.02);
+
+	// the centre of the full image lands at the centre of the viewport
+	const size_t centre = pixelAt(glm::vec3(0.0f, -0.2f, 0.0f)) - framebuffer->getColorBuffer();
+	const int centreX = static_cast<int>(centre / 3 % 640);
+	const int centreY = static_cast<int>(centre / 3 / 640);
+	EXPECT_LT(quarter.getDepth(320 + centreX / 2, centreY / 2), 1.0f);
+
+	GBuffer gbuffer(640, 480);
+	EXPECT_THROW(renderer->renderModelDeferred(gbuffer, quarter, *camera, *model), std::invalid_argument);
+}
+
+TEST_F(RendererTest, DynamicResolution)
+{
+	// no budget draws straight into the output
+	EXPECT_EQ(&renderer->beginFrame(*framebuffer), framebuffer.get());
+	renderer->endFrame(*framebuffer);
+	EXPECT_THROW(renderer->setFrameTimeBudget(-1.0f), std::invalid_argument);
+	EXPECT_THROW(renderer->setFrameTimeBudget(std::numeric_limits<float>::infinity()), std::invalid_argument);
+	EXPECT_THROW(renderer->setFrameTimeBudget(std::numeric_limits<float>::quiet_NaN()), std::invalid_argument);
+
+	// a budget no frame can meet drops to the minimum scale
+	renderer->setFrameTimeBudget(1e-6f);
+	for (int frame = 0; frame < 8; ++frame)
+	{
+		Framebuffer& target = renderer->beginFrame(*framebuffer);
+		EXPECT_NE(&target, framebuffer.get());
+		target.clear();
+		target.clearDepth();
+		renderer->renderModel(target, *camera, *model);
+		renderer->endFrame(*framebuffer);
+	}
+	EXPECT_FLOAT_EQ(renderer->getRenderScale(), 0.25f);
+
+	const Viewport& viewport = renderer->beginFrame(*framebuffer).getViewport();
+	EXPECT_EQ(viewport.width, 160);
+	EXPECT_EQ(viewport.height, 120);
+	renderer->endFrame(*framebuffer);
+
+	// the upscaled triangle covers the middle of the output, the corners stay clear
+	const uint8_t* pixel = pixelAt(glm::vec3(0.0f, -0.2f, 0.0f));
+	EXPECT_GT(pixel[0] + pixel[1] + pixel[2], 0);
+	EXPECT_EQ(framebuffer->getColorBuffer()[0], 0);
+
+	// the internal target keeps its own sample count, the output stays single-sampled
+	renderer->beginFrame(*framebuffer).setSampleCount(4);
+	renderer->endFrame(*framebuffer);
+	EXPECT_EQ(renderer->beginFrame(*framebuffer).getSampleCount(), 4);
+	EXPECT_EQ(framebuffer->getSampleCount(), 1);
+	renderer->endFrame(*framebuffer);
+
+	// a generous budget climbs back to full size, at most half again per frame
+	renderer->setFrameTimeBudget(1e6f);
+	EXPECT_FLOAT_EQ(renderer->getRenderScale(), 0.25f);
+	renderer->beginFrame(*framebuffer);
+	renderer->endFrame(*framebuffer);
+	EXPECT_FLOAT_EQ(renderer->getRenderScale(), 0.375f);
+	for (int frame = 0; frame < 3; ++frame)
+	{
+		renderer->beginFrame(*framebuffer);
+		renderer->endFrame(*framebuffer);
+	}
+	EXPECT_FLOAT_EQ(renderer->getRenderScale(), 1.0f);
+	EXPECT_TRUE(renderer->beginFrame(*framebuffer).isViewportFull());
+	renderer->endFrame(*framebuffer);
+
+	renderer->setFrameTimeBudget(0.0f);
+	EXPECT_EQ(&renderer->beginFrame(*framebuffer), framebuffer.get());
+}
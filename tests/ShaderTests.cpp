@@ -0,0 +1,192 @@
+#include <gtest/gtest.h>
+#include "../src/Shader.h"
+#include "../src/Renderer.h"
+#include "../src/Camera.h"
+#include "../src/Model.h"
+#include "../src/Framebuffer.h"
+
+namespace
+{
+	class SolidShader : public Shader<SolidShader>
+	{
+	public:
+		__m128i fragment(const FragmentQuad&, const DrawState&) const
+		{
+			return _mm_set1_epi32(0x3020FF);
+		}
+	};
+
+	// moves geometry in clip space, so the triangle lands to the right of the screen centre
+	class OffsetShader : public Shader<OffsetShader>
+	{
+	public:
+		void vertex(const VertexInput& input, const VertexUniforms& uniforms, ClipVertex& output) const
+		{
+			output.position = uniforms.mvp * glm::vec4(input.position, 1.0f);
+			output.position.x += output.position.w * 0.5f;
+			output.worldPosition = glm::vec3(uniforms.model * glm::vec4(input.position, 1.0f));
+			output.u = input.u;
+			output.v = input.v;
+			output.normal = input.normal;
+		}
+
+		__m128i fragment(const FragmentQuad&, const DrawState&) const
+		{
+			return _mm_set1_epi32(0xFFFFFF);
+		}
+	};
+
+	// writes the interpolated normal as a colour, black when the pipeline has no normals
+	class NormalShader : public Shader<NormalShader>
+	{
+	public:
+		template <uint32_t Pipeline>
+		__m128i fragment(const FragmentQuad& quad, const DrawState&) const
+		{
+			if constexpr ((Pipeline & PIPELINE_LIT) == 0)
+			{
+				return _mm_setzero_si128();
+			}
+			else
+			{
+				const __m128 scale = _mm_set1_ps(255.0f);
+				const __m128i b = _mm_cvtps_epi32(_mm_mul_ps(quad.normalZ, scale));
+				return _mm_slli_epi32(b, 16);
+			}
+		}
+	};
+}
+
+class ShaderTest : public testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		renderer = std::make_unique<Renderer>();
+		framebuffer = std::make_unique<Framebuffer>(640, 480);
+		camera = std::make_unique<Camera>(
+			glm::vec3(0.0f, 0.0f, 2.0f),
+			glm::vec3(0.0f, 1.0f, 0.0f),
+			-90.0f, 0.0f, 45.0f,
+			640.0f / 480.0f, 0.1f, 100.0f
+		);
+
+		VertexArray vertexArray;
+		vertexArray.resize(3);
+		vertexArray.positionsX = {0.0f, -1.0f, 1.0f};
+		vertexArray.positionsY = {1.0f, -1.0f, -1.0f};
+		vertexArray.positionsZ = {0.0f, 0.0f, 0.0f};
+		vertexArray.uvsU = {0.5f, 0.0f, 1.0f};
+		vertexArray.uvsV = {0.0f, 1.0f, 1.0f};
+		vertexArray.normalsX = {0.0f, 0.0f, 0.0f};
+		vertexArray.normalsY = {0.0f, 0.0f, 0.0f};
+		vertexArray.normalsZ = {1.0f, 1.0f, 1.0f};
+
+		material = std::make_shared<Material>();
+		model = std::make_unique<Model>(std::vector<Mesh>{Mesh(vertexArray, material)});
+	}
+
+	const uint8_t* pixel(const int x, const int y) const
+	{
+		return framebuffer->getColorBuffer() + (y * 640 + x) * 3;
+	}
+
+	std::unique_ptr<Renderer> renderer;
+	std::unique_ptr<Framebuffer> framebuffer;
+	std::unique_ptr<Camera> camera;
+	std::shared_ptr<Material> material;
+	std::unique_ptr<Model> model;
+};
+
+TEST_F(ShaderTest, MaterialShaderReplacesDefault)
+{
+	material->setShader(std::make_shared<SolidShader>());
+	EXPECT_NE(material->getShader(), nullptr);
+
+	renderer->renderModel(*framebuffer, *camera, *model);
+	EXPECT_EQ(pixel(320, 240)[0], 0xFF);
+	EXPECT_EQ(pixel(320, 240)[1], 0x20);
+	EXPECT_EQ(pixel(320, 240)[2], 0x30);
+	EXPECT_LT(framebuffer->getDepth(320, 240), 1.0f);
+}
+
+TEST_F(ShaderTest, CustomVertexProgram)
+{
+	material->setShader(std::make_shared<OffsetShader>());
+	renderer->renderModel(*framebuffer, *camera, *model);
+
+	// shifted by a quarter of the screen width
+	EXPECT_EQ(pixel(480, 240)[0], 0xFF);
+	EXPECT_EQ(pixel(200, 240)[0], 0);
+}
+
+TEST_F(ShaderTest, FragmentSpecializedOnPipeline)
+{
+	material->setShader(std::make_shared<NormalShader>());
+	renderer->renderModel(*framebuffer, *camera, *model);
+	EXPECT_EQ(pixel(320, 240)[2], 255);
+
+	Framebuffer unlit(640, 480);
+	material->setLit(false);
+	renderer->renderModel(unlit, *camera, *model);
+	EXPECT_LT(unlit.getDepth(320, 240), 1.0f);
+	EXPECT_EQ(unlit.getColorBuffer()[(240 * 640 + 320) * 3 + 2], 0);
+}
+
+TEST_F(ShaderTest, OnlyReachableVariantsAreInstantiated)
+{
+	// three texture states, three lighting states, and blending or any of four depth write and alpha test states
+	EXPECT_EQ(Rasterizer::reachablePipelines<DefaultShader>().size(), 45u);
+	EXPECT_EQ(Rasterizer::reachablePipelines<GBufferShader>().size(), 24u);
+	EXPECT_EQ(Rasterizer::reachablePipelines<DepthShader>().size(), 2u);
+
+	// combinations that differ only in flags without effect share a rasterizer
+	const DefaultShader shader;
+	EXPECT_EQ(shader.getTileRasterizer(PIPELINE_MIPMAPPED), shader.getTileRasterizer(0));
+	EXPECT_EQ(shader.getTileRasterizer(PIPELINE_VERTEX_LIT), shader.getTileRasterizer(0));
+	EXPECT_EQ(shader.getTileRasterizer(PIPELINE_BLEND | PIPELINE_DEPTH_WRITE | PIPELINE_ALPHA_TEST),
+	          shader.getTileRasterizer(PIPELINE_BLEND));
+	EXPECT_NE(shader.getTileRasterizer(PIPELINE_DEPTH_WRITE), shader.getTileRasterizer(0));
+
+	const DepthShader depthShader;
+	EXPECT_EQ(depthShader.getTileRasterizer(PIPELINE_TEXTURED | PIPELINE_LIT | PIPELINE_DEPTH_WRITE),
+	          depthShader.getTileRasterizer(PIPELINE_DEPTH_WRITE));
+
+	EXPECT_EQ(normalizePipeline(PIPELINE_BLEND | PIPELINE_DEPTH_WRITE | PIPELINE_VERTEX_LIT), PIPELINE_BLEND);
+}
+
+TEST_F(ShaderTest, DefaultShaderLighting)
+{
+	// a light behind the surface leaves only the ambient term on the white base color
+	renderer->setLights({Light::directional(glm::vec3(0.0f, 0.0f, 1.0f))});
+	renderer->getDefaultShader().setAmbientIntensity(0.5f);
+	renderer->renderModel(*framebuffer, *camera, *model);
+	EXPECT_NEAR(pixel(320, 240)[0], 128, 1);
+
+	framebuffer->clear();
+	framebuffer->clearDepth();
+	renderer->setLights({Light::directional(glm::vec3(0.0f, 0.0f, -1.0f))});
+	renderer->renderModel(*framebuffer, *camera, *model);
+	EXPECT_EQ(pixel(320, 240)[0], 255);
+}
+
+TEST_F(ShaderTest, ModulateFixedPoint)
+{
+	const __m128i colors = _mm_setr_epi32(0xFFFFFFFF, 0x00804020, 0x7F00FF01, 0x00010203);
+	const __m128i lit = DefaultShader::modulate(colors, _mm_setr_ps(1.0f, 0.5f, 2.0f, -1.0f),
+	                                            _mm_setr_ps(0.7f, 1.0f, 0.5f, 0.0f),
+	                                            _mm_setr_ps(0.2f, 0.25f, 1.0f, 1.0f));
+
+	alignas(16) uint32_t out[4];
+	_mm_store_si128(reinterpret_cast<__m128i*>(out), lit);
+
+	// full light keeps the channel, over-bright and negative light clamp instead of wrapping,
+	// and alpha passes through unlit
+	EXPECT_EQ(out[0] & 0xFF, 0xFFu);
+	EXPECT_NEAR((out[0] >> 8) & 0xFF, 179, 1);
+	EXPECT_NEAR((out[0] >> 16) & 0xFF, 51, 1);
+	EXPECT_EQ(out[0] >> 24, 0xFFu);
+	EXPECT_EQ(out[1], 0x00204010u);
+	EXPECT_EQ(out[2], 0x7F007F01u);
+	EXPECT_EQ(out[3], 0x00010000u);
+}
@@ -0,0 +1,151 @@
+#include <gtest/gtest.h>
+#include "../src/ShadowMap.h"
+#include "../src/Renderer.h"
+#include "../src/Camera.h"
+#include "../src/Model.h"
+#include <memory>
+
+class ShadowMapTest : public testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		renderer = std::make_unique<Renderer>();
+		shadowMap = std::make_shared<ShadowMap>(256);
+
+		// looking down -z from above the scene
+		lightCamera = std::make_unique<Camera>(
+			glm::vec3(0.0f, 0.0f, 3.0f),
+			glm::vec3(0.0f, 1.0f, 0.0f),
+			-90.0f, 0.0f, 45.0f,
+			1.0f, 0.1f, 100.0f
+		);
+
+		// occluder at z = 1 covering x < -0.1, its shadow on z = 0 covers x < -0.15
+		VertexArray occluderVertices;
+		occluderVertices.resize(3);
+		occluderVertices.positionsX = {-0.1f, -0.1f, -10.0f};
+		occluderVertices.positionsY = {-6.0f, 6.0f, 0.0f};
+		occluderVertices.positionsZ = {1.0f, 1.0f, 1.0f};
+		occluder = std::make_unique<Model>(std::vector<Mesh>{Mesh(occluderVertices)});
+
+		// lit receiver at z = 0
+		VertexArray receiverVertices;
+		receiverVertices.resize(3);
+		receiverVertices.positionsX = {0.0f, -1.0f, 1.0f};
+		receiverVertices.positionsY = {1.0f, -1.0f, -1.0f};
+		receiverVertices.positionsZ = {0.0f, 0.0f, 0.0f};
+		receiverVertices.uvsU = {0.5f, 0.0f, 1.0f};
+		receiverVertices.uvsV = {0.0f, 1.0f, 1.0f};
+		receiverVertices.normalsX = {0.0f, 0.0f, 0.0f};
+		receiverVertices.normalsY = {0.0f, 0.0f, 0.0f};
+		receiverVertices.normalsZ = {1.0f, 1.0f, 1.0f};
+		receiver = std::make_unique<Model>(
+			std::vector<Mesh>{Mesh(receiverVertices, std::make_shared<Material>())});
+	}
+
+	// visibility of four world-space points
+	std::array<float, 4> sample(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c,
+	                            const glm::vec3& d) const
+	{
+		alignas(16) std::array<float, 4> visibility;
+		_mm_store_ps(visibility.data(), shadowMap->sample(_mm_set_ps(d.x, c.x, b.x, a.x),
+		                                                  _mm_set_ps(d.y, c.y, b.y, a.y),
+		                                                  _mm_set_ps(d.z, c.z, b.z, a.z)));
+		return visibility;
+	}
+
+	std::unique_ptr<Renderer> renderer;
+	std::shared_ptr<ShadowMap> shadowMap;
+	std::unique_ptr<Camera> lightCamera;
+	std::unique_ptr<Model> occluder;
+	std::unique_ptr<Model> receiver;
+};
+
+TEST_F(ShadowMapTest, DepthOnlyTarget)
+{
+	EXPECT_FALSE(shadowMap->getDepthBuffer().hasColor());
+	EXPECT_EQ(shadowMap->getDepthBuffer().getWidth(), 256);
+	EXPECT_EQ(shadowMap->getDepthBuffer().getHeight(), 256);
+	EXPECT_TRUE(shadowMap->isPcfEnabled());
+}
+
+TEST_F(ShadowMapTest, RenderedDepthOccludes)
+{
+	renderer->renderShadowMap(*shadowMap, *lightCamera, *occluder);
+	EXPECT_LT(shadowMap->getDepthBuffer().getDepth(64, 128), 1.0f);
+	EXPECT_FLOAT_EQ(shadowMap->getDepthBuffer().getDepth(192, 128), 1.0f);
+
+	// behind the occluder, beside it, in front of it and off the map
+	const auto visibility = sample(glm::vec3(-0.5f, -0.5f, 0.0f), glm::vec3(0.5f, -0.5f, 0.0f),
+	                               glm::vec3(-0.5f, -0.5f, 2.0f), glm::vec3(10.0f, 0.0f, 0.0f));
+	EXPECT_FLOAT_EQ(visibility[0], 0.0f);
+	EXPECT_FLOAT_EQ(visibility[1], 1.0f);
+	EXPECT_FLOAT_EQ(visibility[2], 1.0f);
+	EXPECT_FLOAT_EQ(visibility[3], 1.0f);
+}
+
+TEST_F(ShadowMapTest, EveryCasterIsDrawn)
+{
+	// the occluder mirrored to x > 0.1, with its winding kept
+	VertexArray vertices;
+	vertices.resize(3);
+	vertices.positionsX = {0.1f, 0.1f, 10.0f};
+	vertices.positionsY = {6.0f, -6.0f, 0.0f};
+	vertices.positionsZ = {1.0f, 1.0f, 1.0f};
+	const Model mirrored(std::vector<Mesh>{Mesh(vertices)});
+
+	const Model* casters[] = {occluder.get(), &mirrored};
+	renderer->renderShadowMap(*shadowMap, *lightCamera, casters);
+	EXPECT_LT(shadowMap->getDepthBuffer().getDepth(64, 128), 1.0f);
+	EXPECT_LT(shadowMap->getDepthBuffer().getDepth(192, 128), 1.0f);
+	EXPECT_FLOAT_EQ(shadowMap->getDepthBuffer().getDepth(128, 128), 1.0f);
+
+	// the next render starts from a cleared map
+	renderer->renderShadowMap(*shadowMap, *lightCamera, mirrored);
+	EXPECT_FLOAT_EQ(shadowMap->getDepthBuffer().getDepth(64, 128), 1.0f);
+	EXPECT_LT(shadowMap->getDepthBuffer().getDepth(192, 128), 1.0f);
+}
+
+TEST_F(ShadowMapTest, PcfSoftensTheEdge)
+{
+	renderer->renderShadowMap(*shadowMap, *lightCamera, *occluder);
+
+	// the shadow edge falls inside texel column 112, so x = 113 sits halfway to the lit column
+	const float edgeX = (113.0f / 128.0f - 1.0f) * 3.0f * std::tan(glm::radians(22.5f));
+	const glm::vec3 onEdge(edgeX, 0.0f, 0.0f);
+
+	shadowMap->setPcf(false);
+	const float hard = sample(onEdge, onEdge, onEdge, onEdge)[0];
+	EXPECT_TRUE(hard == 0.0f || hard == 1.0f);
+
+	shadowMap->setPcf(true);
+	EXPECT_NEAR(sample(onEdge, onEdge, onEdge, onEdge)[0], 0.5f, 0.05f);
+}
+
+TEST_F(ShadowMapTest, ShadowedLightOnlyReachesLitPixels)
+{
+	renderer->renderShadowMap(*shadowMap, *lightCamera, *occluder);
+
+	Light light = Light::directional(glm::vec3(0.0f, 0.0f, -1.0f));
+	light.shadowMap = shadowMap;
+	renderer->setLights({light});
+	renderer->getDefaultShader().setAmbientIntensity(0.0f);
+
+	// the occluder only casts, it is not drawn from the view camera
+	Framebuffer framebuffer(640, 480);
+	const Camera camera(glm::vec3(0.0f, 0.0f, 2.0f), glm::vec3(0.0f, 1.0f, 0.0f), -90.0f, 0.0f, 45.0f,
+	                    640.0f / 480.0f, 0.1f, 100.0f);
+	renderer->renderModel(framebuffer, camera, *receiver);
+
+	auto pixelAt = [&](const glm::vec3& world)
+	{
+		const glm::vec4 clip = camera.getViewProjectionMatrix() * glm::vec4(world, 1.0f);
+		const int x = static_cast<int>((clip.x / clip.w + 1.0f) * 0.5f * 640);
+		const int y = static_cast<int>((1.0f - clip.y / clip.w) * 0.5f * 480);
+		return framebuffer.getColorBuffer()[(y * 640 + x) * 3];
+	};
+
+	EXPECT_EQ(pixelAt(glm::vec3(-0.5f, -0.5f, 0.0f)), 0);
+	EXPECT_EQ(pixelAt(glm::vec3(0.5f, -0.5f, 0.0f)), 255);
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+// 24-bit BMP whose texels come from color(x, y) packed like Texture::sample() output (b << 16 | g << 8 | r)
+inline void writeTestBMP(const std::string& path, const int width, const int height,
+                         const std::function<uint32_t(int, int)>& color)
+{
+	const int rowSize = (width * 3 + 3) & ~3;
+	const int dataSize = rowSize * height;
+
+	std::ofstream file(path, std::ios::binary);
+	file.put('B');
+	file.put('M');
+	const int fileSize = 54 + dataSize;
+	file.write(reinterpret_cast<const char*>(&fileSize), 4);
+	constexpr int reserved = 0;
+	file.write(reinterpret_cast<const char*>(&reserved), 4);
+	constexpr int dataOffset = 54;
+	file.write(reinterpret_cast<const char*>(&dataOffset), 4);
+
+	constexpr int headerSize = 40;
+	file.write(reinterpret_cast<const char*>(&headerSize), 4);
+	file.write(reinterpret_cast<const char*>(&width), 4);
+	file.write(reinterpret_cast<const char*>(&height), 4);
+	constexpr short planes = 1;
+	file.write(reinterpret_cast<const char*>(&planes), 2);
+	constexpr short bitsPerPixel = 24;
+	file.write(reinterpret_cast<const char*>(&bitsPerPixel), 2);
+	for (int i = 0; i < 24; ++i) file.put(0);
+
+	// rows are stored bottom-up in BGR order
+	std::vector<char> row(rowSize, 0);
+	for (int y = height - 1; y >= 0; --y)
+	{
+		for (int x = 0; x < width; ++x)
+		{
+			const uint32_t c = color(x, y);
+			row[x * 3 + 0] = static_cast<char>((c >> 16) & 0xFF);
+			row[x * 3 + 1] = static_cast<char>((c >> 8) & 0xFF);
+			row[x * 3 + 2] = static_cast<char>(c & 0xFF);
+		}
+		file.write(row.data(), rowSize);
+	}
+}
+
+// single color BMP of the given size
+inline void writeTestBMP(const std::string& path, const int width, const int height, const uint32_t color)
+{
+	writeTestBMP(path, width, height, [color](int, int) { return color; });
+}
@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+#include "../src/TextureCache.h"
+#include "TestBitmap.h"
+#include <cstdio>
+#include <latch>
+#include <thread>
+#include <vector>
+
+class TextureCacheTest : public testing::Test
+{
+protected:
+	void TearDown() override
+	{
+		for (const std::string& path : paths)
+			std::remove(path.c_str());
+	}
+
+	// solid gray 4x4 BMP
+	std::string createBMP(const std::string& path, const uint8_t value)
+	{
+		writeTestBMP(path, 4, 4, value * 0x010101u);
+		paths.push_back(path);
+		return path;
+	}
+
+	// 4x4 RGBA8 with its 2x2 and 1x1 levels, each padded to a whole block
+	static constexpr size_t TEXTURE_BYTES = 3 * 16 * 4;
+
+	std::vector<std::string> paths;
+};
+
+TEST_F(TextureCacheTest, SamePathSharesTexture)
+{
+	TextureCache cache;
+	const std::string path = createBMP("test_cache_a.bmp", 10);
+
+	const auto first = cache.load(path);
+	const auto second = cache.load("./" + path);
+	ASSERT_NE(first, nullptr);
+	EXPECT_EQ(first, second);
+
+	const TextureCacheStats stats = cache.getStats();
+	EXPECT_EQ(stats.misses, 1u);
+	EXPECT_EQ(stats.hits, 1u);
+	EXPECT_EQ(stats.textureCount, 1u);
+	EXPECT_EQ(stats.residentBytes, TEXTURE_BYTES);
+}
+
+TEST_F(TextureCacheTest, SameContentSharesTexture)
+{
+	TextureCache cache;
+	const auto first = cache.load(createBMP("test_cache_a.bmp", 10));
+	const auto copy = cache.load(createBMP("test_cache_b.bmp", 10));
+	const auto different = cache.load(createBMP("test_cache_c.bmp", 20));
+
+	EXPECT_EQ(first, copy);
+	EXPECT_NE(first, different);
+	EXPECT_EQ(cache.getStats().misses, 2u);
+	EXPECT_EQ(cache.getStats().hits, 1u);
+
+	// the duplicate path is remembered directly
+	EXPECT_EQ(cache.load("test_cache_b.bmp"), first);
+	EXPECT_EQ(cache.getStats().hits, 2u);
+}
+
+TEST_F(TextureCacheTest, MissingFiles)
+{
+	TextureCache cache;
+	EXPECT_EQ(cache.load("non_existent_texture.png"), nullptr);
+	EXPECT_THROW(cache.load(""), std::invalid_argument);
+	EXPECT_EQ(cache.getStats().textureCount, 0u);
+}
+
+TEST_F(TextureCacheTest, LeastRecentlyUsedEviction)
+{
+	TextureCache cache(TEXTURE_BYTES * 2);
+	const auto a = cache.load(createBMP("test_cache_a.bmp", 10));
+	const auto b = cache.load(createBMP("test_cache_b.bmp", 20));
+
+	// touching a leaves b as the oldest
+	EXPECT_EQ(cache.load("test_cache_a.bmp"), a);
+	const auto c = cache.load(createBMP("test_cache_c.bmp", 30));
+
+	TextureCacheStats stats = cache.getStats();
+	EXPECT_EQ(stats.evictions, 1u);
+	EXPECT_EQ(stats.textureCount, 2u);
+	EXPECT_EQ(stats.residentBytes, TEXTURE_BYTES * 2);
+	EXPECT_EQ(cache.load("test_cache_a.bmp"), a);
+	EXPECT_EQ(cache.load("test_cache_c.bmp"), c);
+
+	// an evicted texture stays valid for its holders, loading it again decodes a new copy
+	EXPECT_TRUE(b->isLoaded());
+	const size_t missesBefore = cache.getStats().misses;
+	EXPECT_NE(cache.load("test_cache_b.bmp"), b);
+	EXPECT_EQ(cache.getStats().misses, missesBefore + 1);
+
+	cache.setMemoryBudget(0);
+	stats = cache.getStats();
+	EXPECT_EQ(stats.textureCount, 0u);
+	EXPECT_EQ(stats.residentBytes, 0u);
+	EXPECT_EQ(cache.getMemoryBudget(), 0u);
+}
+
+TEST_F(TextureCacheTest, TextureLargerThanBudgetIsStillReturned)
+{
+	TextureCache cache(1);
+	const auto texture = cache.load(createBMP("test_cache_a.bmp", 10));
+	ASSERT_NE(texture, nullptr);
+	EXPECT_EQ(cache.getStats().textureCount, 1u);
+
+	cache.clear();
+	EXPECT_EQ(cache.getStats().textureCount, 0u);
+	EXPECT_EQ(cache.getStats().hits, 0u);
+}
+
+TEST_F(TextureCacheTest, ConcurrentLoadsShareOneTexture)
+{
+	TextureCache cache;
+	const std::string first = createBMP("test_cache_a.bmp", 10);
+	const std::string copy = createBMP("test_cache_b.bmp", 10);
+
+	// every thread races on the same contents, half of them under another name
+	constexpr int threadCount = 8;
+	std::vector<std::shared_ptr<const Texture>> results(threadCount);
+	std::latch start(threadCount);
+	std::vector<std::thread> threads;
+	for (int i = 0; i < threadCount; ++i)
+	{
+		threads.emplace_back([&, i]
+		{
+			start.arrive_and_wait();
+			results[i] = cache.load(i % 2 ? copy : first);
+		});
+	}
+	for (std::thread& thread : threads)
+		thread.join();
+
+	ASSERT_NE(results[0], nullptr);
+	for (const auto& texture : results)
+		EXPECT_EQ(texture, results[0]);
+
+	// each load is either the one miss or a hit, whichever thread decoded first
+	const TextureCacheStats stats = cache.getStats();
+	EXPECT_EQ(stats.misses, 1u);
+	EXPECT_EQ(stats.hits, threadCount - 1u);
+	EXPECT_EQ(stats.textureCount, 1u);
+	EXPECT_EQ(stats.residentBytes, TEXTURE_BYTES);
+	EXPECT_EQ(cache.load(copy), results[0]);
+}
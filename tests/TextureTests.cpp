@@ -1,7 +1,10 @@
 #include <gtest/gtest.h>
 #include "../src/Texture.h"
+#include "TestBitmap.h"
 #include <immintrin.h>
 #include <fstream>
+#include <cstring>
+#include <vector>
 
 class TextureTest : public testing::Test
 {
@@ -9,7 +12,7 @@ protected:
 	void SetUp() override
 	{
 		testImagePath = "test_texture.bmp";
-		createMinimalBMP();
+		writeTestBMP(testImagePath, 1, 1, 0x0000FFu);
 	}
 
 	void TearDown() override
@@ -17,35 +20,17 @@ protected:
 		std::remove(testImagePath.c_str());
 	}
 
-	void createMinimalBMP() const
+	// rgb of each lane, alpha is checked separately
+	static void sampleColors(const Texture& texture, const __m128 u, const __m128 v, const float lod, uint32_t* colors)
 	{
-		std::ofstream file(testImagePath, std::ios::binary);
-
-		file.put('B');
-		file.put('M');
-		constexpr int fileSize = 54 + 3;
-		file.write(reinterpret_cast<const char*>(&fileSize), 4);
-		constexpr int reserved = 0;
-		file.write(reinterpret_cast<const char*>(&reserved), 4);
-		constexpr int dataOffset = 54;
-		file.write(reinterpret_cast<const char*>(&dataOffset), 4);
-
-		constexpr int headerSize = 40;
-		file.write(reinterpret_cast<const char*>(&headerSize), 4);
-		constexpr int width = 1;
-		file.write(reinterpret_cast<const char*>(&width), 4);
-		constexpr int height = 1;
-		file.write(reinterpret_cast<const char*>(&height), 4);
-		constexpr short planes = 1;
-		file.write(reinterpret_cast<const char*>(&planes), 2);
-		constexpr short bitsPerPixel = 24;
-		file.write(reinterpret_cast<const char*>(&bitsPerPixel), 2);
-		for (int i = 0; i < 24; ++i) file.put(0);
-		file.put(0);
-		file.put(0);
-		file.put(static_cast<char>(255));
-
-		file.close();
+		sampleColors(texture, u, v, lod, texture.getFilter(), colors);
+	}
+
+	static void sampleColors(const Texture& texture, const __m128 u, const __m128 v, const float lod,
+	                         const TextureFilter filter, uint32_t* colors)
+	{
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(colors),
+		                 _mm_and_si128(texture.sample(u, v, lod, filter), _mm_set1_epi32(0x00FFFFFF)));
 	}
 
 	std::string testImagePath;
@@ -197,3 +182,479 @@ TEST_F(TextureTest, BoundaryUVValues)
 	const __m128 v = _mm_set_ps(1.0f, 0.0f, 1.0f, 0.0f);
 	EXPECT_NO_THROW(const __m128i result = texture.sample(u, v));
 }
+
+TEST_F(TextureTest, MipChainBoxFiltered)
+{
+	const std::string path = "test_mip_texture.bmp";
+	writeTestBMP(path, 4, 4, [](const int x, const int y) { return ((x + y) & 1) ? 0xFFFFFFu : 0x000000u; });
+
+	const Texture texture(path);
+	std::remove(path.c_str());
+	ASSERT_TRUE(texture.isLoaded());
+
+	ASSERT_EQ(texture.getMipLevelCount(), 3);
+	EXPECT_EQ(texture.getMipWidth(1), 2);
+	EXPECT_EQ(texture.getMipHeight(1), 2);
+	EXPECT_EQ(texture.getMipWidth(2), 1);
+	EXPECT_EQ(texture.getMipHeight(2), 1);
+
+	// every 2x2 block of the checkerboard averages to mid grey
+	for (int level = 1; level < 3; ++level)
+	{
+		for (int y = 0; y < texture.getMipHeight(level); ++y)
+			for (int x = 0; x < texture.getMipWidth(level); ++x)
+				EXPECT_EQ(texture.getTexel(level, x, y), 0xFF808080u);
+	}
+
+	const __m128 u = _mm_set_ps(0.9f, 0.6f, 0.3f, 0.0f);
+	const __m128 v = _mm_set_ps(0.9f, 0.6f, 0.3f, 0.0f);
+	alignas(16) uint32_t colors[4];
+	sampleColors(texture, u, v, 2.0f, colors);
+	for (const uint32_t color : colors)
+		EXPECT_EQ(color, 0x808080u);
+
+	// lod past the last level clamps to it
+	sampleColors(texture, u, v, 10.0f, colors);
+	EXPECT_EQ(colors[0], 0x808080u);
+
+	// base level keeps the original texels
+	sampleColors(texture, _mm_setzero_ps(), _mm_setzero_ps(), 0.0f, colors);
+	EXPECT_EQ(colors[0], 0x000000u);
+}
+
+TEST_F(TextureTest, MipChainNonSquare)
+{
+	const std::string path = "test_mip_texture.bmp";
+	writeTestBMP(path, 8, 2, [](const int x, int) { return x < 4 ? 0x0000FFu : 0xFF0000u; });
+
+	const Texture texture(path);
+	std::remove(path.c_str());
+	ASSERT_TRUE(texture.isLoaded());
+
+	// 8x2 -> 4x1 -> 2x1 -> 1x1
+	ASSERT_EQ(texture.getMipLevelCount(), 4);
+	EXPECT_EQ(texture.getMipWidth(1), 4);
+	EXPECT_EQ(texture.getMipHeight(1), 1);
+	EXPECT_EQ(texture.getMipWidth(2), 2);
+	EXPECT_EQ(texture.getMipHeight(2), 1);
+
+	// the halves stay separate until the last level
+	EXPECT_EQ(texture.getTexel(2, 0, 0), 0xFF0000FFu);
+	EXPECT_EQ(texture.getTexel(2, 1, 0), 0xFFFF0000u);
+}
+
+TEST_F(TextureTest, MipChainOddSizesKeepEveryTexel)
+{
+	// 3x1 -> 1x1, only the last texel is lit and must still contribute a third
+	const uint8_t row3[] = {0, 0, 0, 0, 0, 0, 255, 255, 255};
+	Texture texture("");
+	texture.create(3, 1, row3);
+	ASSERT_EQ(texture.getMipLevelCount(), 2);
+	EXPECT_EQ(texture.getTexel(1, 0, 0), 0xFF555555u);
+
+	// 5x1 -> 2x1 splits the middle texel between both destination texels
+	const uint8_t row5[] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 250, 250, 250};
+	texture.create(5, 1, row5);
+	ASSERT_EQ(texture.getMipWidth(1), 2);
+	EXPECT_EQ(texture.getTexel(1, 0, 0), 0xFF000000u);
+	EXPECT_EQ(texture.getTexel(1, 1, 0), 0xFF646464u);
+
+	// the same weights apply vertically
+	texture.create(1, 3, row3);
+	EXPECT_EQ(texture.getTexel(1, 0, 0), 0xFF555555u);
+}
+
+TEST_F(TextureTest, ComputeLodFromDerivatives)
+{
+	const std::string path = "test_mip_texture.bmp";
+	writeTestBMP(path, 16, 16, [](int, int) { return 0xFFFFFFu; });
+
+	const Texture texture(path);
+	std::remove(path.c_str());
+	ASSERT_TRUE(texture.isLoaded());
+	ASSERT_EQ(texture.getMipLevelCount(), 5);
+
+	const __m128 zero = _mm_setzero_ps();
+
+	// one texel per pixel is the base level, magnification never goes below it
+	EXPECT_FLOAT_EQ(texture.computeLod(_mm_set1_ps(1.0f / 16.0f), zero, zero, _mm_set1_ps(1.0f / 16.0f), 0xF), 0.0f);
+	EXPECT_FLOAT_EQ(texture.computeLod(_mm_set1_ps(1.0f / 64.0f), zero, zero, zero, 0xF), 0.0f);
+
+	// four texels per pixel along y only is still two levels down
+	EXPECT_NEAR(texture.computeLod(zero, zero, zero, _mm_set1_ps(4.0f / 16.0f), 0xF), 2.0f, 1e-5f);
+
+	// lanes outside the mask are ignored
+	const __m128 dudx = _mm_set_ps(8.0f / 16.0f, 2.0f / 16.0f, 2.0f / 16.0f, 2.0f / 16.0f);
+	EXPECT_NEAR(texture.computeLod(dudx, zero, zero, zero, 0x7), 1.0f, 1e-5f);
+	EXPECT_NEAR(texture.computeLod(dudx, zero, zero, zero, 0xF), 3.0f, 1e-5f);
+	EXPECT_FLOAT_EQ(texture.computeLod(dudx, zero, zero, zero, 0), 0.0f);
+}
+
+TEST_F(TextureTest, BilinearFilter)
+{
+	const std::string path = "test_filter_texture.bmp";
+	writeTestBMP(path, 2, 1, [](const int x, int) { return x == 0 ? 0x000000u : 0xFFFFFFu; });
+
+	Texture texture(path);
+	std::remove(path.c_str());
+	ASSERT_TRUE(texture.isLoaded());
+	EXPECT_EQ(texture.getFilter(), TextureFilter::Nearest);
+
+	// texel centres are exact, halfway between them blends evenly, edges clamp
+	const __m128 u = _mm_set_ps(1.0f, 0.5f, 0.25f, 0.0f);
+	const __m128 v = _mm_set1_ps(0.5f);
+	alignas(16) uint32_t colors[4];
+	sampleColors(texture, u, v, 0.0f, colors);
+	EXPECT_EQ(colors[1], 0x000000u);
+	EXPECT_EQ(colors[2], 0xFFFFFFu);
+	EXPECT_EQ(colors[3], 0xFFFFFFu);
+
+	texture.setFilter(TextureFilter::Bilinear);
+	EXPECT_EQ(texture.getFilter(), TextureFilter::Bilinear);
+	sampleColors(texture, u, v, 0.0f, colors);
+	EXPECT_EQ(colors[0], 0x000000u);
+	EXPECT_EQ(colors[1], 0x000000u);
+	EXPECT_EQ(colors[2], 0x808080u);
+	EXPECT_EQ(colors[3], 0xFFFFFFu);
+
+	// quarter of the way between the texel centres
+	sampleColors(texture, _mm_set1_ps(0.375f), v, 0.0f, TextureFilter::Bilinear, colors);
+	EXPECT_EQ(colors[0], 0x404040u);
+}
+
+TEST_F(TextureTest, BilinearFilterBlendsChannelsIndependently)
+{
+	const std::string path = "test_filter_texture.bmp";
+	writeTestBMP(path, 1, 2, [](int, const int y) { return y == 0 ? 0x0000FFu : 0xFF0000u; });
+
+	const Texture texture(path);
+	std::remove(path.c_str());
+	ASSERT_TRUE(texture.isLoaded());
+
+	alignas(16) uint32_t colors[4];
+	sampleColors(texture, _mm_set1_ps(0.5f), _mm_set_ps(0.75f, 0.5f, 0.25f, 0.0f), 0.0f, TextureFilter::Bilinear,
+	             colors);
+	EXPECT_EQ(colors[0], 0x0000FFu);
+	EXPECT_EQ(colors[1], 0x0000FFu);
+	EXPECT_EQ(colors[2], 0x800080u);
+	EXPECT_EQ(colors[3], 0xFF0000u);
+}
+
+TEST_F(TextureTest, TrilinearFilterBlendsMipLevels)
+{
+	const std::string path = "test_filter_texture.bmp";
+	writeTestBMP(path, 4, 4, [](const int x, const int y) { return ((x + y) & 1) ? 0xFFFFFFu : 0x000000u; });
+
+	const Texture texture(path);
+	std::remove(path.c_str());
+	ASSERT_TRUE(texture.isLoaded());
+
+	// centre of the black texel at (0,0), level 1 is uniform grey
+	const __m128 u = _mm_set1_ps(0.125f);
+	const __m128 v = _mm_set1_ps(0.125f);
+	alignas(16) uint32_t colors[4];
+
+	sampleColors(texture, u, v, 0.0f, TextureFilter::Trilinear, colors);
+	EXPECT_EQ(colors[0], 0x000000u);
+
+	sampleColors(texture, u, v, 0.5f, TextureFilter::Trilinear, colors);
+	EXPECT_EQ(colors[0], 0x404040u);
+
+	sampleColors(texture, u, v, 1.0f, TextureFilter::Trilinear, colors);
+	EXPECT_EQ(colors[0], 0x808080u);
+
+	// bilinear snaps to the nearest level instead
+	sampleColors(texture, u, v, 0.4f, TextureFilter::Bilinear, colors);
+	EXPECT_EQ(colors[0], 0x000000u);
+
+	// lod beyond the chain stays on the last level
+	sampleColors(texture, u, v, 8.0f, TextureFilter::Trilinear, colors);
+	EXPECT_EQ(colors[0], 0x808080u);
+}
+
+TEST_F(TextureTest, WrapModes)
+{
+	const std::string path = "test_wrap_texture.bmp";
+	writeTestBMP(path, 4, 1, [](const int x, int) { return static_cast<uint32_t>(x * 0x10); });
+
+	Texture texture(path);
+	std::remove(path.c_str());
+	ASSERT_TRUE(texture.isLoaded());
+	EXPECT_EQ(texture.getWrapU(), TextureWrap::ClampToEdge);
+	EXPECT_EQ(texture.getWrapV(), TextureWrap::ClampToEdge);
+
+	// texel centres of x = -1, 4, 5 and -6
+	const __m128 u = _mm_set_ps(-1.375f, 1.375f, 1.125f, -0.125f);
+	const __m128 v = _mm_set1_ps(0.5f);
+	alignas(16) uint32_t colors[4];
+
+	sampleColors(texture, u, v, 0.0f, colors);
+	EXPECT_EQ(colors[0], 0x00u);
+	EXPECT_EQ(colors[1], 0x30u);
+	EXPECT_EQ(colors[2], 0x30u);
+	EXPECT_EQ(colors[3], 0x00u);
+
+	texture.setWrap(TextureWrap::Repeat, TextureWrap::Repeat);
+	sampleColors(texture, u, v, 0.0f, colors);
+	EXPECT_EQ(colors[0], 0x30u);
+	EXPECT_EQ(colors[1], 0x00u);
+	EXPECT_EQ(colors[2], 0x10u);
+	EXPECT_EQ(colors[3], 0x20u);
+
+	texture.setWrap(TextureWrap::MirroredRepeat, TextureWrap::ClampToEdge);
+	EXPECT_EQ(texture.getWrapU(), TextureWrap::MirroredRepeat);
+	sampleColors(texture, u, v, 0.0f, colors);
+	EXPECT_EQ(colors[0], 0x00u);
+	EXPECT_EQ(colors[1], 0x30u);
+	EXPECT_EQ(colors[2], 0x20u);
+	EXPECT_EQ(colors[3], 0x20u);
+}
+
+TEST_F(TextureTest, WrapModesNonPowerOfTwo)
+{
+	const std::string path = "test_wrap_texture.bmp";
+	writeTestBMP(path, 3, 1, [](const int x, int) { return static_cast<uint32_t>(x * 0x10); });
+
+	Texture texture(path);
+	std::remove(path.c_str());
+	ASSERT_TRUE(texture.isLoaded());
+
+	// texel centres of x = -1, 3, 7 and -5
+	const __m128 u = _mm_set_ps(-4.5f / 3.0f, 7.5f / 3.0f, 3.5f / 3.0f, -0.5f / 3.0f);
+	const __m128 v = _mm_set1_ps(0.5f);
+	alignas(16) uint32_t colors[4];
+
+	texture.setWrap(TextureWrap::Repeat, TextureWrap::Repeat);
+	sampleColors(texture, u, v, 0.0f, colors);
+	EXPECT_EQ(colors[0], 0x20u);
+	EXPECT_EQ(colors[1], 0x00u);
+	EXPECT_EQ(colors[2], 0x10u);
+	EXPECT_EQ(colors[3], 0x10u);
+
+	texture.setWrap(TextureWrap::MirroredRepeat, TextureWrap::MirroredRepeat);
+	sampleColors(texture, u, v, 0.0f, colors);
+	EXPECT_EQ(colors[0], 0x00u);
+	EXPECT_EQ(colors[1], 0x20u);
+	EXPECT_EQ(colors[2], 0x10u);
+	EXPECT_EQ(colors[3], 0x10u);
+}
+
+TEST_F(TextureTest, BilinearFilterRepeatsAcrossSeam)
+{
+	const std::string path = "test_wrap_texture.bmp";
+	writeTestBMP(path, 2, 1, [](const int x, int) { return x == 0 ? 0x000000u : 0xFFFFFFu; });
+
+	Texture texture(path);
+	std::remove(path.c_str());
+	ASSERT_TRUE(texture.isLoaded());
+
+	// halfway between the last texel and the first, so the tile edge blends instead of smearing
+	const __m128 u = _mm_set1_ps(1.0f);
+	const __m128 v = _mm_set1_ps(0.5f);
+	alignas(16) uint32_t colors[4];
+
+	sampleColors(texture, u, v, 0.0f, TextureFilter::Bilinear, colors);
+	EXPECT_EQ(colors[0], 0xFFFFFFu);
+
+	texture.setWrap(TextureWrap::Repeat, TextureWrap::Repeat);
+	sampleColors(texture, u, v, 0.0f, TextureFilter::Bilinear, colors);
+	EXPECT_EQ(colors[0], 0x808080u);
+}
+
+TEST_F(TextureTest, LargeRepeatCountsKeepTheirFraction)
+{
+	// red ramp across a 1024 wide texture; at 500 repeats the bilinear texel position with its six
+	// fractional bits is far past 2^23
+	constexpr int SIZE = 1024;
+	std::vector<uint8_t> rgb(SIZE * 4 * 3, 0);
+	for (int y = 0; y < 4; ++y)
+		for (int x = 0; x < SIZE; ++x)
+			rgb[(y * SIZE + x) * 3] = static_cast<uint8_t>(x * 7);
+
+	Texture texture("");
+	texture.create(SIZE, 4, rgb.data());
+
+	const float fractions[4] = {0.1240234375f, 0.3125f, 0.5078125f, 0.90625f};
+	const __m128 v = _mm_set1_ps(0.5f);
+	const __m128 u = _mm_loadu_ps(fractions);
+	alignas(16) uint32_t base[4];
+	alignas(16) uint32_t tiled[4];
+
+	for (const TextureWrap wrap : {TextureWrap::Repeat, TextureWrap::MirroredRepeat})
+	{
+		texture.setWrap(wrap, wrap);
+		for (const TextureFilter filter : {TextureFilter::Nearest, TextureFilter::Bilinear})
+		{
+			sampleColors(texture, u, v, 0.0f, filter, base);
+			EXPECT_NE(base[0], base[1]);
+			EXPECT_NE(base[2], base[3]);
+
+			// whole mirrored periods span two tiles
+			for (const float tiles : {500.0f, -2000.0f})
+			{
+				sampleColors(texture, _mm_add_ps(u, _mm_set1_ps(tiles)), v, 0.0f, filter, tiled);
+				for (int lane = 0; lane < 4; ++lane)
+					EXPECT_EQ(tiled[lane], base[lane]) << "lane " << lane << " tiles " << tiles;
+			}
+		}
+	}
+}
+
+TEST_F(TextureTest, TiledStorage)
+{
+	const std::string path = "test_tiled_texture.bmp";
+	writeTestBMP(path, 6, 5, [](const int x, const int y) { return static_cast<uint32_t>(y << 8 | x); });
+
+	const Texture texture(path);
+	std::remove(path.c_str());
+	ASSERT_TRUE(texture.isLoaded());
+
+	// texel storage is aligned to a cache line and rgb sources are opaque
+	EXPECT_EQ(reinterpret_cast<uintptr_t>(texture.getData()) % 64, 0u);
+	for (int y = 0; y < 5; ++y)
+		for (int x = 0; x < 6; ++x)
+			EXPECT_EQ(texture.getTexel(0, x, y), 0xFF000000u | static_cast<uint32_t>(y << 8 | x));
+
+	// a 4x4 block is contiguous, partial blocks are padded out
+	const uint32_t* data = texture.getData();
+	EXPECT_EQ(data[5] & 0xFFFFFF, 0x000101u);
+	EXPECT_EQ(data[16] & 0xFFFFFF, 0x000004u);
+	EXPECT_EQ(data[32] & 0xFFFFFF, 0x000400u);
+
+	// sampling walks the same layout
+	alignas(16) uint32_t colors[4];
+	sampleColors(texture, _mm_set_ps(5.5f / 6.0f, 4.5f / 6.0f, 3.5f / 6.0f, 0.5f / 6.0f),
+	             _mm_set_ps(4.5f / 5.0f, 0.5f / 5.0f, 3.5f / 5.0f, 2.5f / 5.0f), 0.0f, colors);
+	EXPECT_EQ(colors[0], 0x000200u);
+	EXPECT_EQ(colors[1], 0x000303u);
+	EXPECT_EQ(colors[2], 0x000004u);
+	EXPECT_EQ(colors[3], 0x000405u);
+
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(colors), texture.sample(_mm_setzero_ps(), _mm_setzero_ps()));
+	EXPECT_EQ(colors[0] >> 24, 0xFFu);
+}
+
+TEST_F(TextureTest, CreateFromPixels)
+{
+	std::vector<uint8_t> rgb(5 * 3 * 3);
+	for (size_t i = 0; i < rgb.size(); ++i)
+		rgb[i] = static_cast<uint8_t>(i);
+
+	Texture texture("");
+	texture.create(5, 3, rgb.data());
+	ASSERT_TRUE(texture.isLoaded());
+	EXPECT_EQ(texture.getWidth(), 5);
+	EXPECT_EQ(texture.getHeight(), 3);
+	EXPECT_EQ(texture.getMipLevelCount(), 3);
+	EXPECT_EQ(texture.getTexel(0, 1, 2), 0xFF000000u | 35u << 16 | 34u << 8 | 33u);
+
+	EXPECT_THROW(texture.create(0, 3, rgb.data()), std::invalid_argument);
+	EXPECT_THROW(texture.create(5, 3, nullptr), std::invalid_argument);
+}
+
+TEST_F(TextureTest, CreateFromRGBAPixels)
+{
+	const uint8_t rgba[2 * 2 * 4] = {
+		10, 20, 30, 0, 40, 50, 60, 128,
+		70, 80, 90, 255, 100, 110, 120, 64
+	};
+
+	Texture texture("");
+	texture.create(2, 2, rgba, 4);
+	ASSERT_TRUE(texture.isLoaded());
+	EXPECT_EQ(texture.getTexel(0, 1, 0), 128u << 24 | 60u << 16 | 50u << 8 | 40u);
+	EXPECT_EQ(texture.getTexel(0, 0, 0) >> 24, 0u);
+
+	// alpha is box filtered like the other channels
+	EXPECT_EQ(texture.getTexel(1, 0, 0) >> 24, (0u + 128 + 255 + 64 + 2) / 4);
+
+	EXPECT_THROW(texture.create(2, 2, rgba, 2), std::invalid_argument);
+}
+
+TEST_F(TextureTest, FetchMethodsAgree)
+{
+	constexpr int size = 16;
+	std::vector<uint8_t> rgb(size * size * 3);
+	for (size_t i = 0; i < rgb.size(); ++i)
+		rgb[i] = static_cast<uint8_t>(i * 7 + 3);
+
+	Texture texture("");
+	texture.create(size, size, rgb.data());
+	ASSERT_TRUE(texture.isLoaded());
+
+	// quads inside one block, along a row across blocks, and scattered
+	const __m128i xs[] = {
+		_mm_setr_epi32(0, 3, 1, 2), _mm_setr_epi32(5, 4, 7, 6), _mm_setr_epi32(2, 3, 4, 5),
+		_mm_setr_epi32(15, 0, 9, 6), _mm_setr_epi32(12, 13, 14, 15)
+	};
+	const __m128i ys[] = {
+		_mm_setr_epi32(0, 3, 2, 1), _mm_setr_epi32(9, 9, 10, 11), _mm_setr_epi32(7, 7, 7, 7),
+		_mm_setr_epi32(1, 15, 8, 4), _mm_setr_epi32(15, 12, 13, 14)
+	};
+
+	for (int i = 0; i < 5; ++i)
+	{
+		alignas(16) int x[4];
+		alignas(16) int y[4];
+		_mm_store_si128(reinterpret_cast<__m128i*>(x), xs[i]);
+		_mm_store_si128(reinterpret_cast<__m128i*>(y), ys[i]);
+
+		for (const TexelFetch method : {TexelFetch::Scalar, TexelFetch::Gather, TexelFetch::Permute})
+		{
+			alignas(16) uint32_t colors[4];
+			_mm_store_si128(reinterpret_cast<__m128i*>(colors), texture.fetch(0, xs[i], ys[i], method));
+			for (int lane = 0; lane < 4; ++lane)
+				EXPECT_EQ(colors[lane], texture.getTexel(0, x[lane], y[lane]))
+					<< "quad " << i << " lane " << lane << " method " << static_cast<int>(method);
+		}
+	}
+}
+
+TEST_F(TextureTest, CompressedTextureSampling)
+{
+	// 8x4 DXT1: left block red, right block blue, solid colors via all-zero indices
+	std::vector<uint8_t> bytes(128, 0);
+	std::memcpy(bytes.data(), "DDS ", 4);
+	const uint32_t header[] = {124, 0, 4, 8, 0, 0, 1};
+	std::memcpy(bytes.data() + 4, header, sizeof(header));
+	std::memcpy(bytes.data() + 84, "DXT1", 4);
+	const uint8_t blocks[16] = {0x00, 0xF8, 0x00, 0x00, 0, 0, 0, 0, 0x1F, 0x00, 0x00, 0x00, 0, 0, 0, 0};
+	bytes.insert(bytes.end(), blocks, blocks + 16);
+
+	const std::string path = "test_compressed_texture.dds";
+	{
+		std::ofstream file(path, std::ios::binary);
+		file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+	}
+
+	const Texture texture(path);
+	std::remove(path.c_str());
+	ASSERT_TRUE(texture.isLoaded());
+	EXPECT_EQ(texture.getFormat(), TextureFormat::BC1);
+	EXPECT_TRUE(texture.isCompressed());
+	EXPECT_EQ(texture.getWidth(), 8);
+	EXPECT_EQ(texture.getHeight(), 4);
+	EXPECT_EQ(texture.getMipLevelCount(), 1);
+	EXPECT_EQ(texture.getData(), nullptr);
+
+	// half a byte per texel instead of four
+	EXPECT_EQ(texture.getMemoryUsage(), 16u);
+
+	Texture::resetBlockCache();
+	alignas(16) uint32_t colors[4];
+	sampleColors(texture, _mm_set_ps(0.9f, 0.6f, 0.4f, 0.1f), _mm_set1_ps(0.5f), 0.0f, colors);
+	EXPECT_EQ(colors[0], 0x0000FFu);
+	EXPECT_EQ(colors[1], 0x0000FFu);
+	EXPECT_EQ(colors[2], 0xFF0000u);
+	EXPECT_EQ(colors[3], 0xFF0000u);
+
+	// each block is decoded once, later quads hit the cache
+	EXPECT_EQ(Texture::getBlockCacheStats().misses, 2u);
+	sampleColors(texture, _mm_set_ps(0.8f, 0.7f, 0.3f, 0.2f), _mm_set1_ps(0.25f), 0.0f, colors);
+	EXPECT_EQ(Texture::getBlockCacheStats().misses, 2u);
+	EXPECT_EQ(Texture::getBlockCacheStats().hits, 2u);
+
+	sampleColors(texture, _mm_set1_ps(0.3f), _mm_set1_ps(0.5f), 0.0f, TextureFilter::Bilinear, colors);
+	EXPECT_EQ(colors[0], 0x0000FFu);
+	EXPECT_EQ(texture.getTexel(0, 7, 3), 0xFFFF0000u);
+}